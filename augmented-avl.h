@@ -0,0 +1,372 @@
+#ifndef AUGMENTED_AVL_H
+#define AUGMENTED_AVL_H
+
+#include <cstddef>
+#include <limits>
+#include <functional>
+#include <stdexcept>
+#include "bst.h"
+#include "avlbst.h"
+
+/**
+* Monoids for AugmentedAVLTree. A monoid supplies the summary type, its
+* identity, lift() from one item to a summary and an associative
+* combine(). combine() is always applied in key order, so it need not be
+* commutative.
+*/
+template <typename T>
+struct SumMonoid
+{
+    typedef T summary_type;
+    static T identity() { return T(); }
+    template <typename Key, typename Value>
+    static T lift(const Key&, const Value& value) { return value; }
+    static T combine(const T& a, const T& b) { return a + b; }
+};
+
+template <typename T>
+struct MinMonoid
+{
+    typedef T summary_type;
+    static T identity() { return std::numeric_limits<T>::max(); }
+    template <typename Key, typename Value>
+    static T lift(const Key&, const Value& value) { return value; }
+    static T combine(const T& a, const T& b) { return b < a ? b : a; }
+};
+
+template <typename T>
+struct MaxMonoid
+{
+    typedef T summary_type;
+    static T identity() { return std::numeric_limits<T>::lowest(); }
+    template <typename Key, typename Value>
+    static T lift(const Key&, const Value& value) { return value; }
+    static T combine(const T& a, const T& b) { return a < b ? b : a; }
+};
+
+struct CountMonoid
+{
+    typedef size_t summary_type;
+    static size_t identity() { return 0; }
+    template <typename Key, typename Value>
+    static size_t lift(const Key&, const Value&) { return 1; }
+    static size_t combine(size_t a, size_t b) { return a + b; }
+};
+
+/**
+* An AVLNode that also holds the summary of its whole subtree.
+*/
+template <typename Key, typename Value, typename Summary>
+class AugmentedNode : public AVLNode<Key, Value>
+{
+public:
+    AugmentedNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent, const Summary& summary) :
+        AVLNode<Key, Value>(key, value, parent), summary_(summary) {}
+
+    const Summary& getSummary() const { return summary_; }
+    void setSummary(const Summary& summary) { summary_ = summary; }
+
+protected:
+    Summary summary_;
+};
+
+/**
+* An AVL tree where every node keeps Monoid's summary of its subtree, so
+* aggregate(lo, hi) over a key range and the prefix searches take
+* O(log n) instead of a scan.
+*
+* Summaries are refreshed where the structure changes: both nodes of
+* every rotation (a rotation keeps the subtree's contents, so nothing
+* above them changes), then the path from the inserted or unlinked
+* position to the root. That path runs through both nodes that a
+* two-child remove swaps, so nodeSwap needs nothing of its own. Change
+* values with insert() or update(). operator[] is read-only here, and
+* writing through an iterator bypasses the summaries.
+*/
+template <class Key, class Value, class Monoid, class Compare = std::less<Key>, class Stats = NullTreeStats>
+class AugmentedAVLTree : public AVLTree<Key, Value, Compare, Stats>
+{
+public:
+    typedef typename Monoid::summary_type Summary;
+    typedef typename BinarySearchTree<Key, Value, Compare, Stats>::iterator iterator;
+
+    AugmentedAVLTree() : created_(nullptr) {}
+    explicit AugmentedAVLTree(const Compare& comp) : AVLTree<Key, Value, Compare, Stats>(comp), created_(nullptr) {}
+    AugmentedAVLTree(const AugmentedAVLTree& other);
+    AugmentedAVLTree(AugmentedAVLTree&& other) noexcept :
+        AVLTree<Key, Value, Compare, Stats>(std::move(other)), created_(nullptr) {}
+    AugmentedAVLTree& operator=(const AugmentedAVLTree& other);
+    AugmentedAVLTree& operator=(AugmentedAVLTree&& other) noexcept;
+
+    virtual void insert(const std::pair<const Key, Value>& new_item);
+    virtual void remove(const Key& key);
+    void update(const Key& key, const Value& value);
+
+    // Read-only: hides the base's non-const operator[], whose writes would
+    // leave the summaries stale.
+    const Value& operator[](const Key& key) const;
+
+    Summary total() const;
+    Summary aggregate(const Key& lo, const Key& hi) const;
+
+    // The first item whose prefix aggregate (all items up to and including
+    // it) satisfies pred, which must stay true once it becomes true along
+    // the keys; end() if none does.
+    template <typename Predicate>
+    iterator searchPrefix(Predicate pred) const;
+    iterator firstPrefixExceeding(const Summary& limit) const;
+
+protected:
+    typedef AugmentedNode<Key, Value, Summary> ANode;
+
+    virtual Node<Key, Value>* createNode(const Key& key, const Value& value, Node<Key, Value>* parent);
+    virtual Node<Key, Value>* cloneNode(const Node<Key, Value>* source, Node<Key, Value>* parent) const;
+    virtual void rotateLeft(AVLNode<Key, Value>* node);
+    virtual void rotateRight(AVLNode<Key, Value>* node);
+
+    static Summary summaryOf(Node<Key, Value>* node);
+    static void refresh(Node<Key, Value>* node);
+    static void refreshToRoot(Node<Key, Value>* node);
+
+    ANode* created_;    // set by createNode for insert to start its walk
+};
+
+/*
+  --------------------------------------------------------
+  Begin implementations for the AugmentedAVLTree class.
+  --------------------------------------------------------
+*/
+
+/**
+* Copies keep the summaries along with the balances.
+*/
+template<class Key, class Value, class Monoid, class Compare, class Stats>
+AugmentedAVLTree<Key, Value, Monoid, Compare, Stats>::AugmentedAVLTree(const AugmentedAVLTree& other) :
+    AVLTree<Key, Value, Compare, Stats>(other.key_comp()),
+    created_(nullptr)
+{
+    this->cloneContents(other, 1);
+}
+
+template<class Key, class Value, class Monoid, class Compare, class Stats>
+AugmentedAVLTree<Key, Value, Monoid, Compare, Stats>&
+AugmentedAVLTree<Key, Value, Monoid, Compare, Stats>::operator=(const AugmentedAVLTree& other)
+{
+    this->copyFrom(other);
+    return *this;
+}
+
+template<class Key, class Value, class Monoid, class Compare, class Stats>
+AugmentedAVLTree<Key, Value, Monoid, Compare, Stats>&
+AugmentedAVLTree<Key, Value, Monoid, Compare, Stats>::operator=(AugmentedAVLTree&& other) noexcept
+{
+    AVLTree<Key, Value, Compare, Stats>::operator=(std::move(other));
+    return *this;
+}
+
+template<class Key, class Value, class Monoid, class Compare, class Stats>
+void AugmentedAVLTree<Key, Value, Monoid, Compare, Stats>::insert(const std::pair<const Key, Value>& new_item)
+{
+    created_ = nullptr;
+    if(this->insertItem(new_item)) {
+        refreshToRoot(created_);
+    }
+    else {
+        // an overwritten value changes every summary above it
+        refreshToRoot(this->internalFind(new_item.first));
+    }
+}
+
+template<class Key, class Value, class Monoid, class Compare, class Stats>
+void AugmentedAVLTree<Key, Value, Monoid, Compare, Stats>::remove(const Key& key)
+{
+    Node<Key, Value>* target = this->internalFind(key);
+    if(target == nullptr) return;
+
+    // Where the unlinked node's parent will be: with two children the
+    // node is first swapped into its predecessor's place, which is below
+    // the predecessor itself when that was the left child.
+    Node<Key, Value>* start = target->getParent();
+    if(target->getLeft() != nullptr and target->getRight() != nullptr) {
+        Node<Key, Value>* pred = this->predecessor(target);
+        start = (pred->getParent() == target) ? pred : pred->getParent();
+    }
+
+    AVLTree<Key, Value, Compare, Stats>::remove(key);
+    refreshToRoot(start);
+}
+
+/**
+* Changes the value of a key already in the tree and refreshes the
+* summaries up to the root. Throws std::out_of_range like operator[] if
+* the key is missing.
+*/
+template<class Key, class Value, class Monoid, class Compare, class Stats>
+void AugmentedAVLTree<Key, Value, Monoid, Compare, Stats>::update(const Key& key, const Value& value)
+{
+    Node<Key, Value>* node = this->internalFind(key);
+    if(node == nullptr) throw std::out_of_range("Invalid key");
+    node->setValue(value);
+    refreshToRoot(node);
+}
+
+template<class Key, class Value, class Monoid, class Compare, class Stats>
+const Value& AugmentedAVLTree<Key, Value, Monoid, Compare, Stats>::operator[](const Key& key) const
+{
+    return BinarySearchTree<Key, Value, Compare, Stats>::operator[](key);
+}
+
+/**
+* Summary of the whole tree.
+*/
+template<class Key, class Value, class Monoid, class Compare, class Stats>
+typename Monoid::summary_type AugmentedAVLTree<Key, Value, Monoid, Compare, Stats>::total() const
+{
+    return summaryOf(this->root_);
+}
+
+/**
+* Summary of the items with lo <= key < hi, in O(log n): go down to the
+* first node inside the range, then down its left side collecting what
+* is at least lo and down its right side collecting what is below hi.
+*/
+template<class Key, class Value, class Monoid, class Compare, class Stats>
+typename Monoid::summary_type
+AugmentedAVLTree<Key, Value, Monoid, Compare, Stats>::aggregate(const Key& lo, const Key& hi) const
+{
+    Node<Key, Value>* split = this->root_;
+    while(split != nullptr) {
+        if(this->keyLess(split->getKey(), lo)) split = split->getRight();
+        else if(!this->keyLess(split->getKey(), hi)) split = split->getLeft();
+        else break;
+    }
+    if(split == nullptr) return Monoid::identity();
+
+    // pieces of the left side come largest first, so each is prepended
+    Summary left = Monoid::identity();
+    for(Node<Key, Value>* node = split->getLeft(); node != nullptr; ) {
+        if(this->keyLess(node->getKey(), lo)) {
+            node = node->getRight();
+        }
+        else {
+            Summary piece = Monoid::combine(Monoid::lift(node->getKey(), node->getValue()), summaryOf(node->getRight()));
+            left = Monoid::combine(piece, left);
+            node = node->getLeft();
+        }
+    }
+
+    Summary right = Monoid::identity();
+    for(Node<Key, Value>* node = split->getRight(); node != nullptr; ) {
+        if(!this->keyLess(node->getKey(), hi)) {
+            node = node->getLeft();
+        }
+        else {
+            Summary piece = Monoid::combine(summaryOf(node->getLeft()), Monoid::lift(node->getKey(), node->getValue()));
+            right = Monoid::combine(right, piece);
+            node = node->getRight();
+        }
+    }
+
+    Summary middle = Monoid::lift(split->getKey(), split->getValue());
+    return Monoid::combine(Monoid::combine(left, middle), right);
+}
+
+template<class Key, class Value, class Monoid, class Compare, class Stats>
+template<typename Predicate>
+typename AugmentedAVLTree<Key, Value, Monoid, Compare, Stats>::iterator
+AugmentedAVLTree<Key, Value, Monoid, Compare, Stats>::searchPrefix(Predicate pred) const
+{
+    Summary before = Monoid::identity();   // everything left of node's subtree
+    Node<Key, Value>* node = this->root_;
+    while(node != nullptr) {
+        Summary throughLeft = Monoid::combine(before, summaryOf(node->getLeft()));
+        if(pred(throughLeft)) {
+            node = node->getLeft();
+            continue;
+        }
+        Summary throughNode = Monoid::combine(throughLeft, Monoid::lift(node->getKey(), node->getValue()));
+        if(pred(throughNode)) return this->iteratorAt(node);
+        before = throughNode;
+        node = node->getRight();
+    }
+    return this->end();
+}
+
+/**
+* For quotas and rates: the first item at which the running aggregate
+* goes past limit.
+*/
+template<class Key, class Value, class Monoid, class Compare, class Stats>
+typename AugmentedAVLTree<Key, Value, Monoid, Compare, Stats>::iterator
+AugmentedAVLTree<Key, Value, Monoid, Compare, Stats>::firstPrefixExceeding(const Summary& limit) const
+{
+    return searchPrefix([&limit](const Summary& prefix) { return limit < prefix; });
+}
+
+template<class Key, class Value, class Monoid, class Compare, class Stats>
+Node<Key, Value>* AugmentedAVLTree<Key, Value, Monoid, Compare, Stats>::createNode(const Key& key, const Value& value,
+                                                                                   Node<Key, Value>* parent)
+{
+    this->stats_.allocation();
+    created_ = new ANode(key, value, static_cast<AVLNode<Key, Value>*>(parent), Monoid::lift(key, value));
+    return created_;
+}
+
+template<class Key, class Value, class Monoid, class Compare, class Stats>
+Node<Key, Value>* AugmentedAVLTree<Key, Value, Monoid, Compare, Stats>::cloneNode(const Node<Key, Value>* source,
+                                                                                  Node<Key, Value>* parent) const
+{
+    const ANode* from = static_cast<const ANode*>(source);
+    ANode* node = new ANode(from->getKey(), from->getValue(), static_cast<AVLNode<Key, Value>*>(parent), from->getSummary());
+    node->setBalance(from->getBalance());
+    return node;
+}
+
+template<class Key, class Value, class Monoid, class Compare, class Stats>
+void AugmentedAVLTree<Key, Value, Monoid, Compare, Stats>::rotateLeft(AVLNode<Key, Value>* node)
+{
+    AVLTree<Key, Value, Compare, Stats>::rotateLeft(node);
+    refresh(node);
+    refresh(node->getParent());
+}
+
+template<class Key, class Value, class Monoid, class Compare, class Stats>
+void AugmentedAVLTree<Key, Value, Monoid, Compare, Stats>::rotateRight(AVLNode<Key, Value>* node)
+{
+    AVLTree<Key, Value, Compare, Stats>::rotateRight(node);
+    refresh(node);
+    refresh(node->getParent());
+}
+
+template<class Key, class Value, class Monoid, class Compare, class Stats>
+typename Monoid::summary_type AugmentedAVLTree<Key, Value, Monoid, Compare, Stats>::summaryOf(Node<Key, Value>* node)
+{
+    if(node == nullptr) return Monoid::identity();
+    return static_cast<ANode*>(node)->getSummary();
+}
+
+/**
+* Recomputes node's summary from its children's.
+*/
+template<class Key, class Value, class Monoid, class Compare, class Stats>
+void AugmentedAVLTree<Key, Value, Monoid, Compare, Stats>::refresh(Node<Key, Value>* node)
+{
+    Summary summary = Monoid::combine(summaryOf(node->getLeft()), Monoid::lift(node->getKey(), node->getValue()));
+    static_cast<ANode*>(node)->setSummary(Monoid::combine(summary, summaryOf(node->getRight())));
+}
+
+template<class Key, class Value, class Monoid, class Compare, class Stats>
+void AugmentedAVLTree<Key, Value, Monoid, Compare, Stats>::refreshToRoot(Node<Key, Value>* node)
+{
+    for(; node != nullptr; node = node->getParent()) {
+        refresh(node);
+    }
+}
+
+/*
+  ------------------------------------------------------
+  End implementations for the AugmentedAVLTree class.
+  ------------------------------------------------------
+*/
+
+#endif
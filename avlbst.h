@@ -127,75 +127,111 @@ AVLNode<Key, Value> *AVLNode<Key, Value>::getRight() const
 */
 
 
-template <class Key, class Value>
-class AVLTree : public BinarySearchTree<Key, Value>
+/**
+* An AVL tree. Compare and Stats are passed on to BinarySearchTree (see
+* tree-compare.h and tree-stats.h).
+*/
+template <class Key, class Value, class Compare = std::less<Key>, class Stats = NullTreeStats>
+class AVLTree : public BinarySearchTree<Key, Value, Compare, Stats>
 {
 public:
+    AVLTree() {}
+    explicit AVLTree(const Compare& comp) : BinarySearchTree<Key, Value, Compare, Stats>(comp) {}
+    AVLTree(const AVLTree& other);
+    AVLTree(AVLTree&& other) noexcept : BinarySearchTree<Key, Value, Compare, Stats>(std::move(other)) {}
+    AVLTree& operator=(const AVLTree& other);
+    AVLTree& operator=(AVLTree&& other) noexcept;
+
     virtual void insert (const std::pair<const Key, Value> &new_item); // TODO
     virtual void remove(const Key& key);  // TODO
 protected:
     virtual void nodeSwap( AVLNode<Key,Value>* n1, AVLNode<Key,Value>* n2);
+    virtual bool storedBalanceMatches(Node<Key, Value>* node, int balance) const;
+    virtual Node<Key, Value>* createNode(const Key& key, const Value& value, Node<Key, Value>* parent);
+    virtual Node<Key, Value>* cloneNode(const Node<Key, Value>* source, Node<Key, Value>* parent) const;
 
     // Add helper functions here
 
-    void rotateLeft(AVLNode<Key, Value>* node);
-    void rotateRight(AVLNode<Key, Value>* node);
+    // virtual so augmented trees can refresh what a rotation moves
+    virtual void rotateLeft(AVLNode<Key, Value>* node);
+    virtual void rotateRight(AVLNode<Key, Value>* node);
     void insertFix(AVLNode<Key, Value>* parent, AVLNode<Key, Value>* child);
 		void removeFix(AVLNode<Key, Value>* node, int8_t diff);
 		AVLNode<Key, Value>* getSuccessor(AVLNode<Key, Value>* node);
+    bool insertItem(const std::pair<const Key, Value>& new_item);
+    void removeFound(AVLNode<Key, Value>* nodeToRemove);
 };
 
+/**
+* Copies the shape and every balance factor in O(n), with no rebalancing.
+*/
+template<class Key, class Value, class Compare, class Stats>
+AVLTree<Key, Value, Compare, Stats>::AVLTree(const AVLTree& other) :
+    BinarySearchTree<Key, Value, Compare, Stats>(other.key_comp())
+{
+    this->cloneContents(other, 1);
+}
+
+template<class Key, class Value, class Compare, class Stats>
+AVLTree<Key, Value, Compare, Stats>& AVLTree<Key, Value, Compare, Stats>::operator=(const AVLTree& other)
+{
+    this->copyFrom(other);
+    return *this;
+}
+
+template<class Key, class Value, class Compare, class Stats>
+AVLTree<Key, Value, Compare, Stats>& AVLTree<Key, Value, Compare, Stats>::operator=(AVLTree&& other) noexcept
+{
+    BinarySearchTree<Key, Value, Compare, Stats>::operator=(std::move(other));
+    return *this;
+}
+
 /*
  * Recall: If key is already in the tree, you should 
  * overwrite the current value with the updated value.
  */
  
-template<class Key, class Value>
-void AVLTree<Key, Value>::insert (const std::pair<const Key, Value> &new_item)
+template<class Key, class Value, class Compare, class Stats>
+void AVLTree<Key, Value, Compare, Stats>::insert (const std::pair<const Key, Value> &new_item)
 {
     // TODO
+		insertItem(new_item);
+}
 
-		AVLNode<Key, Value>* newNode = new AVLNode<Key, Value>(new_item.first, new_item.second, nullptr);
-		newNode->setBalance(0);
-		newNode->setRight(nullptr);
-		newNode->setLeft(nullptr);
-		
-		if(this->root_ == nullptr) {
-			this->root_ = newNode;
-			return;
+/**
+* The insert itself; returns whether the key was new (false means the
+* value was overwritten).
+*/
+template<class Key, class Value, class Compare, class Stats>
+bool AVLTree<Key, Value, Compare, Stats>::insertItem(const std::pair<const Key, Value>& new_item)
+{
+		// Search first (one comparison per level) and allocate only when
+		// the key is new.
+		Node<Key, Value>* attach = nullptr;
+		bool goRight = false;
+		Node<Key, Value>* existing = this->locate(new_item.first, attach, goRight);
+		if(existing != nullptr) {
+			existing->setValue(new_item.second);
+			return false;
+		}
+		if(attach == nullptr) {
+			this->root_ = this->createNode(new_item.first, new_item.second, nullptr);
+			return true;
 		}
 
-		AVLNode<Key, Value>* parent = nullptr;
-		AVLNode<Key, Value>* next = static_cast<AVLNode<Key, Value>*>(this->root_);
-		
-		while(true){
-			parent = next;
-			if(new_item.first == parent->getKey()){
-				parent->setValue(new_item.second);
-				delete newNode;
-				return;
-			}
-			else if(new_item.first < parent->getKey()){
-				if(parent->getLeft() == nullptr){
-					parent->setLeft(newNode);
-					newNode->setParent(parent);
-					break;
-				}
-				next = parent->getLeft();
-			}
-			else {
-				if(parent->getRight() == nullptr){
-					parent->setRight(newNode);
-					newNode->setParent(parent);
-					break;
-				}
-				next = parent->getRight();
-			}
+		AVLNode<Key, Value>* parent = static_cast<AVLNode<Key, Value>*>(attach);
+		AVLNode<Key, Value>* newNode =
+			static_cast<AVLNode<Key, Value>*>(this->createNode(new_item.first, new_item.second, parent));
+		if(goRight) {
+			parent->setRight(newNode);
+		}
+		else {
+			parent->setLeft(newNode);
 		}
 
 		if((parent->getBalance() == -1) or (parent->getBalance() == 1)){
 			parent->setBalance(0);
-			return;
+			return true;
 		}
 		else{
 			if(parent->getLeft() == newNode){
@@ -206,7 +242,7 @@ void AVLTree<Key, Value>::insert (const std::pair<const Key, Value> &new_item)
 			}
 			insertFix(parent, newNode);
 		}
-		
+		return true;
 }
 
 
@@ -216,92 +252,99 @@ void AVLTree<Key, Value>::insert (const std::pair<const Key, Value> &new_item)
  * should swap with the predecessor and then remove.
  */
 
- template<class Key, class Value>
- void AVLTree<Key, Value>::insertFix(AVLNode<Key, Value>* parent, AVLNode<Key, Value>* child)
+ template<class Key, class Value, class Compare, class Stats>
+ void AVLTree<Key, Value, Compare, Stats>::insertFix(AVLNode<Key, Value>* parent, AVLNode<Key, Value>* child)
  {
-	if((parent == nullptr) or (parent->getParent() == nullptr)) return;
-
-	AVLNode<Key, Value> *grandparent = parent->getParent();
-
-	if(parent == grandparent->getLeft()){
+	// Walks up one level per iteration instead of recursing; stops as soon
+	// as a grandparent absorbs the height change or a rotation fixes it.
+	while((parent != nullptr) and (parent->getParent() != nullptr)){
 
-		grandparent->setBalance(grandparent->getBalance() - 1);
+		AVLNode<Key, Value> *grandparent = parent->getParent();
 
-		if(grandparent->getBalance() == 0) return; //already balanced
+		if(parent == grandparent->getLeft()){
 
-		if(grandparent->getBalance() == -1){
-			insertFix(grandparent, parent);
-			return;
-		}
+			grandparent->setBalance(grandparent->getBalance() - 1);
 
-		if(child == parent->getLeft()){
-			rotateRight(grandparent);
-			parent->setBalance(0);
-			grandparent->setBalance(0);
-		}
+			if(grandparent->getBalance() == 0) return; //already balanced
 
-		else {
-			rotateLeft(parent);
-			rotateRight(grandparent);
-
-			if(child->getBalance() == -1){
-				parent->setBalance(0);
-				grandparent->setBalance(1);
+			if(grandparent->getBalance() == -1){
+				child = parent;
+				parent = grandparent;
+				continue;
 			}
-			else if(child->getBalance() == 0){
-				parent->setBalance(0);
-				grandparent->setBalance(0);
 
-			} else {
-				parent->setBalance(-1);
+			if(child == parent->getLeft()){
+				rotateRight(grandparent);
+				parent->setBalance(0);
 				grandparent->setBalance(0);
 			}
-			child->setBalance(0);
-		}
-	}
 
-	else{
-		grandparent->setBalance(grandparent->getBalance() +1);
+			else {
+				rotateLeft(parent);
+				rotateRight(grandparent);
 
-		if(grandparent->getBalance() == 0) return;
+				if(child->getBalance() == -1){
+					parent->setBalance(0);
+					grandparent->setBalance(1);
+				}
+				else if(child->getBalance() == 0){
+					parent->setBalance(0);
+					grandparent->setBalance(0);
 
-		if(grandparent->getBalance() == 1){
-			insertFix(grandparent, parent);
+				} else {
+					parent->setBalance(-1);
+					grandparent->setBalance(0);
+				}
+				child->setBalance(0);
+			}
 			return;
 		}
 
-		if(child == parent->getRight()){
-			rotateLeft(grandparent);
-			parent->setBalance(0);
-			grandparent->setBalance(0);
-		}
-
 		else{
-			rotateRight(parent);
-			rotateLeft(grandparent);
+			grandparent->setBalance(grandparent->getBalance() +1);
 
-			if(child->getBalance() == 1){
-				parent->setBalance(0);
-				grandparent->setBalance(-1);
+			if(grandparent->getBalance() == 0) return;
+
+			if(grandparent->getBalance() == 1){
+				child = parent;
+				parent = grandparent;
+				continue;
 			}
 
-			else if(child->getBalance() == 0){
+			if(child == parent->getRight()){
+				rotateLeft(grandparent);
 				parent->setBalance(0);
 				grandparent->setBalance(0);
 			}
 
-			else {
-				parent->setBalance(1);
-				grandparent->setBalance(0);
+			else{
+				rotateRight(parent);
+				rotateLeft(grandparent);
+
+				if(child->getBalance() == 1){
+					parent->setBalance(0);
+					grandparent->setBalance(-1);
+				}
+
+				else if(child->getBalance() == 0){
+					parent->setBalance(0);
+					grandparent->setBalance(0);
+				}
+
+				else {
+					parent->setBalance(1);
+					grandparent->setBalance(0);
+				}
+				child->setBalance(0);
 			}
-			child->setBalance(0);
+			return;
 		}
 	}
 
  }
 
-template<class Key, class Value>
-void AVLTree<Key, Value>:: remove(const Key& key)
+template<class Key, class Value, class Compare, class Stats>
+void AVLTree<Key, Value, Compare, Stats>:: remove(const Key& key)
 {
 	
 	
@@ -312,7 +355,16 @@ void AVLTree<Key, Value>:: remove(const Key& key)
 
 		AVLNode<Key, Value>* nodeToRemove = static_cast<AVLNode<Key, Value>*>(this->internalFind(key));
 		if(nodeToRemove == nullptr) return;
+		removeFound(nodeToRemove);
+}
 
+/**
+* Unlinks, frees and rebalances for a node already found, for subclasses
+* that search their own way.
+*/
+template<class Key, class Value, class Compare, class Stats>
+void AVLTree<Key, Value, Compare, Stats>::removeFound(AVLNode<Key, Value>* nodeToRemove)
+{
 		if((nodeToRemove->getLeft() != nullptr) and (nodeToRemove->getRight() != nullptr)){
 			AVLNode<Key, Value>* pred = static_cast<AVLNode<Key, Value>*>(this->predecessor(nodeToRemove));
 			nodeSwap(nodeToRemove, pred);
@@ -350,7 +402,7 @@ void AVLTree<Key, Value>:: remove(const Key& key)
 			}
 		}
 
-		delete nodeToRemove;
+		this->destroyNode(nodeToRemove);
 
 		if(parent != nullptr){
 			removeFix(parent, diff);
@@ -358,32 +410,25 @@ void AVLTree<Key, Value>:: remove(const Key& key)
 		
 }
 
-template<class Key, class Value>
-void AVLTree<Key, Value>::removeFix(AVLNode<Key, Value>* node, int8_t diff){
-	
+template<class Key, class Value, class Compare, class Stats>
+void AVLTree<Key, Value, Compare, Stats>::removeFix(AVLNode<Key, Value>* node, int8_t diff){
 
-	
-	if(node == nullptr) return;
+	// Each iteration handles one level; "continue" carries the height
+	// decrease on to the parent, "return" means it was absorbed.
+	while(node != nullptr){
 
-	AVLNode<Key, Value>* parent = node->getParent();
-	int8_t nextDiff = 0;
-
-	if(parent != nullptr){
-		bool isLeftChild = (parent->getLeft() == node);
-		nextDiff = isLeftChild ? 1 : -1;
-	}
-
-	node->updateBalance(diff);
+		AVLNode<Key, Value>* parent = node->getParent();
+		int8_t nextDiff = 0;
 
-	if(node->getBalance() == 0){
 		if(parent != nullptr){
-			removeFix(parent, nextDiff);
+			bool isLeftChild = (parent->getLeft() == node);
+			nextDiff = isLeftChild ? 1 : -1;
 		}
-	}
 
-	else if((node->getBalance() == 1) or (node->getBalance() == -1)) return;
+		node->updateBalance(diff);
+
+		if((node->getBalance() == 1) or (node->getBalance() == -1)) return;
 
-	else {
 		if(node->getBalance() == 2){
 			AVLNode<Key, Value>* rightChild = node->getRight();
 
@@ -398,18 +443,13 @@ void AVLTree<Key, Value>::removeFix(AVLNode<Key, Value>* node, int8_t diff){
 					rightChild->setBalance(0);
 				} else if(newTop->getBalance() == 1){
 					node->setBalance(-1);
-					rightChild->setBalance(1); // changed from 1 to 0
+					rightChild->setBalance(0);
 					newTop->setBalance(0);
 				} else {
 					node->setBalance(0);
 					rightChild->setBalance(1);
 					newTop->setBalance(0);
 				}
-
-
-				if(parent != nullptr){
-					removeFix(parent, nextDiff);
-				}
 			}
 			else{
 				rotateLeft(node);
@@ -418,16 +458,12 @@ void AVLTree<Key, Value>::removeFix(AVLNode<Key, Value>* node, int8_t diff){
 					node->setBalance(1);
 					rightChild->setBalance(-1);
 					return;
-				} else {
-					node->setBalance(0);
-					rightChild->setBalance(0);
-
-					if(parent != nullptr){
-						removeFix(parent, nextDiff);
-					}
 				}
+				node->setBalance(0);
+				rightChild->setBalance(0);
 			}
-		} else {
+		}
+		else if(node->getBalance() == -2){
 			AVLNode<Key, Value>* leftChild = node->getLeft();
 
 			if(leftChild->getBalance() == 1){
@@ -448,10 +484,6 @@ void AVLTree<Key, Value>::removeFix(AVLNode<Key, Value>* node, int8_t diff){
 					leftChild->setBalance(-1);
 					newTop->setBalance(0);
 				}
-
-				if(parent != nullptr){
-					removeFix(parent, nextDiff);
-				}
 			}
 			else {
 				rotateRight(node);
@@ -460,88 +492,68 @@ void AVLTree<Key, Value>::removeFix(AVLNode<Key, Value>* node, int8_t diff){
 					node->setBalance(-1);
 					leftChild->setBalance(1);
 					return;
-				} else {
-					node->setBalance(0);
-					leftChild->setBalance(0);
-
-					if(parent != nullptr){
-						removeFix(parent, nextDiff);
-					}
 				}
+				node->setBalance(0);
+				leftChild->setBalance(0);
 			}
 		}
+
+		// balance was 0, or a rotation shortened this subtree
+		node = parent;
+		diff = nextDiff;
 	}
-	
+
 }
 
-template<class Key, class Value>
-void AVLTree<Key, Value>::nodeSwap( AVLNode<Key,Value>* n1, AVLNode<Key,Value>* n2)
+template<class Key, class Value, class Compare, class Stats>
+void AVLTree<Key, Value, Compare, Stats>::nodeSwap( AVLNode<Key,Value>* n1, AVLNode<Key,Value>* n2)
 {
-    BinarySearchTree<Key, Value>::nodeSwap(n1, n2);
+    BinarySearchTree<Key, Value, Compare, Stats>::nodeSwap(n1, n2);
     int8_t tempB = n1->getBalance();
     n1->setBalance(n2->getBalance());
     n2->setBalance(tempB);
 }
 
-template<class Key, class Value>
-void AVLTree<Key, Value>::rotateLeft(AVLNode<Key, Value>* node){
-	AVLNode<Key, Value>* y = node->getRight();
-	AVLNode<Key, Value>* rootParent = node->getParent();
-	y->setParent(rootParent);
-
-	if(node->getParent() == nullptr){
-		this->root_ = node->getRight();
-	}
-	else if(rootParent->getRight() == node){
-		rootParent->setRight(y);
-	}
-	else{
-		rootParent->setLeft(y);
-	}
-
-	AVLNode<Key, Value>* c = y->getLeft();
-
-	y->setLeft(node);
-	node->setParent(y);
-	node->setRight(c);
-
-	if(c != nullptr){
-		c->setParent(node);
-	}
-
+/**
+* Lets analyzeShape() verify each node's balance_ against its real heights.
+*/
+template<class Key, class Value, class Compare, class Stats>
+bool AVLTree<Key, Value, Compare, Stats>::storedBalanceMatches(Node<Key, Value>* node, int balance) const
+{
+    return static_cast<AVLNode<Key, Value>*>(node)->getBalance() == balance;
 }
 
-template<class Key, class Value>
-void AVLTree<Key, Value>::rotateRight(AVLNode<Key, Value>* node){
-
-	AVLNode<Key, Value>* y = node->getLeft();
-	AVLNode<Key, Value>* rootParent = node->getParent();
-	y->setParent(rootParent);
-
-	if(node->getParent() == nullptr){
-		this->root_ = y;
-	}
-	else if(rootParent->getRight() == node){
-		rootParent->setRight(y);
-	}
-	else{
-		rootParent->setLeft(y);
-	}
+/**
+* New nodes are AVLNodes with balance 0.
+*/
+template<class Key, class Value, class Compare, class Stats>
+Node<Key, Value>* AVLTree<Key, Value, Compare, Stats>::createNode(const Key& key, const Value& value, Node<Key, Value>* parent)
+{
+    this->stats_.allocation();
+    return new AVLNode<Key, Value>(key, value, static_cast<AVLNode<Key, Value>*>(parent));
+}
 
-	AVLNode<Key, Value>* c = y->getRight();
+template<class Key, class Value, class Compare, class Stats>
+Node<Key, Value>* AVLTree<Key, Value, Compare, Stats>::cloneNode(const Node<Key, Value>* source, Node<Key, Value>* parent) const
+{
+    AVLNode<Key, Value>* node = new AVLNode<Key, Value>(source->getKey(), source->getValue(),
+                                                        static_cast<AVLNode<Key, Value>*>(parent));
+    node->setBalance(static_cast<const AVLNode<Key, Value>*>(source)->getBalance());
+    return node;
+}
 
-	y->setRight(node);
-	node->setParent(y);
-	node->setLeft(c);
-	
-	if(c != nullptr){
-		c->setParent(node);
-	}
+template<class Key, class Value, class Compare, class Stats>
+void AVLTree<Key, Value, Compare, Stats>::rotateLeft(AVLNode<Key, Value>* node){
+	BinarySearchTree<Key, Value, Compare, Stats>::rotateLeft(node);
+}
 
+template<class Key, class Value, class Compare, class Stats>
+void AVLTree<Key, Value, Compare, Stats>::rotateRight(AVLNode<Key, Value>* node){
+	BinarySearchTree<Key, Value, Compare, Stats>::rotateRight(node);
 }
 
-template<class Key, class Value>
-AVLNode<Key, Value>* AVLTree<Key, Value>::getSuccessor(AVLNode<Key, Value>* node){
+template<class Key, class Value, class Compare, class Stats>
+AVLNode<Key, Value>* AVLTree<Key, Value, Compare, Stats>::getSuccessor(AVLNode<Key, Value>* node){
 	if(node->getRight() != nullptr){
 		node = node->getRight();
 		while (node->getLeft() != nullptr){
@@ -560,4 +572,47 @@ AVLNode<Key, Value>* AVLTree<Key, Value>::getSuccessor(AVLNode<Key, Value>* node
 }
 
 
+/**
+* An ordered set on the AVL balancing code above: AVLTree with SetMarker
+* values, whose nodes store the key alone (see Node<Key, SetMarker>).
+* Iterators yield const Key&.
+*/
+template <class Key, class Compare = std::less<Key>, class Stats = NullTreeStats>
+class AVLSet : public AVLTree<Key, SetMarker, Compare, Stats>
+{
+public:
+    AVLSet() {}
+    explicit AVLSet(const Compare& comp) : AVLTree<Key, SetMarker, Compare, Stats>(comp) {}
+
+    bool insert(const Key& key);
+    bool contains(const Key& key) const;
+};
+
+/*
+  --------------------------------------------
+  Begin implementations for the AVLSet class.
+  --------------------------------------------
+*/
+
+/**
+* Adds key; returns false if it was already there.
+*/
+template<class Key, class Compare, class Stats>
+bool AVLSet<Key, Compare, Stats>::insert(const Key& key)
+{
+    return this->insertItem(std::pair<const Key, SetMarker>(key, SetMarker()));
+}
+
+template<class Key, class Compare, class Stats>
+bool AVLSet<Key, Compare, Stats>::contains(const Key& key) const
+{
+    return this->internalFind(key) != nullptr;
+}
+
+/*
+  ------------------------------------------
+  End implementations for the AVLSet class.
+  ------------------------------------------
+*/
+
 #endif
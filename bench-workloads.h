@@ -0,0 +1,137 @@
+#ifndef BENCH_WORKLOADS_H
+#define BENCH_WORKLOADS_H
+
+#include <vector>
+#include <map>
+#include <chrono>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <utility>
+
+/**
+* Workload generation shared by the benchmark programs. Everything is
+* seeded, so the same arguments always produce the same operations.
+*/
+
+/**
+ * One operation of a workload. For SCAN, key is where the scan starts and
+ * the scan length is fixed by the workload.
+ */
+struct Op
+{
+    enum Kind { INSERT = 0, REMOVE = 1, FIND = 2, SCAN = 3 };
+
+    int kind;
+    int key;
+};
+
+/**
+ * Builds numOps operations over keys in [0, keySpace) with the given
+ * percentages of inserts and removes; the rest are lookups.
+ */
+inline std::vector<Op> makeMix(size_t numOps, int keySpace, int insertPct, int removePct, unsigned seed)
+{
+    std::vector<Op> ops(numOps);
+    srand(seed);
+    for(size_t i = 0; i < numOps; ++i) {
+        int r = rand() % 100;
+        ops[i].kind = (r < insertPct) ? Op::INSERT : (r < insertPct + removePct) ? Op::REMOVE : Op::FIND;
+        ops[i].key = rand() % keySpace;
+    }
+    return ops;
+}
+
+/**
+ * Draws keys from a Zipf distribution with exponent s over keySpace keys.
+ * Ranks are mapped through a random permutation so the hot keys are spread
+ * over the key space instead of being the smallest ones.
+ */
+inline std::vector<Op> makeZipfLookups(size_t numOps, int keySpace, double s, unsigned seed)
+{
+    std::vector<double> cdf(keySpace);
+    double total = 0;
+    for(int rank = 0; rank < keySpace; ++rank) {
+        total += 1.0 / std::pow(rank + 1, s);
+        cdf[rank] = total;
+    }
+
+    std::vector<int> keyOfRank(keySpace);
+    for(int i = 0; i < keySpace; ++i) keyOfRank[i] = i;
+    srand(seed);
+    for(int i = keySpace - 1; i > 0; --i) std::swap(keyOfRank[i], keyOfRank[rand() % (i + 1)]);
+
+    std::vector<Op> ops(numOps);
+    for(size_t i = 0; i < numOps; ++i) {
+        double u = (double)rand() / RAND_MAX * total;
+        int rank = (int)(std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin());
+        ops[i].kind = Op::FIND;
+        ops[i].key = keyOfRank[std::min(rank, keySpace - 1)];
+    }
+    return ops;
+}
+
+/**
+ * std::map behind the tree interface used by the workloads.
+ */
+class StdMap : public std::map<int, int>
+{
+public:
+    void insert(const std::pair<const int, int>& item) { (*this)[item.first] = item.second; }
+    void remove(int key) { erase(key); }
+};
+
+/**
+ * Applies ops to tree and returns a checksum of what the lookups and scans
+ * saw, so the compiler cannot drop them. Scans walk scanLength items in
+ * key order from the start key (when present).
+ */
+template<typename Tree>
+size_t applyOps(Tree& tree, const std::vector<Op>& ops, size_t begin, size_t end, int scanLength = 0)
+{
+    size_t seen = 0;
+    for(size_t i = begin; i < end; ++i) {
+        const Op& op = ops[i];
+        if(op.kind == Op::INSERT) {
+            tree.insert(std::make_pair(op.key, (int)i));
+        }
+        else if(op.kind == Op::REMOVE) {
+            tree.remove(op.key);
+        }
+        else {
+            typename Tree::iterator it = tree.find(op.key);
+            if(op.kind == Op::FIND) {
+                if(it != tree.end()) ++seen;
+                continue;
+            }
+            for(int n = 0; n < scanLength and it != tree.end(); ++n, ++it) {
+                seen += it->second;
+            }
+        }
+    }
+    return seen;
+}
+
+/**
+ * Prefills a fresh tree with keySpace/2 random keys, then times the
+ * operations and returns nanoseconds per operation.
+ */
+template<typename Tree>
+double runMix(const std::vector<Op>& ops, int keySpace)
+{
+    Tree tree;
+    srand(7);
+    for(int i = 0; i < keySpace / 2; ++i) {
+        tree.insert(std::make_pair(rand() % keySpace, i));
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    size_t seen = applyOps(tree, ops, 0, ops.size());
+    std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+
+    // keep the lookups from being optimized away
+    if(seen == (size_t)-1) std::abort();
+    return std::chrono::duration<double, std::nano>(stop - start).count() / ops.size();
+}
+
+#endif
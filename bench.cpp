@@ -0,0 +1,614 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <fstream>
+#include <map>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "bst.h"
+#include "avlbst.h"
+#include "node-pool.h"
+#include "bench-workloads.h"
+#include "perf-counters.h"
+
+using namespace std;
+
+/**
+ * Benchmark suite comparing BinarySearchTree, AVLTree and std::map.
+ *
+ * Every (tree, workload, size) cell runs in a forked child process, so the
+ * reported peak RSS belongs to that cell alone and one cell cannot warm the
+ * allocator or the caches for the next. Results go to stdout as CSV
+ * (default) or JSON.
+ *
+ *   bench [--sizes=1000,1000000] [--trees=bst,avl,avl-pool,avl-huge,map]
+ *         [--workloads=uniform,zipf] [--format=csv|json]
+ *         [--repeat=N] [--warmup=N] [--cpu=K]
+ *         [--baseline=FILE] [--save-baseline=FILE] [--threshold=PCT]
+ *
+ * The default sizes stop at 1M. 100M is available through --sizes, but an
+ * AVLTree of that size needs several GB. The unbalanced BST is skipped on
+ * sorted and reverse-sorted inserts past 20K keys, where it is quadratic.
+ *
+ * Regression checking: each cell is run --repeat times (each repetition a
+ * fresh process pinned to --cpu, after --warmup untimed passes, with the
+ * trees of a workload taking turns) and reported as the mean ns/op with a
+ * 95% confidence interval, plus its fastest repetition. With --baseline,
+ * every cell's fastest ns/op is divided by that of the std::map cell with
+ * the same workload and size, and bench exits non-zero if any such ratio
+ * grew by more than --threshold percent over the stored CSV; the ratio
+ * carries over between machines where raw times do not. Runs checked
+ * against a baseline must include map. --save-baseline writes the
+ * results in the same CSV format. Cycles, cache misses and branch misses
+ * per operation are reported when perf_event_open is allowed, and left
+ * empty otherwise; so are data TLB misses and remote NUMA node misses
+ * where the CPU counts them.
+ *
+ * avl-pool is an AVLTree with its nodes in a NodePool on ordinary pages,
+ * avl-huge the same on 2MB huge pages; against avl they show what node
+ * placement alone is worth, mostly in the dtlb_misses_per_op column on
+ * trees too big for the TLB.
+ */
+
+// Each cell runs at least this many timed operations. Smaller sizes repeat
+// their workload on fresh trees to get there.
+static const size_t MIN_OPS = 200000;
+static const int SCAN_LENGTH = 100;
+static const int BST_DEGENERATE_LIMIT = 20000;
+
+// avl-pool: pooled nodes without huge pages
+class SmallPageAVLTree : public PooledAVLTree<int, int>
+{
+public:
+    SmallPageAVLTree() : PooledAVLTree<int, int>(false) {}
+};
+
+struct Workload
+{
+    const char* name;
+    const char* description;
+};
+
+static const Workload WORKLOADS[] = {
+    { "uniform",      "insert n keys in random order" },
+    { "sorted",       "insert n keys in ascending order" },
+    { "reverse",      "insert n keys in descending order" },
+    { "lookup",       "n uniform lookups in a tree of n keys" },
+    { "zipf",         "n Zipf(1.0) lookups in a tree of n keys" },
+    { "insert-heavy", "n ops, 80% insert / 10% remove / 10% find, prefilled" },
+    { "delete-heavy", "n ops, 10% insert / 80% remove / 10% find, prefilled" },
+    { "range-scan",   "n/100 scans of 100 keys each in a tree of n keys" },
+    { "mixed",        "n ops, 50% find / 25% insert / 25% remove, prefilled" },
+};
+
+/**
+ * A benchmark case: what to put in the tree untimed, then what to time.
+ */
+struct Plan
+{
+    vector<Op> prefill;
+    vector<Op> timed;
+    size_t opsPerUnit;    // a scan counts as SCAN_LENGTH operations
+};
+
+struct Result
+{
+    double seconds;
+    size_t ops;
+    long peakRssKb;
+    size_t checksum;
+    bool counted[PerfCounters::NUM_COUNTERS];
+    double counts[PerfCounters::NUM_COUNTERS];
+};
+
+struct Options
+{
+    int repeat;
+    int warmup;
+    int cpu;          // -1: do not pin
+    double threshold; // percent
+    string baseline;
+    string saveBaseline;
+};
+
+/**
+ * A measured cell: the mean over its repetitions with the half-width of a
+ * 95% confidence interval. Counter values are per operation, or negative
+ * when unavailable.
+ */
+struct Row
+{
+    string tree;
+    string workload;
+    size_t size;
+    size_t ops;
+    int reps;
+    double nsPerOp;
+    double ci95;
+    double bestNsPerOp;
+    long peakRssKb;
+    double perOp[PerfCounters::NUM_COUNTERS];
+};
+
+static vector<Op> insertsOf(const vector<int>& keys)
+{
+    vector<Op> ops(keys.size());
+    for(size_t i = 0; i < keys.size(); ++i) {
+        ops[i].kind = Op::INSERT;
+        ops[i].key = keys[i];
+    }
+    return ops;
+}
+
+static vector<int> shuffledKeys(size_t n, unsigned seed)
+{
+    vector<int> keys(n);
+    for(size_t i = 0; i < n; ++i) keys[i] = (int)i;
+    srand(seed);
+    for(size_t i = n - 1; i > 0; --i) swap(keys[i], keys[(size_t)rand() % (i + 1)]);
+    return keys;
+}
+
+static Plan makePlan(const string& workload, size_t n)
+{
+    Plan plan;
+    plan.opsPerUnit = 1;
+    int keySpace = (int)n;
+    if(workload == "uniform") {
+        plan.timed = insertsOf(shuffledKeys(n, 1));
+    }
+    else if(workload == "sorted" or workload == "reverse") {
+        vector<int> keys(n);
+        for(size_t i = 0; i < n; ++i) keys[i] = (workload == "sorted") ? (int)i : (int)(n - 1 - i);
+        plan.timed = insertsOf(keys);
+    }
+    else if(workload == "lookup") {
+        plan.prefill = insertsOf(shuffledKeys(n, 1));
+        plan.timed = makeMix(n, keySpace, 0, 0, 2);
+    }
+    else if(workload == "zipf") {
+        plan.prefill = insertsOf(shuffledKeys(n, 1));
+        plan.timed = makeZipfLookups(n, keySpace, 1.0, 3);
+    }
+    else if(workload == "range-scan") {
+        plan.prefill = insertsOf(shuffledKeys(n, 1));
+        plan.timed = makeMix(max<size_t>(n / SCAN_LENGTH, 1), max(keySpace - SCAN_LENGTH, 1), 0, 0, 4);
+        for(size_t i = 0; i < plan.timed.size(); ++i) plan.timed[i].kind = Op::SCAN;
+        plan.opsPerUnit = SCAN_LENGTH;
+    }
+    else {
+        // Read/write mixes run over twice the prefilled key range, so about
+        // half the lookups and removes hit.
+        int insertPct = 25, removePct = 25;
+        if(workload == "insert-heavy") { insertPct = 80; removePct = 10; }
+        if(workload == "delete-heavy") { insertPct = 10; removePct = 80; }
+        plan.prefill = insertsOf(shuffledKeys(n, 1));
+        plan.timed = makeMix(n, 2 * keySpace, insertPct, removePct, 5);
+    }
+    return plan;
+}
+
+/**
+ * Runs the plan on fresh trees until at least MIN_OPS operations have been
+ * timed. Only the timed phase is measured; building and tearing down the
+ * prefill is not.
+ */
+template<typename Tree>
+Result runPlan(const Plan& plan, int warmup)
+{
+    for(int w = 0; w < warmup; ++w) {
+        Tree tree;
+        applyOps(tree, plan.prefill, 0, plan.prefill.size());
+        applyOps(tree, plan.timed, 0, plan.timed.size(), SCAN_LENGTH);
+    }
+
+    PerfCounters counters;
+    Result result;
+    result.seconds = 0;
+    result.ops = 0;
+    result.checksum = 0;
+    for(int c = 0; c < PerfCounters::NUM_COUNTERS; ++c) result.counts[c] = 0;
+    do {
+        Tree tree;
+        applyOps(tree, plan.prefill, 0, plan.prefill.size());
+        counters.start();
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        result.checksum += applyOps(tree, plan.timed, 0, plan.timed.size(), SCAN_LENGTH);
+        chrono::steady_clock::time_point stop = chrono::steady_clock::now();
+        counters.stop();
+        result.seconds += chrono::duration<double>(stop - start).count();
+        result.ops += plan.timed.size() * plan.opsPerUnit;
+        for(int c = 0; c < PerfCounters::NUM_COUNTERS; ++c) {
+            result.counts[c] += (double)counters.value((PerfCounters::Counter)c);
+        }
+    } while(result.ops < MIN_OPS);
+    for(int c = 0; c < PerfCounters::NUM_COUNTERS; ++c) {
+        result.counted[c] = counters.has((PerfCounters::Counter)c);
+    }
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    result.peakRssKb = usage.ru_maxrss;
+    return result;
+}
+
+/**
+ * Runs one cell in a child process and reads its Result back through a
+ * pipe. Returns false if the child failed.
+ */
+static bool runCell(const string& tree, const string& workload, size_t n, const Options& options, Result& result)
+{
+    int fds[2];
+    if(pipe(fds) != 0) return false;
+    pid_t pid = fork();
+    if(pid < 0) return false;
+    if(pid == 0) {
+        close(fds[0]);
+        if(options.cpu >= 0) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(options.cpu, &set);
+            if(sched_setaffinity(0, sizeof(set), &set) != 0) _exit(1);
+        }
+        Plan plan = makePlan(workload, n);
+        Result r;
+        if(tree == "bst") r = runPlan<BinarySearchTree<int, int> >(plan, options.warmup);
+        else if(tree == "avl") r = runPlan<AVLTree<int, int> >(plan, options.warmup);
+        else if(tree == "avl-pool") r = runPlan<SmallPageAVLTree>(plan, options.warmup);
+        else if(tree == "avl-huge") r = runPlan<PooledAVLTree<int, int> >(plan, options.warmup);
+        else r = runPlan<StdMap>(plan, options.warmup);
+        ssize_t written = write(fds[1], &r, sizeof(r));
+        _exit(written == (ssize_t)sizeof(r) ? 0 : 1);
+    }
+    close(fds[1]);
+    ssize_t got = read(fds[0], &result, sizeof(result));
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return got == (ssize_t)sizeof(result) and WIFEXITED(status) and WEXITSTATUS(status) == 0;
+}
+
+/**
+ * Two-sided 95% Student t quantile for the given degrees of freedom.
+ */
+static double tQuantile95(int df)
+{
+    static const double table[] = {
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+    };
+    if(df < 1) return 0;
+    return (df <= 30) ? table[df - 1] : 1.96;
+}
+
+/**
+ * Runs the cells of one workload and size, one per tree, options.repeat
+ * times each. The repetitions are interleaved (every tree once, then
+ * every tree again) so that a burst of outside load hits all trees alike
+ * rather than all repetitions of one. Returns false, naming the cell, if
+ * any repetition failed.
+ */
+static bool measureCells(const vector<string>& trees, const string& workload, size_t n, const Options& options,
+                         vector<Row>& rows)
+{
+    rows.assign(trees.size(), Row());
+    vector<vector<double> > samples(trees.size());
+    vector<vector<double> > counts(trees.size(), vector<double>(PerfCounters::NUM_COUNTERS, 0));
+    vector<vector<bool> > counted(trees.size(), vector<bool>(PerfCounters::NUM_COUNTERS, true));
+    for(size_t t = 0; t < trees.size(); ++t) {
+        rows[t].tree = trees[t];
+        rows[t].workload = workload;
+        rows[t].size = n;
+        rows[t].reps = options.repeat;
+        rows[t].peakRssKb = 0;
+    }
+    for(int rep = 0; rep < options.repeat; ++rep) {
+        for(size_t t = 0; t < trees.size(); ++t) {
+            Result r;
+            if(!runCell(trees[t], workload, n, options, r)) {
+                cerr << "bench: " << trees[t] << " " << workload << " " << n << " failed" << endl;
+                return false;
+            }
+            rows[t].ops = r.ops;
+            rows[t].peakRssKb = max(rows[t].peakRssKb, r.peakRssKb);
+            samples[t].push_back(r.seconds * 1e9 / r.ops);
+            for(int c = 0; c < PerfCounters::NUM_COUNTERS; ++c) {
+                counted[t][c] = counted[t][c] and r.counted[c];
+                counts[t][c] += r.counts[c] / r.ops;
+            }
+        }
+    }
+
+    for(size_t t = 0; t < trees.size(); ++t) {
+        Row& row = rows[t];
+        double sum = 0;
+        for(size_t i = 0; i < samples[t].size(); ++i) sum += samples[t][i];
+        row.nsPerOp = sum / samples[t].size();
+        double squares = 0;
+        for(size_t i = 0; i < samples[t].size(); ++i) {
+            squares += (samples[t][i] - row.nsPerOp) * (samples[t][i] - row.nsPerOp);
+        }
+        int df = (int)samples[t].size() - 1;
+        row.ci95 = (df > 0) ? tQuantile95(df) * sqrt(squares / df) / sqrt((double)samples[t].size()) : 0;
+        row.bestNsPerOp = *min_element(samples[t].begin(), samples[t].end());
+        for(int c = 0; c < PerfCounters::NUM_COUNTERS; ++c) {
+            row.perOp[c] = counted[t][c] ? counts[t][c] / options.repeat : -1;
+        }
+    }
+    return true;
+}
+
+static string cellName(const string& tree, const string& workload, size_t size)
+{
+    stringstream ss;
+    ss << tree << "," << workload << "," << size;
+    return ss.str();
+}
+
+static void writeCsvHeader(ostream& out)
+{
+    out << "tree,workload,size,ops,reps,ns_per_op,ci95_ns,best_ns_per_op,ops_per_sec,peak_rss_kb,"
+        << "cycles_per_op,cache_misses_per_op,branch_misses_per_op,dtlb_misses_per_op,node_misses_per_op" << endl;
+}
+
+static void writeCsvRow(ostream& out, const Row& row)
+{
+    out << cellName(row.tree, row.workload, row.size) << "," << row.ops << "," << row.reps << ","
+        << fixed << setprecision(2) << row.nsPerOp << "," << row.ci95 << "," << row.bestNsPerOp << ","
+        << setprecision(0) << 1e9 / row.nsPerOp << "," << row.peakRssKb;
+    out << setprecision(3);
+    for(int c = 0; c < PerfCounters::NUM_COUNTERS; ++c) {
+        out << ",";
+        if(row.perOp[c] >= 0) out << row.perOp[c];
+    }
+    out << endl;
+}
+
+static void writeJsonRow(ostream& out, const Row& row, bool first)
+{
+    static const char* counterNames[PerfCounters::NUM_COUNTERS] = {
+        "cycles_per_op", "cache_misses_per_op", "branch_misses_per_op", "dtlb_misses_per_op", "node_misses_per_op"
+    };
+    out << (first ? "  " : ", ") << "{\"tree\": \"" << row.tree << "\", \"workload\": \""
+        << row.workload << "\", \"size\": " << row.size << ", \"ops\": " << row.ops
+        << ", \"reps\": " << row.reps << fixed << setprecision(2) << ", \"ns_per_op\": " << row.nsPerOp
+        << ", \"ci95_ns\": " << row.ci95 << ", \"best_ns_per_op\": " << row.bestNsPerOp << setprecision(0) << ", \"ops_per_sec\": " << 1e9 / row.nsPerOp
+        << ", \"peak_rss_kb\": " << row.peakRssKb << setprecision(3);
+    for(int c = 0; c < PerfCounters::NUM_COUNTERS; ++c) {
+        if(row.perOp[c] >= 0) out << ", \"" << counterNames[c] << "\": " << row.perOp[c];
+    }
+    out << "}" << endl;
+}
+
+/**
+ * Reads a CSV written by --save-baseline into cell name -> row (only the
+ * fields the comparison needs). Returns false if the file cannot be read
+ * or was written with different columns than this build writes.
+ */
+static bool readBaseline(const string& path, map<string, Row>& rows)
+{
+    ifstream in(path.c_str());
+    if(!in) return false;
+    string line;
+    getline(in, line);
+    stringstream header;
+    writeCsvHeader(header);
+    if(line + "\n" != header.str()) {
+        cerr << "bench: " << path << " has different columns than this build, rerun make bench-baseline" << endl;
+        return false;
+    }
+    while(getline(in, line)) {
+        vector<string> fields;
+        stringstream ss(line);
+        string field;
+        while(getline(ss, field, ',')) fields.push_back(field);
+        if(fields.size() < 8) continue;
+        Row row;
+        row.tree = fields[0];
+        row.workload = fields[1];
+        row.size = (size_t)atoll(fields[2].c_str());
+        row.nsPerOp = atof(fields[5].c_str());
+        row.ci95 = atof(fields[6].c_str());
+        row.bestNsPerOp = atof(fields[7].c_str());
+        rows[cellName(row.tree, row.workload, row.size)] = row;
+    }
+    return true;
+}
+
+/**
+ * Fastest ns/op of a cell divided by that of the std::map control with the same
+ * workload and size in the same run, or a negative value if the run has
+ * no such control.
+ */
+static double controlRatio(const Row& row, const map<string, Row>& cells)
+{
+    map<string, Row>::const_iterator control = cells.find(cellName("map", row.workload, row.size));
+    if(control == cells.end() or control->second.bestNsPerOp <= 0) return -1;
+    return row.bestNsPerOp / control->second.bestNsPerOp;
+}
+
+/**
+ * Prints a comparison table to stderr and returns the number of cells that
+ * regressed. Absolute times do not carry over between machines, so each
+ * cell is compared as a ratio to the std::map control of its own run: a
+ * cell regressed if that ratio grew by more than threshold percent. The
+ * map cells themselves are only the yardstick, and a cell without a
+ * control on both sides is reported but never fails the check.
+ */
+static int compareWithBaseline(const vector<Row>& rows, const map<string, Row>& baseline, double threshold)
+{
+    map<string, Row> current;
+    for(size_t i = 0; i < rows.size(); ++i) {
+        current[cellName(rows[i].tree, rows[i].workload, rows[i].size)] = rows[i];
+    }
+    int regressions = 0;
+    cerr << left << setw(34) << "cell" << right << setw(16) << "baseline ratio" << setw(16) << "current ratio"
+         << setw(10) << "change" << "  verdict" << endl;
+    for(size_t i = 0; i < rows.size(); ++i) {
+        const Row& row = rows[i];
+        string name = cellName(row.tree, row.workload, row.size);
+        map<string, Row>::const_iterator it = baseline.find(name);
+        cerr << left << setw(34) << name << right << fixed << setprecision(3);
+        if(row.tree == "map") {
+            cerr << setw(16) << "-" << setw(16) << "-" << setw(10) << "-" << "  control" << endl;
+            continue;
+        }
+        double now = controlRatio(row, current);
+        double then = (it == baseline.end()) ? -1 : controlRatio(it->second, baseline);
+        if(it == baseline.end() or now < 0 or then < 0) {
+            cerr << setw(16) << "-" << setw(16) << "-" << setw(10) << "-"
+                 << (it == baseline.end() ? "  new" : "  no control") << endl;
+            continue;
+        }
+        double change = (now - then) / then * 100;
+        const char* verdict = "ok";
+        if(change > threshold) {
+            verdict = "REGRESSED";
+            ++regressions;
+        }
+        else if(change < -threshold) {
+            verdict = "improved";
+        }
+        cerr << setw(16) << then << setw(16) << now << setprecision(1)
+             << setw(9) << showpos << change << noshowpos << "%  " << verdict << endl;
+    }
+    if(regressions) {
+        cerr << setprecision(1) << regressions << " cell(s) regressed by more than " << threshold << "% against std::map"
+             << endl;
+    }
+    return regressions;
+}
+
+static vector<string> splitList(const string& text)
+{
+    vector<string> items;
+    stringstream ss(text);
+    string item;
+    while(getline(ss, item, ',')) {
+        if(!item.empty()) items.push_back(item);
+    }
+    return items;
+}
+
+static bool knownWorkload(const string& name)
+{
+    for(size_t w = 0; w < sizeof(WORKLOADS) / sizeof(WORKLOADS[0]); ++w) {
+        if(name == WORKLOADS[w].name) return true;
+    }
+    return false;
+}
+
+static void usage()
+{
+    cerr << "usage: bench [--sizes=N,...] [--trees=bst,avl,avl-pool,avl-huge,map] [--workloads=W,...] [--format=csv|json]" << endl;
+    cerr << "             [--repeat=N] [--warmup=N] [--cpu=K]" << endl;
+    cerr << "             [--baseline=FILE] [--save-baseline=FILE] [--threshold=PCT]" << endl;
+    cerr << "workloads:" << endl;
+    for(size_t w = 0; w < sizeof(WORKLOADS) / sizeof(WORKLOADS[0]); ++w) {
+        cerr << "  " << left << setw(14) << WORKLOADS[w].name << WORKLOADS[w].description << endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    vector<string> sizes = splitList("1000,10000,100000,1000000");
+    vector<string> trees = splitList("bst,avl,map");
+    vector<string> workloads;
+    for(size_t w = 0; w < sizeof(WORKLOADS) / sizeof(WORKLOADS[0]); ++w) workloads.push_back(WORKLOADS[w].name);
+    string format = "csv";
+    Options options;
+    options.repeat = 1;
+    options.warmup = 0;
+    options.cpu = -1;
+    options.threshold = 5;
+
+    for(int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        size_t eq = arg.find('=');
+        string name = arg.substr(0, eq);
+        string value = (eq == string::npos) ? "" : arg.substr(eq + 1);
+        if(name == "--sizes") sizes = splitList(value);
+        else if(name == "--trees") trees = splitList(value);
+        else if(name == "--workloads") workloads = splitList(value);
+        else if(name == "--format") format = value;
+        else if(name == "--repeat") options.repeat = atoi(value.c_str());
+        else if(name == "--warmup") options.warmup = atoi(value.c_str());
+        else if(name == "--cpu") options.cpu = atoi(value.c_str());
+        else if(name == "--threshold") options.threshold = atof(value.c_str());
+        else if(name == "--baseline") options.baseline = value;
+        else if(name == "--save-baseline") options.saveBaseline = value;
+        else { usage(); return 2; }
+    }
+    for(size_t w = 0; w < workloads.size(); ++w) {
+        if(!knownWorkload(workloads[w])) { usage(); return 2; }
+    }
+    for(size_t t = 0; t < trees.size(); ++t) {
+        if(trees[t] != "bst" and trees[t] != "avl" and trees[t] != "avl-pool" and trees[t] != "avl-huge" and
+           trees[t] != "map") { usage(); return 2; }
+    }
+    if((format != "csv" and format != "json") or options.repeat < 1 or options.warmup < 0) { usage(); return 2; }
+
+    if(!options.baseline.empty() and find(trees.begin(), trees.end(), "map") == trees.end()) {
+        cerr << "bench: --baseline needs the map control in --trees" << endl;
+        return 2;
+    }
+    map<string, Row> baseline;
+    if(!options.baseline.empty() and !readBaseline(options.baseline, baseline)) {
+        cerr << "bench: cannot read baseline " << options.baseline << endl;
+        return 2;
+    }
+
+    bool json = (format == "json");
+    int failures = 0;
+    vector<Row> rows;
+    if(json) cout << "[" << endl;
+    else writeCsvHeader(cout);
+    for(size_t s = 0; s < sizes.size(); ++s) {
+        size_t n = (size_t)atoll(sizes[s].c_str());
+        if(n == 0) continue;
+        for(size_t w = 0; w < workloads.size(); ++w) {
+            vector<string> cellTrees;
+            for(size_t t = 0; t < trees.size(); ++t) {
+                if(trees[t] == "bst" and n > (size_t)BST_DEGENERATE_LIMIT and
+                   (workloads[w] == "sorted" or workloads[w] == "reverse")) {
+                    continue;
+                }
+                cellTrees.push_back(trees[t]);
+            }
+            vector<Row> cells;
+            if(!measureCells(cellTrees, workloads[w], n, options, cells)) {
+                ++failures;
+                continue;
+            }
+            for(size_t t = 0; t < cells.size(); ++t) {
+                if(json) writeJsonRow(cout, cells[t], rows.empty());
+                else writeCsvRow(cout, cells[t]);
+                rows.push_back(cells[t]);
+            }
+        }
+    }
+    if(json) cout << "]" << endl;
+
+    if(!options.saveBaseline.empty()) {
+        ofstream out(options.saveBaseline.c_str());
+        writeCsvHeader(out);
+        for(size_t i = 0; i < rows.size(); ++i) writeCsvRow(out, rows[i]);
+        if(!out) {
+            cerr << "bench: cannot write baseline " << options.saveBaseline << endl;
+            ++failures;
+        }
+    }
+    if(!options.baseline.empty() and compareWithBaseline(rows, baseline, options.threshold) > 0) {
+        return 1;
+    }
+    return failures ? 1 : 0;
+}
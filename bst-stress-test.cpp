@@ -0,0 +1,78 @@
+#include <iostream>
+#include <cstdlib>
+#include "bst.h"
+#include "avlbst.h"
+#include "test-helpers.h"
+
+using namespace std;
+
+/**
+ * Links sorted keys straight into a degenerate chain in O(n), which is what
+ * inserting them one at a time would produce in O(n^2).
+ */
+class ChainTree : public BinarySearchTree<int, int>
+{
+public:
+    void buildChain(int n, bool rightLeaning)
+    {
+        clear();
+        Node<int, int>* last = NULL;
+        for(int i = 0; i < n; ++i) {
+            int key = rightLeaning ? i : n - i;
+            Node<int, int>* node = new Node<int, int>(key, i, last);
+            if(last == NULL) root_ = node;
+            else if(rightLeaning) last->setRight(node);
+            else last->setLeft(node);
+            last = node;
+        }
+    }
+
+    int height() const { return getHeight(root_); }
+};
+
+int main(int argc, char *argv[])
+{
+    int n = (argc > 1) ? atoi(argv[1]) : 10000000;
+
+    {
+        ChainTree tree;
+        tree.buildChain(n, true);
+        check(tree.height() == n, "Height of right-leaning chain");
+        check(!tree.isBalanced(), "Right-leaning chain is unbalanced");
+        TreeShape<int, int> shape = tree.analyzeShape();
+        check(shape.nodeCount == (size_t)n && shape.height == n && shape.minLeafDepth == n &&
+              shape.worstImbalance == n - 1 && shape.balanceCount(shape.BALANCE_RANGE) == (size_t)n - shape.BALANCE_RANGE,
+              "Linear-time shape of right-leaning chain");
+        tree.clear();
+        check(tree.empty(), "Clear right-leaning chain");
+
+        tree.buildChain(n, false);
+        check(tree.height() == n, "Height of left-leaning chain");
+        check(!tree.isBalanced(), "Left-leaning chain is unbalanced");
+        // destructor tears down the left-leaning chain
+    }
+    cout << "Destroy left-leaning chain: passed" << endl;
+
+    {
+        // Sorted inserts and removes drive insertFix/removeFix over
+        // long runs of rebalancing.
+        int avlN = n / 10;
+        AVLTree<int, int> tree;
+        for(int i = 0; i < avlN; ++i) {
+            tree.insert(make_pair(i, i));
+        }
+        check(tree.isBalanced(), "AVL sorted inserts stay balanced");
+        for(int i = 0; i < avlN; i += 2) {
+            tree.remove(i);
+        }
+        check(tree.isBalanced(), "AVL after removing every other key");
+        int expected = 1;
+        bool ordered = true;
+        for(AVLTree<int, int>::iterator it = tree.begin(); it != tree.end(); ++it, expected += 2) {
+            if(it->first != expected) ordered = false;
+        }
+        check(ordered && expected == avlN + 1, "AVL contents");
+    }
+
+    return failures() == 0 ? 0 : 1;
+}
@@ -1,10 +1,104 @@
 #include <iostream>
 #include <map>
+#include <set>
+#include <vector>
+#include <cstdlib>
+#include <string>
+#include <stdexcept>
 #include "bst.h"
 #include "avlbst.h"
+#include "rbbst.h"
+#include "splay.h"
+#include "scapegoat.h"
+#include "augmented-avl.h"
+#include "interval-tree.h"
+#include "hash-indexed-avl.h"
+#include "test-helpers.h"
 
 using namespace std;
 
+/**
+ * Exposes the root so the test can check the red-black properties.
+ */
+template<typename Key, typename Value>
+class CheckedRBTree : public RBTree<Key, Value>
+{
+public:
+    // Returns the black height, or -1 if a property is violated.
+    int blackHeight(RBNode<Key, Value>* node) const
+    {
+        if(node == nullptr) return 1;
+        if(node->getColor() == RBNode<Key, Value>::RED &&
+           ((node->getLeft() != nullptr && node->getLeft()->getColor() == RBNode<Key, Value>::RED) ||
+            (node->getRight() != nullptr && node->getRight()->getColor() == RBNode<Key, Value>::RED))) {
+            return -1;
+        }
+        int left = blackHeight(node->getLeft());
+        int right = blackHeight(node->getRight());
+        if(left == -1 || left != right) return -1;
+        return left + (node->getColor() == RBNode<Key, Value>::BLACK ? 1 : 0);
+    }
+
+    bool valid() const
+    {
+        RBNode<Key, Value>* root = static_cast<RBNode<Key, Value>*>(this->root_);
+        return (root == nullptr || root->getColor() == RBNode<Key, Value>::BLACK) && blackHeight(root) != -1;
+    }
+};
+
+/**
+ * Exposes the height of a scapegoat tree.
+ */
+template<typename Key, typename Value>
+class CheckedScapegoatTree : public ScapegoatTree<Key, Value>
+{
+public:
+    CheckedScapegoatTree(double alpha) : ScapegoatTree<Key, Value>(alpha) {}
+    int height() const { return this->getHeight(this->root_); }
+};
+
+/**
+ * Whether two trees hold the same items in the same shape, with correct
+ * stored balances in the second.
+ */
+template<typename Tree>
+bool sameTree(const Tree& a, const Tree& b)
+{
+    typename Tree::iterator x = a.begin();
+    typename Tree::iterator y = b.begin();
+    for(; x != a.end() && y != b.end(); ++x, ++y) {
+        if(x->first != y->first || x->second != y->second) return false;
+    }
+    TreeShape<typename Tree::key_type, typename Tree::mapped_type> sa = a.analyzeShape();
+    TreeShape<typename Tree::key_type, typename Tree::mapped_type> sb = b.analyzeShape();
+    return x == a.end() && y == b.end() && sa.nodeCount == sb.nodeCount && sa.height == sb.height &&
+           sa.averageDepth == sb.averageDepth && sb.balanceMismatches == 0;
+}
+
+/**
+ * Every node goes through createNode/destroyNode, so with
+ * CountingTreeStats the counts match the keys inserted and removed, and a
+ * std::greater tree iterates in descending order.
+ */
+template<typename Tree>
+bool countsEveryNode(Tree& tree)
+{
+    for(int i = 0; i < 100; ++i) {
+        tree.insert(std::make_pair(i, i));
+        tree.insert(std::make_pair(i, -i));   // overwrite: no allocation
+    }
+    for(int i = 0; i < 100; i += 2) {
+        tree.remove(i);
+    }
+    bool ok = tree.stats().allocations == 100 && tree.stats().deallocations == 50;
+    int last = 100;
+    for(typename Tree::iterator it = tree.begin(); it != tree.end() && ok; ++it) {
+        ok = it->first < last && it->first % 2 == 1 && it->second == -it->first;
+        last = it->first;
+    }
+    tree.clear();
+    return ok && last == 1 && tree.stats().deallocations == 100;
+}
 
 int main(int argc, char *argv[])
 {
@@ -44,5 +138,380 @@ int main(int argc, char *argv[])
     cout << "Erasing b" << endl;
     at.remove('b');
 
-    return 0;
+    // Red-Black Tree tests
+    CheckedRBTree<char,int> rt;
+    rt.insert(std::make_pair('a',1));
+    rt.insert(std::make_pair('b',2));
+
+    cout << "\nRBTree contents:" << endl;
+    for(RBTree<char,int>::iterator it = rt.begin(); it != rt.end(); ++it) {
+        cout << it->first << " " << it->second << endl;
+    }
+    cout << "Erasing b" << endl;
+    rt.remove('b');
+
+    // Randomized comparison against std::map, two inserts to a remove
+    cout << endl;
+    OpMix mix(1, 2, 0, 0);
+    BinarySearchTree<int,int> randomBst;
+    AVLTree<int,int> randomAvl;
+    CheckedRBTree<int,int> randomRb;
+    bool bstOk = matchesMap(randomBst, 1, 5000, 500, mix);
+    bool avlOk = matchesMap(randomAvl, 2, 5000, 500, mix) && randomAvl.isBalanced();
+    bool rbOk = matchesMap(randomRb, 3, 5000, 500, mix) && randomRb.valid();
+    SplayTree<int,int> randomSplay;
+    SplayTree<int,int> randomSemiSplay(SplayTree<int,int>::SEMI);
+    bool splayOk = matchesMap(randomSplay, 4, 5000, 500, mix) && matchesMap(randomSemiSplay, 5, 5000, 500, mix);
+    // a lookup moves the key to the root, so it is found again first thing
+    randomSplay.find(randomSplay.begin()->first);
+    splayOk = splayOk && randomSplay.find(-1) == randomSplay.end();
+    CheckedScapegoatTree<int,int> randomScapegoat(0.6);
+    bool scapegoatOk = matchesMap(randomScapegoat, 6, 5000, 500, mix);
+    CheckedScapegoatTree<int,int> sortedScapegoat(0.6);
+    for(int i = 0; i < 4096; ++i) {
+        sortedScapegoat.insert(std::make_pair(i, i));
+    }
+    // depth limit is log_{1/0.6}(4096) = 16, i.e. at most 17 levels
+    scapegoatOk = scapegoatOk && sortedScapegoat.height() <= 17 && sortedScapegoat.size() == 4096;
+    // Shape analysis: 4 <- 2 -> (1, 3), 4 -> 6 -> 5
+    BinarySearchTree<int,int> shaped;
+    int shapeKeys[] = { 4, 2, 6, 1, 3, 5 };
+    for(int i = 0; i < 6; ++i) {
+        shaped.insert(std::make_pair(shapeKeys[i], i));
+    }
+    TreeShape<int,int> shape = shaped.analyzeShape();
+    bool shapeOk = shape.nodeCount == 6 && shape.height == 3 && shape.minLeafDepth == 3 &&
+                   shape.maxLeafDepth == 3 && shape.worstImbalance == 1 &&
+                   shape.worstNode->getKey() == 6 && shape.balanceCount(0) == 5 &&
+                   shape.balanceCount(-1) == 1 && shape.averageDepth == 14.0 / 6;
+    TreeShape<int,int> avlShape = randomAvl.analyzeShape();
+    shapeOk = shapeOk && avlShape.balanceMismatches == 0 && avlShape.worstImbalance <= 1;
+    // Operation counters: 1..7 ascending needs four single rotations and
+    // ends up perfectly balanced with 4 at the root
+    AVLTree<int,int,std::less<int>,CountingTreeStats> counted;
+    for(int i = 1; i <= 7; ++i) {
+        counted.insert(std::make_pair(i, i));
+    }
+    bool statsOk = counted.stats().rotations == 4 && counted.stats().allocations == 7;
+    counted.insert(std::make_pair(3, 30));   // existing key: no allocation
+    counted.resetStats();
+    counted.find(4);
+    statsOk = statsOk && counted.stats().visits == 1 && counted.stats().comparisons == 2;
+    for(AVLTree<int,int,std::less<int>,CountingTreeStats>::iterator it = counted.begin(); it != counted.end(); ++it) {}
+    statsOk = statsOk && counted.stats().iteratorSteps == 7 && counted.stats().allocations == 0;
+    counted.remove(4);
+    counted.clear();
+    statsOk = statsOk && counted.stats().deallocations == 7;
+    BinarySearchTree<int,int,std::less<int>,CountingTreeStats> countedBst;
+    countedBst.insert(std::make_pair(2, 2));
+    countedBst.insert(std::make_pair(1, 1));
+    countedBst.insert(std::make_pair(3, 3));
+    statsOk = statsOk && countedBst.stats().allocations == 3 && countedBst.stats().rotations == 0 &&
+              countedBst.stats().comparisons == 3;
+    RBTree<int,int,std::greater<int>,CountingTreeStats> countedRb;
+    SplayTree<int,int,std::greater<int>,CountingTreeStats> countedSplay(SplayTree<int,int,std::greater<int>,CountingTreeStats>::SEMI);
+    ScapegoatTree<int,int,std::greater<int>,CountingTreeStats> countedScapegoat;
+    statsOk = statsOk && countsEveryNode(countedRb) && countsEveryNode(countedSplay) &&
+              countsEveryNode(countedScapegoat) && countedRb.stats().rotations > 0;
+    // a splaying find descends once, even when SEMI leaves the node below the root
+    for(int i = 0; i < 64; ++i) countedSplay.insert(std::make_pair(i, i));
+    countedSplay.resetStats();
+    const SplayTree<int,int,std::greater<int>,CountingTreeStats>& constSplay = countedSplay;
+    constSplay.find(0);   // const: no splay, just the path length
+    size_t pathVisits = countedSplay.stats().visits;
+    countedSplay.resetStats();
+    statsOk = statsOk && countedSplay.find(0)->second == 0 && countedSplay.stats().visits == pathVisits;
+    // the default policy adds nothing to iterators
+    statsOk = statsOk && sizeof(BinarySearchTree<int,int>::iterator) == sizeof(Node<int,int>*);
+    // Comparators: a three-way one decides each node with a single call,
+    // and a transparent one looks std::string keys up by C string
+    AVLTree<string,int,StringThreeWayCompare,CountingTreeStats> words;
+    const char* wordList[] = { "pear", "apple", "fig", "plum", "kiwi", "lime", "date" };
+    for(int i = 0; i < 7; ++i) {
+        words.insert(std::make_pair(string(wordList[i]), i));
+    }
+    words.resetStats();
+    bool compareOk = words.find("kiwi") != words.end() && words.find("kiwi")->second == 4 &&
+                     words.find("grape") == words.end();
+    compareOk = compareOk && words.stats().comparisons == words.stats().visits;
+    // a two-way comparator on string keys walks to the bottom and checks
+    // equality once there: height + 1 comparisons
+    AVLTree<string,int,std::less<string>,CountingTreeStats> lessWords;
+    for(int i = 0; i < 7; ++i) {
+        lessWords.insert(std::make_pair(string(wordList[i]), i));
+    }
+    lessWords.resetStats();
+    compareOk = compareOk && lessWords.find("pear")->second == 0 &&
+                lessWords.stats().comparisons == lessWords.stats().visits + 1;
+    compareOk = compareOk && words.lower_bound("grape")->first == "kiwi" &&
+                words.lower_bound("zzz") == words.end() && words.lower_bound(string("a"))->first == "apple";
+    BinarySearchTree<string,int,TransparentLess> byLess;
+    byLess.insert(std::make_pair(string("b"), 2));
+    byLess.insert(std::make_pair(string("a"), 1));
+    compareOk = compareOk && byLess.find("a")->second == 1 && byLess.find("c") == byLess.end();
+    AVLTree<int,int,std::greater<int> > descending;
+    for(int i = 0; i < 10; ++i) {
+        descending.insert(std::make_pair(i, i));
+    }
+    int last = 10;
+    for(AVLTree<int,int,std::greater<int> >::iterator it = descending.begin(); it != descending.end(); ++it) {
+        compareOk = compareOk && it->first == last - 1;
+        last = it->first;
+    }
+    compareOk = compareOk && last == 0 && descending.isBalanced() && descending.lower_bound(5)->first == 5;
+    descending.remove(5);
+    compareOk = compareOk && descending.lower_bound(5)->first == 4;
+    // Sets: insert reports whether the key was new, and the nodes carry
+    // no value at all
+    AVLSet<int> avlSet;
+    BSTSet<int> bstSet;
+    set<int> expectedSet;
+    srand(7);
+    bool setOk = true;
+    for(int i = 0; i < 5000; ++i) {
+        int key = rand() % 500;
+        if(rand() % 3 == 0) {
+            avlSet.remove(key);
+            bstSet.remove(key);
+            expectedSet.erase(key);
+        }
+        else {
+            bool added = expectedSet.insert(key).second;
+            setOk = setOk && avlSet.insert(key) == added && bstSet.insert(key) == added;
+        }
+        setOk = setOk && avlSet.contains(i % 500) == (expectedSet.count(i % 500) == 1);
+    }
+    set<int>::iterator se = expectedSet.begin();
+    for(AVLSet<int>::iterator it = avlSet.begin(); it != avlSet.end(); ++it, ++se) {
+        setOk = setOk && se != expectedSet.end() && *it == *se;
+    }
+    setOk = setOk && se == expectedSet.end() && avlSet.isBalanced() &&
+            avlSet.analyzeShape().balanceMismatches == 0 && bstSet.analyzeShape().nodeCount == expectedSet.size();
+    // the balance byte fits in the padding after the key
+    setOk = setOk && sizeof(AVLNode<int, SetMarker>) < sizeof(AVLNode<int, bool>);
+    // Augmented trees: range aggregates and prefix searches against brute
+    // force over a std::map after every batch of random updates
+    AugmentedAVLTree<int,long,SumMonoid<long> > sums;
+    AugmentedAVLTree<int,long,MinMonoid<long> > mins;
+    map<int,long> plain;
+    srand(8);
+    bool augmentedOk = true;
+    for(int i = 0; i < 20000 && augmentedOk; ++i) {
+        int key = rand() % 1000;
+        if(rand() % 3 == 0) {
+            sums.remove(key);
+            mins.remove(key);
+            plain.erase(key);
+        }
+        else {
+            long value = rand() % 100;
+            sums.insert(std::make_pair(key, value));
+            mins.insert(std::make_pair(key, value));
+            plain[key] = value;
+        }
+        if(i % 100 != 0) continue;
+        int lo = rand() % 1000;
+        int hi = lo + rand() % 300;
+        long sum = 0;
+        long low = std::numeric_limits<long>::max();
+        for(map<int,long>::iterator it = plain.lower_bound(lo); it != plain.end() && it->first < hi; ++it) {
+            sum += it->second;
+            low = std::min(low, it->second);
+        }
+        long limit = rand() % 20000;
+        long running = 0;
+        map<int,long>::iterator first = plain.begin();
+        while(first != plain.end() && (running += first->second) <= limit) ++first;
+        AugmentedAVLTree<int,long,SumMonoid<long> >::iterator found = sums.firstPrefixExceeding(limit);
+        augmentedOk = sums.aggregate(lo, hi) == sum && mins.aggregate(lo, hi) == low &&
+                      (first == plain.end() ? found == sums.end() : (found != sums.end() && found->first == first->first)) &&
+                      sums.isBalanced();
+    }
+    long expectedTotal = 0;
+    for(map<int,long>::iterator it = plain.begin(); it != plain.end(); ++it) expectedTotal += it->second;
+    augmentedOk = augmentedOk && sums.total() == expectedTotal && sums.aggregate(5, 5) == 0;
+    // update() refreshes the summaries above the changed value
+    for(map<int,long>::iterator it = plain.begin(); it != plain.end(); ++it) {
+        if(it->first % 7 != 0) continue;
+        it->second -= 1000;
+        sums.update(it->first, it->second);
+        mins.update(it->first, it->second);
+    }
+    long updatedSum = 0;
+    long updatedLow = std::numeric_limits<long>::max();
+    for(map<int,long>::iterator it = plain.lower_bound(200); it != plain.end() && it->first < 700; ++it) {
+        updatedSum += it->second;
+        updatedLow = std::min(updatedLow, it->second);
+    }
+    bool updateThrew = false;
+    try {
+        sums.update(1000, 1);
+    }
+    catch(const std::out_of_range&) {
+        updateThrew = true;
+    }
+    augmentedOk = augmentedOk && sums.aggregate(200, 700) == updatedSum && mins.aggregate(200, 700) == updatedLow &&
+                  updateThrew && sums[plain.begin()->first] == plain.begin()->second;
+    // Interval queries against brute force, through inserts and removes
+    IntervalTree<int,int> intervals;
+    map<pair<int,int>,int> intervalSet;
+    srand(9);
+    bool intervalOk = true;
+    const IntervalTree<int,int>::item_type* hits[64];
+    for(int i = 0; i < 6000 && intervalOk; ++i) {
+        int start = rand() % 10000;
+        int end = start + rand() % 200;
+        if(rand() % 4 == 0 && !intervalSet.empty()) {
+            map<pair<int,int>,int>::iterator victim = intervalSet.lower_bound(make_pair(start, 0));
+            if(victim == intervalSet.end()) victim = intervalSet.begin();
+            intervals.remove(victim->first.first, victim->first.second);
+            intervalSet.erase(victim);
+        }
+        else {
+            intervals.insert(start, end, i);
+            intervalSet[make_pair(start, end)] = i;
+        }
+        if(i % 50 != 0) continue;
+        int lo = rand() % 10000;
+        int hi = lo + rand() % 100;
+        vector<pair<int,int> > expectedHits;
+        for(map<pair<int,int>,int>::iterator it = intervalSet.begin(); it != intervalSet.end(); ++it) {
+            if(it->first.first <= hi && it->first.second >= lo) expectedHits.push_back(it->first);
+        }
+        size_t n = intervals.overlaps(lo, hi, hits, 64);
+        intervalOk = n == std::min<size_t>(expectedHits.size(), 64);
+        for(size_t h = 0; intervalOk && h < n; ++h) {
+            intervalOk = hits[h]->first.start == expectedHits[h].first && hits[h]->first.end == expectedHits[h].second;
+        }
+        size_t stabbed = intervals.stab(lo, hits, 64);
+        size_t expectedStabbed = 0;
+        for(size_t h = 0; h < expectedHits.size(); ++h) {
+            if(expectedHits[h].first <= lo) ++expectedStabbed;
+        }
+        intervalOk = intervalOk && stabbed == std::min<size_t>(expectedStabbed, 64) && intervals.isBalanced();
+    }
+    intervalOk = intervalOk && intervals.overlaps(0, 20000, hits, 3) == 3 && intervals.overlaps(-5, -1, hits, 64) == 0;
+
+    // Hash-indexed AVL tree against std::map: point lookups through the
+    // table, order through the tree
+    HashIndexedAVLTree<int,int> indexed(2);
+    map<int,int> indexedMap;
+    srand(10);
+    bool indexedOk = true;
+    for(int i = 0; i < 20000 && indexedOk; ++i) {
+        int key = rand() % 3000;
+        if(rand() % 3 == 0) {
+            indexed.remove(key);
+            indexedMap.erase(key);
+        }
+        else {
+            indexed.insert(make_pair(key, i));
+            indexedMap[key] = i;
+        }
+        int probe = rand() % 3000;
+        map<int,int>::iterator e = indexedMap.find(probe);
+        HashIndexedAVLTree<int,int>::iterator it = indexed.find(probe);
+        indexedOk = (it == indexed.end()) == (e == indexedMap.end()) && (e == indexedMap.end() || it->second == e->second)
+                    && indexed.contains(probe) == (e != indexedMap.end());
+    }
+    indexedOk = indexedOk && indexed.size() == indexedMap.size() && indexed.isBalanced()
+                && indexed.loadFactor() <= 1.0 && indexed.bucketCount() >= indexedMap.size();
+    map<int,int>::iterator expectedIt = indexedMap.begin();
+    for(HashIndexedAVLTree<int,int>::iterator it = indexed.begin(); indexedOk && it != indexed.end(); ++it, ++expectedIt) {
+        indexedOk = expectedIt != indexedMap.end() && it->first == expectedIt->first && indexed[it->first] == expectedIt->second;
+    }
+    indexedOk = indexedOk && expectedIt == indexedMap.end() && indexed.lower_bound(1500)->first == indexedMap.lower_bound(1500)->first;
+    indexed.clear();
+    indexedOk = indexedOk && indexed.empty() && indexed.size() == 0 && !indexed.contains(indexedMap.begin()->first);
+    indexed.insert(make_pair(7, 70));
+    indexed[7] += 1;
+    indexedOk = indexedOk && indexed.find(7)->second == 71 && indexed.size() == 1;
+
+    // Copies, moves and swaps
+    BinarySearchTree<int,int> bstCopy(randomBst);
+    AVLTree<int,int> avlCopy(randomAvl);
+    CheckedRBTree<int,int> rbCopy(randomRb);
+    CheckedScapegoatTree<int,int> scapegoatCopy(randomScapegoat);
+    AugmentedAVLTree<int,long,SumMonoid<long> > sumsCopy(sums);
+    IntervalTree<int,int> intervalsCopy(intervals);
+    bool copyOk = sameTree(randomBst, bstCopy) && sameTree(randomAvl, avlCopy) && sameTree(randomRb, rbCopy) &&
+                  rbCopy.valid() && sameTree(randomScapegoat, scapegoatCopy) &&
+                  scapegoatCopy.size() == randomScapegoat.size() && sameTree(sums, sumsCopy) &&
+                  sumsCopy.total() == sums.total() && sumsCopy.aggregate(100, 300) == sums.aggregate(100, 300) &&
+                  intervalsCopy.overlaps(0, 20000, hits, 64) == intervals.overlaps(0, 20000, hits, 64);
+    // copies are independent of the original
+    int firstKey = randomAvl.begin()->first;
+    avlCopy.remove(firstKey);
+    avlCopy.insert(std::make_pair(-1, -1));
+    bstCopy.clear();
+    copyOk = copyOk && randomAvl.begin()->first == firstKey && randomAvl.find(-1) == randomAvl.end() &&
+             avlCopy.isBalanced() && !randomBst.empty();
+    avlCopy = randomAvl;
+    copyOk = copyOk && sameTree(randomAvl, avlCopy);
+
+    HashIndexedAVLTree<int,int> indexedCopy(indexed);
+    indexedCopy.insert(std::make_pair(8, 80));
+    copyOk = copyOk && indexedCopy.size() == 2 && indexed.size() == 1 && indexedCopy[7] == 71 &&
+             indexedCopy.find(8)->second == 80 && !indexed.contains(8);
+    AVLSet<int> setCopy(avlSet);
+    copyOk = copyOk && setCopy.contains(*avlSet.begin()) && setCopy.isBalanced();
+
+    // a parallel copy of a large tree matches a serial one
+    AVLTree<int,int> large;
+    for(int i = 0; i < 200000; ++i) {
+        large.insert(std::make_pair((i * 7919) % 200000, i));
+    }
+    AVLTree<int,int> largeCopy;
+    largeCopy.copyFrom(large, 4);
+    HashIndexedAVLTree<int,int> largeIndexed;
+    for(int i = 0; i < 20000; ++i) {
+        largeIndexed.insert(std::make_pair(i * 3, i));
+    }
+    HashIndexedAVLTree<int,int> largeIndexedCopy;
+    largeIndexedCopy.copyFrom(largeIndexed, 3);
+    copyOk = copyOk && sameTree(large, largeCopy) && sameTree(largeIndexed, largeIndexedCopy) &&
+             largeIndexedCopy.size() == 20000 && largeIndexedCopy[2997] == 999 && !largeIndexedCopy.contains(2998);
+    try {
+        bstCopy.copyFrom(randomAvl);
+        copyOk = false;
+    }
+    catch(const std::invalid_argument&) {
+    }
+
+    // moves take the nodes; swaps exchange them
+    AVLTree<int,int> moved(std::move(largeCopy));
+    HashIndexedAVLTree<int,int> movedIndexed(std::move(largeIndexedCopy));
+    bool moveOk = largeCopy.empty() && sameTree(large, moved) && largeIndexedCopy.empty() &&
+                  largeIndexedCopy.size() == 0 && !largeIndexedCopy.contains(3) && movedIndexed[2997] == 999;
+    largeIndexedCopy.insert(std::make_pair(5, 5));
+    moveOk = moveOk && largeIndexedCopy[5] == 5;
+    largeCopy = std::move(moved);
+    moveOk = moveOk && moved.empty() && sameTree(large, largeCopy);
+    AVLTree<int,int> small;
+    small.insert(std::make_pair(1, 1));
+    small.swap(largeCopy);
+    moveOk = moveOk && sameTree(large, small) && largeCopy.find(1)->second == 1;
+    movedIndexed.swap(largeIndexedCopy);
+    moveOk = moveOk && movedIndexed.size() == 1 && movedIndexed[5] == 5 && largeIndexedCopy.size() == 20000 &&
+             largeIndexedCopy.contains(2997);
+    CheckedScapegoatTree<int,int> movedScapegoat(std::move(scapegoatCopy));
+    moveOk = moveOk && scapegoatCopy.size() == 0 && scapegoatCopy.empty() &&
+             movedScapegoat.size() == randomScapegoat.size();
+
+    check(bstOk, "Random BST");
+    check(avlOk, "Random AVLTree");
+    check(rbOk, "Random RBTree");
+    check(splayOk, "Random SplayTree");
+    check(scapegoatOk, "Random ScapegoatTree");
+    check(shapeOk, "Shape analysis");
+    check(statsOk, "Operation counters");
+    check(compareOk, "Comparators");
+    check(setOk, "Sets");
+    check(augmentedOk, "Augmented aggregates");
+    check(intervalOk, "Interval queries");
+    check(indexedOk, "Hash index");
+    check(copyOk, "Copies");
+    check(moveOk, "Moves and swaps");
+
+    return failures() == 0 ? 0 : 1;
 }
@@ -2,9 +2,19 @@
 #define BST_H
 
 #include <iostream>
-#include <exception>
+#include <cassert>
 #include <cstdlib>
 #include <utility>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+#include <typeinfo>
+#include <stdexcept>
+#include <thread>
+#include <exception>
+#include "tree-compare.h"
+#include "tree-stats.h"
 
 /**
  * A templated class for a Node in a search tree.
@@ -17,6 +27,8 @@ template <typename Key, typename Value>
 class Node
 {
 public:
+    typedef std::pair<const Key, Value> item_type;   // what iterators yield
+
     Node(const Key& key, const Value& value, Node<Key, Value>* parent);
     virtual ~Node();
 
@@ -187,23 +199,226 @@ void Node<Key, Value>::setValue(const Value& value)
 */
 
 /**
-* A templated unbalanced binary search tree.
+* The value type of the set trees (BSTSet, AVLSet). Nodes with SetMarker
+* values are specialized below to hold only the key: no value, no pair,
+* and the key after the links so that a derived node's own fields (the
+* AVL balance) can share its padding.
+*/
+struct SetMarker {};
+
+inline std::ostream& operator<<(std::ostream& out, const SetMarker&)
+{
+    return out;
+}
+
+template <typename Key>
+class Node<Key, SetMarker>
+{
+public:
+    typedef const Key item_type;   // set iterators yield the key
+
+    Node(const Key& key, const SetMarker& value, Node<Key, SetMarker>* parent);
+    virtual ~Node();
+
+    const Key& getItem() const;
+    const Key& getKey() const;
+    SetMarker getValue() const;
+
+    virtual Node<Key, SetMarker>* getParent() const;
+    virtual Node<Key, SetMarker>* getLeft() const;
+    virtual Node<Key, SetMarker>* getRight() const;
+
+    void setParent(Node<Key, SetMarker>* parent);
+    void setLeft(Node<Key, SetMarker>* left);
+    void setRight(Node<Key, SetMarker>* right);
+    void setValue(const SetMarker& value);
+
+protected:
+    Node<Key, SetMarker>* parent_;
+    Node<Key, SetMarker>* left_;
+    Node<Key, SetMarker>* right_;
+    const Key key_;
+};
+
+/*
+  ---------------------------------------------------------
+  Begin implementations for the Node<Key, SetMarker> class.
+  ---------------------------------------------------------
+*/
+
+template<typename Key>
+Node<Key, SetMarker>::Node(const Key& key, const SetMarker&, Node<Key, SetMarker>* parent) :
+    parent_(parent),
+    left_(NULL),
+    right_(NULL),
+    key_(key)
+{
+
+}
+
+template<typename Key>
+Node<Key, SetMarker>::~Node()
+{
+
+}
+
+template<typename Key>
+const Key& Node<Key, SetMarker>::getItem() const
+{
+    return key_;
+}
+
+template<typename Key>
+const Key& Node<Key, SetMarker>::getKey() const
+{
+    return key_;
+}
+
+template<typename Key>
+SetMarker Node<Key, SetMarker>::getValue() const
+{
+    return SetMarker();
+}
+
+template<typename Key>
+Node<Key, SetMarker>* Node<Key, SetMarker>::getParent() const
+{
+    return parent_;
+}
+
+template<typename Key>
+Node<Key, SetMarker>* Node<Key, SetMarker>::getLeft() const
+{
+    return left_;
+}
+
+template<typename Key>
+Node<Key, SetMarker>* Node<Key, SetMarker>::getRight() const
+{
+    return right_;
+}
+
+template<typename Key>
+void Node<Key, SetMarker>::setParent(Node<Key, SetMarker>* parent)
+{
+    parent_ = parent;
+}
+
+template<typename Key>
+void Node<Key, SetMarker>::setLeft(Node<Key, SetMarker>* left)
+{
+    left_ = left;
+}
+
+template<typename Key>
+void Node<Key, SetMarker>::setRight(Node<Key, SetMarker>* right)
+{
+    right_ = right;
+}
+
+/**
+* Nothing to store; inserting an existing key leaves the node as it is.
+*/
+template<typename Key>
+void Node<Key, SetMarker>::setValue(const SetMarker&)
+{
+
+}
+
+/*
+  -------------------------------------------------------
+  End implementations for the Node<Key, SetMarker> class.
+  -------------------------------------------------------
+*/
+
+/**
+* Shape statistics of a tree, gathered in a single post-order pass by
+* BinarySearchTree::analyzeShape(). Depths count the root as 1, so
+* maxLeafDepth equals height. Balance factors are right height minus left
+* height, the same convention AVLNode uses.
 */
 template <typename Key, typename Value>
+struct TreeShape
+{
+    // Balance factors beyond +/- this are counted in the end buckets of the histogram.
+    static const int BALANCE_RANGE = 16;
+
+    TreeShape() :
+        nodeCount(0), height(0), minLeafDepth(0), maxLeafDepth(0), averageDepth(0.0),
+        worstImbalance(0), worstNode(NULL), balanceMismatches(0), firstMismatch(NULL),
+        stoppedEarly(false)
+    {
+        std::fill(balanceHistogram, balanceHistogram + 2 * BALANCE_RANGE + 1, 0);
+    }
+
+    // Number of nodes with the given balance factor (clamped to the range).
+    size_t balanceCount(int balance) const
+    {
+        balance = std::max(-BALANCE_RANGE, std::min(BALANCE_RANGE, balance));
+        return balanceHistogram[balance + BALANCE_RANGE];
+    }
+
+    size_t nodeCount;
+    int height;
+    int minLeafDepth;
+    int maxLeafDepth;
+    double averageDepth;
+    int worstImbalance;                     // largest |balance factor|
+    Node<Key, Value>* worstNode;            // where it occurs
+    size_t balanceHistogram[2 * BALANCE_RANGE + 1]; // see balanceCount()
+    size_t balanceMismatches;               // stored balance factors that are wrong
+    Node<Key, Value>* firstMismatch;
+    bool stoppedEarly;                      // hit the imbalance limit; counts are partial
+};
+
+// std::max and std::min take it by reference, so it needs a definition
+template <typename Key, typename Value>
+const int TreeShape<Key, Value>::BALANCE_RANGE;
+
+/**
+* A templated unbalanced binary search tree.
+*
+* Compare orders the keys: a two-way comparator like std::less, or a
+* three-way one returning <0/0/>0 (see tree-compare.h). Searches make one
+* comparator call per node either way. If Compare is transparent, find()
+* and lower_bound() also accept any key type it can compare against.
+*
+* Stats is a statistics policy (see tree-stats.h). The default,
+* NullTreeStats, costs nothing; CountingTreeStats counts key comparisons,
+* node visits, rotations, node allocations/frees and iterator steps, read
+* back with stats() and cleared with resetStats().
+*/
+template <typename Key, typename Value, typename Compare = std::less<Key>, typename Stats = NullTreeStats>
 class BinarySearchTree
 {
 public:
+    typedef Key key_type;
+    typedef Value mapped_type;
+    typedef Compare key_compare;
+    typedef BinarySearchTree<Key, Value, Compare, Stats> tree_type;   // the base of every tree
+
     BinarySearchTree(); //TODO
+    explicit BinarySearchTree(const Compare& comp);
+    BinarySearchTree(const BinarySearchTree& other);
+    BinarySearchTree(BinarySearchTree&& other) noexcept;
+    BinarySearchTree& operator=(const BinarySearchTree& other);
+    BinarySearchTree& operator=(BinarySearchTree&& other) noexcept;
     virtual ~BinarySearchTree(); //TODO
+    void swap(BinarySearchTree& other) noexcept;
+    void copyFrom(const BinarySearchTree& other, unsigned threads = 1);
     virtual void insert(const std::pair<const Key, Value>& keyValuePair); //TODO
     virtual void remove(const Key& key); //TODO
-    void clear(); //TODO
+    virtual void clear(); //TODO
 		void clearHelper(Node<Key, Value>* node); //todo
     bool isBalanced() const; //TODO
 		bool isBalancedHelper(Node<Key, Value>* node) const; //todo
 		int getHeight(Node<Key, Value>* node) const; //todo
+    TreeShape<Key, Value> analyzeShape(int imbalanceLimit = -1) const;
     void print() const;
     bool empty() const;
+    const Stats& stats() const;
+    void resetStats();
+    const Compare& key_comp() const;
 
     template<typename PPKey, typename PPValue>
     friend void prettyPrintBST(BinarySearchTree<PPKey, PPValue> & tree);
@@ -211,13 +426,13 @@ public:
     /**
     * An internal iterator class for traversing the contents of the BST.
     */
-    class iterator  // TODO
+    class iterator : protected TreeStatsRef<Stats>  // TODO
     {
     public:
         iterator();
 
-        std::pair<const Key,Value>& operator*() const;
-        std::pair<const Key,Value>* operator->() const;
+        typename Node<Key, Value>::item_type& operator*() const;
+        typename Node<Key, Value>::item_type* operator->() const;
 
         bool operator==(const iterator& rhs) const;
         bool operator!=(const iterator& rhs) const;
@@ -225,8 +440,9 @@ public:
         iterator& operator++();
 
     protected:
-        friend class BinarySearchTree<Key, Value>;
+        friend class BinarySearchTree<Key, Value, Compare, Stats>;
         iterator(Node<Key,Value>* ptr);
+        iterator(Node<Key,Value>* ptr, Stats* stats);
         Node<Key, Value> *current_;
     };
 
@@ -234,6 +450,16 @@ public:
     iterator begin() const;
     iterator end() const;
     iterator find(const Key& key) const;
+    iterator lower_bound(const Key& key) const;
+
+    // Heterogeneous lookups, only for transparent comparators.
+    template<typename K, typename C = Compare>
+    typename std::enable_if<IsTransparentCompare<C>::value, iterator>::type
+    find(const K& key) const;
+    template<typename K, typename C = Compare>
+    typename std::enable_if<IsTransparentCompare<C>::value, iterator>::type
+    lower_bound(const K& key) const;
+
     Value& operator[](const Key& key);
     Value const & operator[](const Key& key) const;
 
@@ -252,11 +478,30 @@ protected:
     virtual void nodeSwap( Node<Key,Value>* n1, Node<Key,Value>* n2) ;
 
     // Add helper functions here
-
+    void shapeOf(Node<Key, Value>* node, int imbalanceLimit, TreeShape<Key, Value>& shape) const;
+    virtual bool storedBalanceMatches(Node<Key, Value>* node, int balance) const;
+    void removeNode(Node<Key, Value>* node);
+    void swapBase(BinarySearchTree& other) noexcept;
+    void rotateLeft(Node<Key, Value>* node);
+    void rotateRight(Node<Key, Value>* node);
+    template<typename A, typename B> bool keyLess(const A& a, const B& b) const;
+    template<typename A, typename B> int keyOrder(const A& a, const B& b) const;
+    template<typename K> Node<Key, Value>* locate(const K& key, Node<Key, Value>*& parent, bool& goRight) const;
+    template<typename K> Node<Key, Value>* lowerBoundNode(const K& key) const;
+    virtual Node<Key, Value>* createNode(const Key& key, const Value& value, Node<Key, Value>* parent);
+    virtual void destroyNode(Node<Key, Value>* node);
+    bool insertItem(const std::pair<const Key, Value>& keyValuePair);
+    iterator iteratorAt(Node<Key, Value>* node) const;
+    virtual Node<Key, Value>* cloneNode(const Node<Key, Value>* source, Node<Key, Value>* parent) const;
+    virtual void cloneContents(const BinarySearchTree& other, unsigned threads);
+    Node<Key, Value>* cloneTree(const Node<Key, Value>* source, unsigned threads);
+    size_t cloneBelow(const Node<Key, Value>* source, Node<Key, Value>* copy) const;
 
 protected:
     Node<Key, Value>* root_;
     // You should not need other data members
+    mutable Stats stats_;   // mutable: const lookups still count
+    Compare comp_;
 };
 
 /*
@@ -268,19 +513,29 @@ Begin implementations for the BinarySearchTree::iterator class.
 /**
 * Explicit constructor that initializes an iterator with a given node pointer.
 */
-template<class Key, class Value>
-BinarySearchTree<Key, Value>::iterator::iterator(Node<Key,Value> *ptr)
+template<class Key, class Value, class Compare, class Stats>
+BinarySearchTree<Key, Value, Compare, Stats>::iterator::iterator(Node<Key,Value> *ptr)
 {
     // TODO
     current_ = ptr;
 
 }
 
+/**
+* Like the above, but steps are reported to the tree's statistics.
+*/
+template<class Key, class Value, class Compare, class Stats>
+BinarySearchTree<Key, Value, Compare, Stats>::iterator::iterator(Node<Key,Value> *ptr, Stats* stats) :
+    TreeStatsRef<Stats>(stats), current_(ptr)
+{
+
+}
+
 /**
 * A default constructor that initializes the iterator to NULL.
 */
-template<class Key, class Value>
-BinarySearchTree<Key, Value>::iterator::iterator() 
+template<class Key, class Value, class Compare, class Stats>
+BinarySearchTree<Key, Value, Compare, Stats>::iterator::iterator() 
 {
     // TODO
     current_ = NULL;
@@ -290,9 +545,9 @@ BinarySearchTree<Key, Value>::iterator::iterator()
 /**
 * Provides access to the item.
 */
-template<class Key, class Value>
-std::pair<const Key,Value> &
-BinarySearchTree<Key, Value>::iterator::operator*() const
+template<class Key, class Value, class Compare, class Stats>
+typename Node<Key, Value>::item_type &
+BinarySearchTree<Key, Value, Compare, Stats>::iterator::operator*() const
 {
     return current_->getItem();
 }
@@ -300,9 +555,9 @@ BinarySearchTree<Key, Value>::iterator::operator*() const
 /**
 * Provides access to the address of the item.
 */
-template<class Key, class Value>
-std::pair<const Key,Value> *
-BinarySearchTree<Key, Value>::iterator::operator->() const
+template<class Key, class Value, class Compare, class Stats>
+typename Node<Key, Value>::item_type *
+BinarySearchTree<Key, Value, Compare, Stats>::iterator::operator->() const
 {
     return &(current_->getItem());
 }
@@ -311,10 +566,10 @@ BinarySearchTree<Key, Value>::iterator::operator->() const
 * Checks if 'this' iterator's internals have the same value
 * as 'rhs'
 */
-template<class Key, class Value>
+template<class Key, class Value, class Compare, class Stats>
 bool
-BinarySearchTree<Key, Value>::iterator::operator==(
-    const BinarySearchTree<Key, Value>::iterator& rhs) const
+BinarySearchTree<Key, Value, Compare, Stats>::iterator::operator==(
+    const BinarySearchTree<Key, Value, Compare, Stats>::iterator& rhs) const
 {
     // TODO
     return(this->current_ == rhs.current_);
@@ -324,10 +579,10 @@ BinarySearchTree<Key, Value>::iterator::operator==(
 * Checks if 'this' iterator's internals have a different value
 * as 'rhs'
 */
-template<class Key, class Value>
+template<class Key, class Value, class Compare, class Stats>
 bool
-BinarySearchTree<Key, Value>::iterator::operator!=(
-    const BinarySearchTree<Key, Value>::iterator& rhs) const
+BinarySearchTree<Key, Value, Compare, Stats>::iterator::operator!=(
+    const BinarySearchTree<Key, Value, Compare, Stats>::iterator& rhs) const
 {
     // TODO
     return(this->current_ != rhs.current_);
@@ -337,14 +592,15 @@ BinarySearchTree<Key, Value>::iterator::operator!=(
 /**
 * Advances the iterator's location using an in-order sequencing
 */
-template<class Key, class Value>
-typename BinarySearchTree<Key, Value>::iterator&
-BinarySearchTree<Key, Value>::iterator::operator++()
+template<class Key, class Value, class Compare, class Stats>
+typename BinarySearchTree<Key, Value, Compare, Stats>::iterator&
+BinarySearchTree<Key, Value, Compare, Stats>::iterator::operator++()
 {
     // TODO
 		if (current_ == nullptr) return *this;
+		this->iteratorStep();
 		
-		Node<Key, Value>* nextNode = BinarySearchTree<Key, Value>::successor(current_);
+		Node<Key, Value>* nextNode = BinarySearchTree<Key, Value, Compare, Stats>::successor(current_);
 		 /*
 		 if(nextNode != nullptr){
 			current_ = nextNode;
@@ -370,32 +626,152 @@ Begin implementations for the BinarySearchTree class.
 /**
 * Default constructor for a BinarySearchTree, which sets the root to NULL.
 */
-template<class Key, class Value>
-BinarySearchTree<Key, Value>::BinarySearchTree() 
+template<class Key, class Value, class Compare, class Stats>
+BinarySearchTree<Key, Value, Compare, Stats>::BinarySearchTree() 
 {
     // TODO
 		root_ = NULL;
 }
 
-template<typename Key, typename Value>
-BinarySearchTree<Key, Value>::~BinarySearchTree()
+/**
+* Constructor for a tree ordered by the given comparator object.
+*/
+template<class Key, class Value, class Compare, class Stats>
+BinarySearchTree<Key, Value, Compare, Stats>::BinarySearchTree(const Compare& comp) :
+    root_(NULL),
+    comp_(comp)
+{
+
+}
+
+/**
+* A deep copy with the same shape, made in O(n) without comparisons.
+*/
+template<class Key, class Value, class Compare, class Stats>
+BinarySearchTree<Key, Value, Compare, Stats>::BinarySearchTree(const BinarySearchTree& other) :
+    root_(NULL),
+    comp_(other.comp_)
+{
+    cloneContents(other, 1);
+}
+
+/**
+* Takes other's nodes, leaving it empty.
+*/
+template<class Key, class Value, class Compare, class Stats>
+BinarySearchTree<Key, Value, Compare, Stats>::BinarySearchTree(BinarySearchTree&& other) noexcept :
+    root_(other.root_),
+    stats_(other.stats_),
+    comp_(other.comp_)
+{
+    other.root_ = NULL;
+}
+
+template<class Key, class Value, class Compare, class Stats>
+BinarySearchTree<Key, Value, Compare, Stats>&
+BinarySearchTree<Key, Value, Compare, Stats>::operator=(const BinarySearchTree& other)
+{
+    copyFrom(other);
+    return *this;
+}
+
+/**
+* The old contents go with a temporary; other is left empty.
+*/
+template<class Key, class Value, class Compare, class Stats>
+BinarySearchTree<Key, Value, Compare, Stats>&
+BinarySearchTree<Key, Value, Compare, Stats>::operator=(BinarySearchTree&& other) noexcept
+{
+    if(this != &other) {
+        BinarySearchTree old(std::move(other));
+        swapBase(old);
+    }
+    return *this;
+}
+
+template<typename Key, typename Value, typename Compare, typename Stats>
+BinarySearchTree<Key, Value, Compare, Stats>::~BinarySearchTree()
 {
     // TODO
 		clear();
 
 }
 
+/**
+* Exchanges the contents of two trees of the same type in O(1). Not
+* virtual: subclasses with state of their own hide it with a swap for
+* their own type, so swapping a tree through a base reference only
+* swaps the base part, and swapping two different tree types is caught
+* here in debug builds.
+*/
+template<class Key, class Value, class Compare, class Stats>
+void BinarySearchTree<Key, Value, Compare, Stats>::swap(BinarySearchTree& other) noexcept
+{
+    assert(typeid(*this) == typeid(other));
+    swapBase(other);
+}
+
+/**
+* The base part of swap(), also used by the move assignment with a
+* temporary of the base type.
+*/
+template<class Key, class Value, class Compare, class Stats>
+void BinarySearchTree<Key, Value, Compare, Stats>::swapBase(BinarySearchTree& other) noexcept
+{
+    std::swap(root_, other.root_);
+    std::swap(stats_, other.stats_);
+    std::swap(comp_, other.comp_);
+}
+
+/**
+* Replaces the contents with a copy of other's, which must be a tree of
+* exactly the same type. With threads > 1 the subtrees below the top
+* levels are copied by that many threads, which pays off from around a
+* hundred thousand nodes.
+*/
+template<class Key, class Value, class Compare, class Stats>
+void BinarySearchTree<Key, Value, Compare, Stats>::copyFrom(const BinarySearchTree& other, unsigned threads)
+{
+    if(this == &other) return;
+    if(typeid(*this) != typeid(other)) {
+        throw std::invalid_argument("BinarySearchTree: copy between different tree types");
+    }
+    comp_ = other.comp_;
+    cloneContents(other, threads);
+}
+
 /**
  * Returns true if tree is empty
 */
-template<class Key, class Value>
-bool BinarySearchTree<Key, Value>::empty() const
+template<class Key, class Value, class Compare, class Stats>
+bool BinarySearchTree<Key, Value, Compare, Stats>::empty() const
 {
     return root_ == NULL;
 }
 
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::print() const
+/**
+* The counters gathered so far (always empty for NullTreeStats).
+*/
+template<class Key, class Value, class Compare, class Stats>
+const Stats& BinarySearchTree<Key, Value, Compare, Stats>::stats() const
+{
+    return stats_;
+}
+
+template<class Key, class Value, class Compare, class Stats>
+void BinarySearchTree<Key, Value, Compare, Stats>::resetStats()
+{
+    stats_.reset();
+}
+
+template<class Key, class Value, class Compare, class Stats>
+const Compare& BinarySearchTree<Key, Value, Compare, Stats>::key_comp() const
+{
+    return comp_;
+}
+
+template<typename Key, typename Value, typename Compare, typename Stats>
+void BinarySearchTree<Key, Value, Compare, Stats>::print() const
 {
     printRoot(root_);
     std::cout << "\n";
@@ -404,22 +780,22 @@ void BinarySearchTree<Key, Value>::print() const
 /**
 * Returns an iterator to the "smallest" item in the tree
 */
-template<class Key, class Value>
-typename BinarySearchTree<Key, Value>::iterator
-BinarySearchTree<Key, Value>::begin() const
+template<class Key, class Value, class Compare, class Stats>
+typename BinarySearchTree<Key, Value, Compare, Stats>::iterator
+BinarySearchTree<Key, Value, Compare, Stats>::begin() const
 {
-    BinarySearchTree<Key, Value>::iterator begin(getSmallestNode());
+    BinarySearchTree<Key, Value, Compare, Stats>::iterator begin(getSmallestNode(), &stats_);
     return begin;
 }
 
 /**
 * Returns an iterator whose value means INVALID
 */
-template<class Key, class Value>
-typename BinarySearchTree<Key, Value>::iterator
-BinarySearchTree<Key, Value>::end() const
+template<class Key, class Value, class Compare, class Stats>
+typename BinarySearchTree<Key, Value, Compare, Stats>::iterator
+BinarySearchTree<Key, Value, Compare, Stats>::end() const
 {
-    BinarySearchTree<Key, Value>::iterator end(NULL); //changed to nullptr from NULL
+    BinarySearchTree<Key, Value, Compare, Stats>::iterator end(NULL); //changed to nullptr from NULL
     return end;
 }
 
@@ -427,28 +803,74 @@ BinarySearchTree<Key, Value>::end() const
 * Returns an iterator to the item with the given key, k
 * or the end iterator if k does not exist in the tree
 */
-template<class Key, class Value>
-typename BinarySearchTree<Key, Value>::iterator
-BinarySearchTree<Key, Value>::find(const Key & k) const
+template<class Key, class Value, class Compare, class Stats>
+typename BinarySearchTree<Key, Value, Compare, Stats>::iterator
+BinarySearchTree<Key, Value, Compare, Stats>::find(const Key & k) const
 {
     Node<Key, Value> *curr = internalFind(k);
-    BinarySearchTree<Key, Value>::iterator it(curr);
+    BinarySearchTree<Key, Value, Compare, Stats>::iterator it(curr, &stats_);
     return it;
 }
 
+/**
+* Returns an iterator to the first item whose key is not less than k,
+* or the end iterator if there is none
+*/
+template<class Key, class Value, class Compare, class Stats>
+typename BinarySearchTree<Key, Value, Compare, Stats>::iterator
+BinarySearchTree<Key, Value, Compare, Stats>::lower_bound(const Key & k) const
+{
+    return iterator(lowerBoundNode(k), &stats_);
+}
+
+/**
+* find() for any key type a transparent comparator accepts, e.g. a C
+* string against std::string keys, without converting it to Key.
+*/
+template<class Key, class Value, class Compare, class Stats>
+template<typename K, typename C>
+typename std::enable_if<IsTransparentCompare<C>::value,
+                        typename BinarySearchTree<Key, Value, Compare, Stats>::iterator>::type
+BinarySearchTree<Key, Value, Compare, Stats>::find(const K & k) const
+{
+    Node<Key, Value>* parent;
+    bool goRight;
+    return iterator(locate(k, parent, goRight), &stats_);
+}
+
+template<class Key, class Value, class Compare, class Stats>
+template<typename K, typename C>
+typename std::enable_if<IsTransparentCompare<C>::value,
+                        typename BinarySearchTree<Key, Value, Compare, Stats>::iterator>::type
+BinarySearchTree<Key, Value, Compare, Stats>::lower_bound(const K & k) const
+{
+    return iterator(lowerBoundNode(k), &stats_);
+}
+
+/**
+* An iterator at node (end() for NULL), for subclasses that find nodes
+* their own way.
+*/
+template<class Key, class Value, class Compare, class Stats>
+typename BinarySearchTree<Key, Value, Compare, Stats>::iterator
+BinarySearchTree<Key, Value, Compare, Stats>::iteratorAt(Node<Key, Value>* node) const
+{
+    return iterator(node, &stats_);
+}
+
 /**
  * @precondition The key exists in the map
  * Returns the value associated with the key
  */
-template<class Key, class Value>
-Value& BinarySearchTree<Key, Value>::operator[](const Key& key)
+template<class Key, class Value, class Compare, class Stats>
+Value& BinarySearchTree<Key, Value, Compare, Stats>::operator[](const Key& key)
 {
     Node<Key, Value> *curr = internalFind(key);
     if(curr == NULL) throw std::out_of_range("Invalid key");
     return curr->getValue();
 }
-template<class Key, class Value>
-Value const & BinarySearchTree<Key, Value>::operator[](const Key& key) const
+template<class Key, class Value, class Compare, class Stats>
+Value const & BinarySearchTree<Key, Value, Compare, Stats>::operator[](const Key& key) const
 {
     Node<Key, Value> *curr = internalFind(key);
     if(curr == NULL) throw std::out_of_range("Invalid key");
@@ -461,40 +883,38 @@ Value const & BinarySearchTree<Key, Value>::operator[](const Key& key) const
 * Recall: If key is already in the tree, you should 
 * overwrite the current value with the updated value.
 */
-template<class Key, class Value>
-void BinarySearchTree<Key, Value>::insert(const std::pair<const Key, Value> &keyValuePair)
+template<class Key, class Value, class Compare, class Stats>
+void BinarySearchTree<Key, Value, Compare, Stats>::insert(const std::pair<const Key, Value> &keyValuePair)
 {
     // TODO
-    if(root_ == nullptr){
-        root_ = new Node<Key, Value>(keyValuePair.first, keyValuePair.second, nullptr);
-				return;
-    }
+    insertItem(keyValuePair);
+}
 
-    Node<Key, Value>* current = root_;
+/**
+* The insert itself; returns whether the key was new (false means the
+* value was overwritten).
+*/
+template<class Key, class Value, class Compare, class Stats>
+bool BinarySearchTree<Key, Value, Compare, Stats>::insertItem(const std::pair<const Key, Value> &keyValuePair)
+{
     Node<Key, Value>* parent = nullptr;
-
-    while(current != nullptr){
-        parent = current;
-        if(keyValuePair.first > current->getKey()){
-            current = current->getRight();
-        }
-
-        else if(keyValuePair.first < current->getKey()){
-            current = current->getLeft();
-        }
-				else {
-					current->setValue(keyValuePair.second);
-					return;
-				}
+    bool goRight = false;
+    Node<Key, Value>* existing = locate(keyValuePair.first, parent, goRight);
+    if(existing != nullptr){
+        existing->setValue(keyValuePair.second);
+        return false;
     }
 
-		Node<Key, Value>* newNode = new Node<Key, Value>(keyValuePair.first, keyValuePair.second, parent);
+		Node<Key, Value>* newNode = createNode(keyValuePair.first, keyValuePair.second, parent);
 		
-		if(keyValuePair.first > parent->getKey()){
+		if(parent == nullptr){
+      root_ = newNode;
+    } else if(goRight){
       parent->setRight(newNode);
     } else {
       parent->setLeft(newNode);
       }
+    return true;
 }
 
 
@@ -503,8 +923,8 @@ void BinarySearchTree<Key, Value>::insert(const std::pair<const Key, Value> &key
 * Recall: The writeup specifies that if a node has 2 children you
 * should swap with the predecessor and then remove.
 */
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::remove(const Key& key)
+template<typename Key, typename Value, typename Compare, typename Stats>
+void BinarySearchTree<Key, Value, Compare, Stats>::remove(const Key& key)
 {
     // TODO
     if (root_ == nullptr) return;
@@ -512,6 +932,16 @@ void BinarySearchTree<Key, Value>::remove(const Key& key)
 		Node<Key, Value>* newNode = internalFind(key);
 		if(newNode == nullptr) return;
 
+		removeNode(newNode);
+}
+
+/**
+* Unlinks and deletes a node that is known to be in the tree, swapping it
+* with its predecessor first if it has two children.
+*/
+template<typename Key, typename Value, typename Compare, typename Stats>
+void BinarySearchTree<Key, Value, Compare, Stats>::removeNode(Node<Key, Value>* newNode)
+{
 		if((newNode->getLeft() != nullptr) and (newNode->getRight() != nullptr)){
 			Node<Key, Value>* pred = predecessor(newNode);
 			if(pred != nullptr) nodeSwap(newNode, pred);
@@ -532,14 +962,14 @@ void BinarySearchTree<Key, Value>::remove(const Key& key)
 			child->setParent(newNode->getParent());
 		}
 
-		delete newNode;
+		destroyNode(newNode);
 }
 
 
 
-template<class Key, class Value>
+template<class Key, class Value, class Compare, class Stats>
 Node<Key, Value>*
-BinarySearchTree<Key, Value>::predecessor(Node<Key, Value>* current)
+BinarySearchTree<Key, Value, Compare, Stats>::predecessor(Node<Key, Value>* current)
 {
     // TODO
     if(current->getLeft() == nullptr) return nullptr;
@@ -566,31 +996,37 @@ BinarySearchTree<Key, Value>::predecessor(Node<Key, Value>* current)
 * A method to remove all contents of the tree and
 * reset the values in the tree for use again.
 */
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::clear()
+template<typename Key, typename Value, typename Compare, typename Stats>
+void BinarySearchTree<Key, Value, Compare, Stats>::clear()
 {
     // TODO
 		clearHelper(root_);
 		root_ = NULL;
 }
 
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::clearHelper(Node<Key, Value>* node){
-	//todo
-	if(node == nullptr) return;
-
-	clearHelper(node->getLeft());
-	clearHelper(node->getRight());
-
-	node->setLeft(nullptr);
-	node->setRight(nullptr);
-
-	delete node;
+template<typename Key, typename Value, typename Compare, typename Stats>
+void BinarySearchTree<Key, Value, Compare, Stats>::clearHelper(Node<Key, Value>* node){
+	// Deletes the subtree with constant extra space: while the current node
+	// has a left child, rotate that child up (the tree degenerates into a
+	// right spine as we go); once it has none, delete it and move right.
+	while(node != nullptr){
+		Node<Key, Value>* left = node->getLeft();
+		if(left != nullptr){
+			node->setLeft(left->getRight());
+			left->setRight(node);
+			node = left;
+		}
+		else {
+			Node<Key, Value>* right = node->getRight();
+			destroyNode(node);
+			node = right;
+		}
+	}
 }
 
-template<typename Key, typename Value>
+template<typename Key, typename Value, typename Compare, typename Stats>
 Node<Key, Value> *
-BinarySearchTree<Key, Value>::successor(Node<Key, Value>* current)
+BinarySearchTree<Key, Value, Compare, Stats>::successor(Node<Key, Value>* current)
 {
     //todo
     if(current->getRight() != nullptr){
@@ -615,8 +1051,8 @@ BinarySearchTree<Key, Value>::successor(Node<Key, Value>* current)
 /**
 * A helper function to find the smallest node in the tree.
 */
-template<typename Key, typename Value>
-Node<Key, Value>* BinarySearchTree<Key, Value>::getSmallestNode() const
+template<typename Key, typename Value, typename Compare, typename Stats>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare, Stats>::getSmallestNode() const
 {
     // TODO
 		if(root_ == nullptr) return nullptr;
@@ -633,62 +1069,241 @@ Node<Key, Value>* BinarySearchTree<Key, Value>::getSmallestNode() const
 * return a pointer to it or NULL if no item with that key
 * exists
 */
-template<typename Key, typename Value>
-Node<Key, Value>* BinarySearchTree<Key, Value>::internalFind(const Key& key) const
+template<typename Key, typename Value, typename Compare, typename Stats>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare, Stats>::internalFind(const Key& key) const
 {
     // TODO
-		Node<Key, Value>* currentNode = root_;
+		Node<Key, Value>* parent;
+		bool goRight;
+		return locate(key, parent, goRight);
+}
 
-		while(currentNode != nullptr){
-			if(key > currentNode->getKey()){
-				currentNode = currentNode->getRight();
+/**
+* The search shared by lookups and inserts. Returns the node whose key is
+* equivalent to key, or NULL with parent set to the node a new key would
+* hang from (NULL for an empty tree) and goRight to the side.
+*
+* A three-way comparator decides each node with one call. With a two-way
+* comparator the walk goes right while the node's key is less than key and
+* left otherwise, remembering the last node it went left from; that node
+* is the only one that can equal key, which one more call settles at the
+* bottom. So a search costs height + 1 calls instead of up to 2 * height.
+* A node found this way leaves parent/goRight meaningless. Scalar keys
+* skip that: comparing them is cheaper than the extra levels walked
+* below an early match.
+*/
+template<typename Key, typename Value, typename Compare, typename Stats>
+template<typename K>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare, Stats>::locate(const K& key, Node<Key, Value>*& parent,
+                                                                     bool& goRight) const
+{
+		Node<Key, Value>* current = root_;
+		parent = nullptr;
+		goRight = false;
+
+		if(IsThreeWayCompare<Compare, Key>::value or std::is_scalar<Key>::value){
+			while(current != nullptr){
+				stats_.visit();
+				int order = keyOrder(key, current->getKey());
+				if(order == 0) return current;
+				parent = current;
+				goRight = order > 0;
+				current = goRight ? current->getRight() : current->getLeft();
+			}
+			return nullptr;
+		}
 
-			} else if(key < currentNode->getKey()){
-				currentNode = currentNode->getLeft();
+		Node<Key, Value>* candidate = nullptr;
+		while(current != nullptr){
+			stats_.visit();
+			parent = current;
+			goRight = keyLess(current->getKey(), key);
+			if(goRight){
+				current = current->getRight();
+			}
+			else {
+				candidate = current;
+				current = current->getLeft();
 			}
-			else { return currentNode;}
 		}
+		if(candidate != nullptr and !keyLess(key, candidate->getKey())) return candidate;
 		return nullptr;
 }
 
+/**
+* The first node whose key is not less than key, or NULL. One comparator
+* call per level.
+*/
+template<typename Key, typename Value, typename Compare, typename Stats>
+template<typename K>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare, Stats>::lowerBoundNode(const K& key) const
+{
+		Node<Key, Value>* current = root_;
+		Node<Key, Value>* candidate = nullptr;
+		while(current != nullptr){
+			stats_.visit();
+			if(keyLess(current->getKey(), key)){
+				current = current->getRight();
+			}
+			else {
+				candidate = current;
+				current = current->getLeft();
+			}
+		}
+		return candidate;
+}
+
 /**
  * Return true iff the BST is balanced.
  */
-template<typename Key, typename Value>
-bool BinarySearchTree<Key, Value>::isBalanced() const
+template<typename Key, typename Value, typename Compare, typename Stats>
+bool BinarySearchTree<Key, Value, Compare, Stats>::isBalanced() const
 {
-    // TODO
-		if (root_ == nullptr) return true;
-
 		return isBalancedHelper(root_);
-		//return (getHeight(root_) != -1);
+}
 
+template<typename Key, typename Value, typename Compare, typename Stats>
+bool BinarySearchTree<Key, Value, Compare, Stats>::isBalancedHelper(Node<Key, Value>* node) const{
+	// One linear pass that stops at the first node out of balance.
+	TreeShape<Key, Value> shape;
+	shapeOf(node, 1, shape);
+	return !shape.stoppedEarly;
 }
 
-template<typename Key, typename Value>
-bool BinarySearchTree<Key, Value>::isBalancedHelper(Node<Key, Value>* node) const{
-	if(node == nullptr) return true;
+/**
+* Computes TreeShape for the whole tree in O(n) time. If imbalanceLimit is
+* non-negative the pass stops at the first node whose |balance factor|
+* exceeds it (stoppedEarly is then set and worstNode is that node).
+*/
+template<typename Key, typename Value, typename Compare, typename Stats>
+TreeShape<Key, Value> BinarySearchTree<Key, Value, Compare, Stats>::analyzeShape(int imbalanceLimit) const
+{
+	TreeShape<Key, Value> shape;
+	shapeOf(root_, imbalanceLimit, shape);
+	return shape;
+}
 
-	int leftHeight = getHeight(node->getLeft());
-	int rightHeight = getHeight(node->getRight());
+/**
+* Iterative post-order walk. Every node is pushed once to expand its
+* children and once more to combine their heights, which sit on a
+* separate stack, so each height is computed exactly once.
+*/
+template<typename Key, typename Value, typename Compare, typename Stats>
+void BinarySearchTree<Key, Value, Compare, Stats>::shapeOf(Node<Key, Value>* node, int imbalanceLimit,
+                                           TreeShape<Key, Value>& shape) const
+{
+	struct Frame
+	{
+		Node<Key, Value>* node;
+		int depth;
+		bool expanded;
+	};
+	std::vector<Frame> stack;
+	std::vector<int> heights;
+	double depthSum = 0;
+
+	if(node != nullptr){
+		Frame root = { node, 1, false };
+		stack.push_back(root);
+	}
+
+	while(!stack.empty()){
+		Frame frame = stack.back();
+		stack.pop_back();
+		Node<Key, Value>* current = frame.node;
+
+		if(!frame.expanded){
+			frame.expanded = true;
+			stack.push_back(frame);
+			if(current->getRight() != nullptr){
+				Frame right = { current->getRight(), frame.depth + 1, false };
+				stack.push_back(right);
+			}
+			if(current->getLeft() != nullptr){
+				Frame left = { current->getLeft(), frame.depth + 1, false };
+				stack.push_back(left);
+			}
+			continue;
+		}
+
+		// children were finished left first, so the right height is on top
+		int rightHeight = 0;
+		int leftHeight = 0;
+		if(current->getRight() != nullptr){
+			rightHeight = heights.back();
+			heights.pop_back();
+		}
+		if(current->getLeft() != nullptr){
+			leftHeight = heights.back();
+			heights.pop_back();
+		}
+		heights.push_back(1 + std::max(leftHeight, rightHeight));
 
-	if(std::abs(leftHeight - rightHeight) > 1) return false;
+		++shape.nodeCount;
+		depthSum += frame.depth;
+		if(current->getLeft() == nullptr and current->getRight() == nullptr){
+			if(shape.minLeafDepth == 0 or frame.depth < shape.minLeafDepth) shape.minLeafDepth = frame.depth;
+			if(frame.depth > shape.maxLeafDepth) shape.maxLeafDepth = frame.depth;
+		}
+
+		int balance = rightHeight - leftHeight;
+		int bucket = std::max(-shape.BALANCE_RANGE, std::min(shape.BALANCE_RANGE, balance));
+		++shape.balanceHistogram[bucket + shape.BALANCE_RANGE];
+		if(!storedBalanceMatches(current, balance)){
+			if(shape.balanceMismatches++ == 0) shape.firstMismatch = current;
+		}
+		if(std::abs(balance) > shape.worstImbalance or shape.worstNode == NULL){
+			shape.worstImbalance = std::abs(balance);
+			shape.worstNode = current;
+		}
+		if(imbalanceLimit >= 0 and std::abs(balance) > imbalanceLimit){
+			shape.stoppedEarly = true;
+			break;
+		}
+	}
 
-	return (isBalancedHelper(node->getLeft()) and isBalancedHelper(node->getRight()));
+	if(!shape.stoppedEarly) shape.height = heights.empty() ? 0 : heights.back();
+	else shape.height = shape.maxLeafDepth;
+	if(shape.nodeCount != 0) shape.averageDepth = depthSum / shape.nodeCount;
 }
 
-template<typename Key, typename Value>
-int BinarySearchTree<Key, Value>::getHeight(Node<Key, Value>* node) const
+/**
+* Hook for trees that store balance information in their nodes. Returns
+* whether node's stored balance agrees with the measured one; the plain
+* BST stores none, so it always does.
+*/
+template<typename Key, typename Value, typename Compare, typename Stats>
+bool BinarySearchTree<Key, Value, Compare, Stats>::storedBalanceMatches(Node<Key, Value>* node, int balance) const
 {
-	if (node == nullptr) return 0;
+	return true;
+}
 
-	return 1 + std::max(getHeight(node->getLeft()), getHeight(node->getRight()));
+template<typename Key, typename Value, typename Compare, typename Stats>
+int BinarySearchTree<Key, Value, Compare, Stats>::getHeight(Node<Key, Value>* node) const
+{
+	// Depth-first walk with an explicit stack of (node, depth) pairs; the
+	// stack only holds pending right siblings, so a degenerate chain needs
+	// constant space.
+	int height = 0;
+	std::vector<std::pair<Node<Key, Value>*, int> > stack;
+	if(node != nullptr) stack.push_back(std::make_pair(node, 1));
+
+	while(!stack.empty()){
+		Node<Key, Value>* current = stack.back().first;
+		int depth = stack.back().second;
+		stack.pop_back();
+		height = std::max(height, depth);
+
+		if(current->getRight() != nullptr) stack.push_back(std::make_pair(current->getRight(), depth + 1));
+		if(current->getLeft() != nullptr) stack.push_back(std::make_pair(current->getLeft(), depth + 1));
+	}
+	return height;
 }
 
 
 
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::nodeSwap( Node<Key,Value>* n1, Node<Key,Value>* n2)
+template<typename Key, typename Value, typename Compare, typename Stats>
+void BinarySearchTree<Key, Value, Compare, Stats>::nodeSwap( Node<Key,Value>* n1, Node<Key,Value>* n2)
 {
     if((n1 == n2) || (n1 == NULL) || (n2 == NULL) ) {
         return;
@@ -771,6 +1386,245 @@ void BinarySearchTree<Key, Value>::nodeSwap( Node<Key,Value>* n1, Node<Key,Value
 
 }
 
+/**
+* Rotates node's right child up into node's place. Shared by the
+* self-balancing subclasses; only the links change, never the items.
+*/
+template<typename Key, typename Value, typename Compare, typename Stats>
+void BinarySearchTree<Key, Value, Compare, Stats>::rotateLeft(Node<Key, Value>* node)
+{
+    stats_.rotation();
+    Node<Key, Value>* y = node->getRight();
+    Node<Key, Value>* rootParent = node->getParent();
+    y->setParent(rootParent);
+
+    if(rootParent == nullptr){
+        root_ = y;
+    }
+    else if(rootParent->getRight() == node){
+        rootParent->setRight(y);
+    }
+    else{
+        rootParent->setLeft(y);
+    }
+
+    Node<Key, Value>* c = y->getLeft();
+    y->setLeft(node);
+    node->setParent(y);
+    node->setRight(c);
+    if(c != nullptr){
+        c->setParent(node);
+    }
+}
+
+/**
+* Mirror image of rotateLeft: node's left child takes its place.
+*/
+template<typename Key, typename Value, typename Compare, typename Stats>
+void BinarySearchTree<Key, Value, Compare, Stats>::rotateRight(Node<Key, Value>* node)
+{
+    stats_.rotation();
+    Node<Key, Value>* y = node->getLeft();
+    Node<Key, Value>* rootParent = node->getParent();
+    y->setParent(rootParent);
+
+    if(rootParent == nullptr){
+        root_ = y;
+    }
+    else if(rootParent->getRight() == node){
+        rootParent->setRight(y);
+    }
+    else{
+        rootParent->setLeft(y);
+    }
+
+    Node<Key, Value>* c = y->getRight();
+    y->setRight(node);
+    node->setParent(y);
+    node->setLeft(c);
+    if(c != nullptr){
+        c->setParent(node);
+    }
+}
+
+/**
+* a < b under Compare (of either kind), counted as one comparison.
+*/
+template<typename Key, typename Value, typename Compare, typename Stats>
+template<typename A, typename B>
+bool BinarySearchTree<Key, Value, Compare, Stats>::keyLess(const A& a, const B& b) const
+{
+    stats_.comparison();
+    return CompareOps<Compare, Key>::less(comp_, a, b);
+}
+
+/**
+* Negative, zero or positive as a is before, equivalent to or after b;
+* one counted comparison for a three-way Compare, up to two otherwise.
+*/
+template<typename Key, typename Value, typename Compare, typename Stats>
+template<typename A, typename B>
+int BinarySearchTree<Key, Value, Compare, Stats>::keyOrder(const A& a, const B& b) const
+{
+    if(IsThreeWayCompare<Compare, Key>::value){
+        stats_.comparison();
+        return CompareOps<Compare, Key>::order(comp_, a, b);
+    }
+    if(keyLess(a, b)) return -1;
+    return keyLess(b, a) ? 1 : 0;
+}
+
+/**
+* Allocates the tree's node type; subclasses with their own node class
+* override this so the base insert and the statistics stay shared.
+*/
+template<typename Key, typename Value, typename Compare, typename Stats>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare, Stats>::createNode(const Key& key, const Value& value,
+                                                                  Node<Key, Value>* parent)
+{
+    stats_.allocation();
+    return new Node<Key, Value>(key, value, parent);
+}
+
+template<typename Key, typename Value, typename Compare, typename Stats>
+void BinarySearchTree<Key, Value, Compare, Stats>::destroyNode(Node<Key, Value>* node)
+{
+    stats_.deallocation();
+    delete node;
+}
+
+/**
+* A new node holding a copy of source's item and whatever else the node
+* type keeps (balance, color, ...), but no links. Subclasses with their
+* own node class override this as they do createNode. Called from
+* several threads at once by a parallel copy, so it must not touch the
+* tree's state.
+*/
+template<typename Key, typename Value, typename Compare, typename Stats>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare, Stats>::cloneNode(const Node<Key, Value>* source,
+                                                                 Node<Key, Value>* parent) const
+{
+    return new Node<Key, Value>(source->getKey(), source->getValue(), parent);
+}
+
+/**
+* Replaces the contents with a copy of other's. Subclasses that keep
+* more than the nodes (sizes, indexes, ...) rebuild it here.
+*/
+template<typename Key, typename Value, typename Compare, typename Stats>
+void BinarySearchTree<Key, Value, Compare, Stats>::cloneContents(const BinarySearchTree& other, unsigned threads)
+{
+    clear();
+    root_ = cloneTree(other.root_, threads);
+}
+
+/**
+* Copies the tree under source node for node. The top levels are copied
+* breadth-first until there are a few subtrees per thread, then each
+* thread copies its share of them. On failure everything copied so far
+* is freed and the exception is rethrown.
+*/
+template<typename Key, typename Value, typename Compare, typename Stats>
+Node<Key, Value>* BinarySearchTree<Key, Value, Compare, Stats>::cloneTree(const Node<Key, Value>* source, unsigned threads)
+{
+    if(source == NULL) return NULL;
+    Node<Key, Value>* root = cloneNode(source, NULL);
+    size_t count = 1;
+    try {
+        if(threads <= 1) {
+            count += cloneBelow(source, root);
+        }
+        else {
+            typedef std::pair<const Node<Key, Value>*, Node<Key, Value>*> Pair;
+            std::vector<Pair> level(1, Pair(source, root));
+            while(level.size() < 4 * threads) {
+                std::vector<Pair> next;
+                for(size_t i = 0; i < level.size(); ++i) {
+                    const Node<Key, Value>* from = level[i].first;
+                    Node<Key, Value>* to = level[i].second;
+                    if(from->getLeft() != NULL) {
+                        to->setLeft(cloneNode(from->getLeft(), to));
+                        next.push_back(Pair(from->getLeft(), to->getLeft()));
+                    }
+                    if(from->getRight() != NULL) {
+                        to->setRight(cloneNode(from->getRight(), to));
+                        next.push_back(Pair(from->getRight(), to->getRight()));
+                    }
+                }
+                count += next.size();
+                level.swap(next);
+                if(level.empty()) break;
+            }
+
+            std::vector<size_t> counts(threads, 0);
+            std::vector<std::exception_ptr> errors(threads);
+            std::vector<std::thread> workers;
+            for(unsigned t = 0; t < threads; ++t) {
+                workers.push_back(std::thread([this, &level, &counts, &errors, t, threads]() {
+                    try {
+                        for(size_t i = t; i < level.size(); i += threads) {
+                            counts[t] += cloneBelow(level[i].first, level[i].second);
+                        }
+                    }
+                    catch(...) {
+                        errors[t] = std::current_exception();
+                    }
+                }));
+            }
+            for(unsigned t = 0; t < threads; ++t) {
+                workers[t].join();
+                count += counts[t];
+            }
+            for(unsigned t = 0; t < threads; ++t) {
+                if(errors[t]) std::rethrow_exception(errors[t]);
+            }
+        }
+    }
+    catch(...) {
+        clearHelper(root);
+        throw;
+    }
+    for(size_t i = 0; i < count; ++i) {
+        stats_.allocation();
+    }
+    return root;
+}
+
+/**
+* Copies source's descendants below copy, a copy of source, walking both
+* trees in step through the parent links. Each node is linked in as it is
+* made, so a failure leaves a tree that can be freed. Returns how many
+* nodes were made.
+*/
+template<typename Key, typename Value, typename Compare, typename Stats>
+size_t BinarySearchTree<Key, Value, Compare, Stats>::cloneBelow(const Node<Key, Value>* source, Node<Key, Value>* copy) const
+{
+    size_t count = 0;
+    const Node<Key, Value>* from = source;
+    Node<Key, Value>* to = copy;
+    while(true) {
+        if(from->getLeft() != NULL and to->getLeft() == NULL) {
+            to->setLeft(cloneNode(from->getLeft(), to));
+            from = from->getLeft();
+            to = to->getLeft();
+            ++count;
+        }
+        else if(from->getRight() != NULL and to->getRight() == NULL) {
+            to->setRight(cloneNode(from->getRight(), to));
+            from = from->getRight();
+            to = to->getRight();
+            ++count;
+        }
+        else if(from == source) {
+            return count;
+        }
+        else {
+            from = from->getParent();
+            to = to->getParent();
+        }
+    }
+}
+
 /**
  * Lastly, we are providing you with a print function,
    BinarySearchTree::printRoot().
@@ -791,4 +1645,34 @@ End implementations for the BinarySearchTree class.
 ---------------------------------------------------
 */
 
+/**
+* An ordered set on the unbalanced tree: BinarySearchTree with SetMarker
+* values, whose nodes store the key alone. Iterators yield const Key&.
+*/
+template <typename Key, typename Compare = std::less<Key>, typename Stats = NullTreeStats>
+class BSTSet : public BinarySearchTree<Key, SetMarker, Compare, Stats>
+{
+public:
+    BSTSet() {}
+    explicit BSTSet(const Compare& comp) : BinarySearchTree<Key, SetMarker, Compare, Stats>(comp) {}
+
+    bool insert(const Key& key);
+    bool contains(const Key& key) const;
+};
+
+/**
+* Adds key; returns false if it was already there.
+*/
+template<typename Key, typename Compare, typename Stats>
+bool BSTSet<Key, Compare, Stats>::insert(const Key& key)
+{
+    return this->insertItem(std::pair<const Key, SetMarker>(key, SetMarker()));
+}
+
+template<typename Key, typename Compare, typename Stats>
+bool BSTSet<Key, Compare, Stats>::contains(const Key& key) const
+{
+    return this->internalFind(key) != nullptr;
+}
+
 #endif
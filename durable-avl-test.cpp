@@ -0,0 +1,204 @@
+#include <iostream>
+#include <string>
+#include <map>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "durable-avl.h"
+#include "test-helpers.h"
+
+using namespace std;
+
+template<typename Key, typename Value>
+map<Key, Value> contents(const DurableAVLTree<Key, Value>& tree)
+{
+    map<Key, Value> out;
+    tree.forEach([&out](const Key& k, const Value& v) { out[k] = v; });
+    return out;
+}
+
+int main()
+{
+    char dirTemplate[] = "/tmp/durable-avl-test-XXXXXX";
+    string dir = mkdtemp(dirTemplate);
+    map<int, int> expected;
+
+    // Writes survive a reopen through log replay alone
+    {
+        DurableAVLTree<int, int> tree(dir);
+        for(int i = 0; i < 200; ++i) {
+            tree.insert(make_pair(i, i * 10));
+            expected[i] = i * 10;
+        }
+        for(int i = 0; i < 200; i += 3) {
+            tree.remove(i);
+            expected.erase(i);
+        }
+        tree.insert(make_pair(1, -1));
+        expected[1] = -1;
+    }
+    {
+        DurableAVLTree<int, int> tree(dir);
+        check(contents(tree) == expected, "Replay log");
+        check(tree.size() == expected.size(), "Size after replay");
+
+        // Checkpoint in the background, keep writing, then reopen
+        tree.checkpoint();
+        for(int i = 1000; i < 1100; ++i) {
+            tree.insert(make_pair(i, i));
+            expected[i] = i;
+        }
+        tree.remove(1);
+        expected.erase(1);
+        tree.waitForCheckpoint();
+    }
+    {
+        DurableAVLTree<int, int> tree(dir);
+        check(contents(tree) == expected, "Checkpoint plus log");
+    }
+
+    // A torn record at the end of the log is dropped on recovery
+    {
+        DurableOptions options;
+        options.syncMode = SYNC_NONE;
+        DurableAVLTree<int, int> tree(dir, options);
+        tree.insert(make_pair(5000, 5000));
+        expected[5000] = 5000;
+        tree.sync();
+    }
+    {
+        string command = "ls " + dir + "/wal-*.log | tail -n 1";
+        FILE* p = popen(command.c_str(), "r");
+        char path[512] = {0};
+        if(fgets(path, sizeof(path), p) != NULL) path[strcspn(path, "\n")] = 0;
+        pclose(p);
+        int fd = open(path, O_WRONLY | O_APPEND);
+        const char garbage[] = "\x30\x00\x00\x00\xde\xad\xbe\xefpartial";
+        if(write(fd, garbage, sizeof(garbage) - 1) < 0) ++failures();
+        close(fd);
+    }
+    {
+        DurableAVLTree<int, int> tree(dir);
+        check(contents(tree) == expected, "Torn tail ignored");
+        tree.insert(make_pair(6000, 1));
+        expected[6000] = 1;
+    }
+    {
+        DurableAVLTree<int, int> tree(dir);
+        check(contents(tree) == expected, "Append after truncation");
+    }
+
+    // A checkpoint that cannot be written is reported and keeps the log
+    {
+        mkdir((dir + "/checkpoint.tmp").c_str(), 0755);
+        DurableAVLTree<int, int> tree(dir);
+        tree.insert(make_pair(7000, 7));
+        expected[7000] = 7;
+        tree.checkpoint();
+        bool reported = false;
+        try {
+            tree.waitForCheckpoint();
+        }
+        catch(const runtime_error&) {
+            reported = true;
+        }
+        check(reported, "Failed checkpoint reported");
+        rmdir((dir + "/checkpoint.tmp").c_str());
+    }
+    {
+        DurableAVLTree<int, int> tree(dir);
+        check(contents(tree) == expected, "Failed checkpoint keeps log");
+    }
+
+    // Once segments are gone, a corrupt checkpoint is an error, not an empty tree
+    {
+        int fd = open((dir + "/checkpoint").c_str(), O_WRONLY);
+        if(write(fd, "xxxx", 4) != 4) ++failures();
+        close(fd);
+        bool refused = false;
+        try {
+            DurableAVLTree<int, int> tree(dir);
+        }
+        catch(const runtime_error&) {
+            refused = true;
+        }
+        check(refused, "Corrupt checkpoint refused");
+
+        // likewise one that is gone, or that cannot be read
+        unlink((dir + "/checkpoint").c_str());
+        refused = false;
+        try {
+            DurableAVLTree<int, int> tree(dir);
+        }
+        catch(const runtime_error&) {
+            refused = true;
+        }
+        check(refused, "Missing checkpoint refused");
+        mkdir((dir + "/checkpoint").c_str(), 0755);
+        refused = false;
+        try {
+            DurableAVLTree<int, int> tree(dir);
+        }
+        catch(const runtime_error&) {
+            refused = true;
+        }
+        check(refused, "Unreadable checkpoint refused");
+    }
+
+    // Only the newest segment may be torn; damage in an older one is an error
+    {
+        char dir3Template[] = "/tmp/durable-avl-test-XXXXXX";
+        string dir3 = mkdtemp(dir3Template);
+        mkdir((dir3 + "/checkpoint.tmp").c_str(), 0755);
+        {
+            DurableAVLTree<int, int> tree(dir3);
+            for(int i = 0; i < 100; ++i) tree.insert(make_pair(i, i));
+            tree.checkpoint();
+            try {
+                tree.waitForCheckpoint();
+            }
+            catch(const runtime_error&) {
+            }
+            for(int i = 100; i < 200; ++i) tree.insert(make_pair(i, i));
+        }
+        rmdir((dir3 + "/checkpoint.tmp").c_str());
+        int fd = open((dir3 + "/wal-00000000000000000001.log").c_str(), O_WRONLY);
+        if(pwrite(fd, "\xff\xff", 2, 200) != 2) ++failures();
+        close(fd);
+        bool refused = false;
+        try {
+            DurableAVLTree<int, int> tree(dir3);
+        }
+        catch(const runtime_error&) {
+            refused = true;
+        }
+        check(refused, "Damaged sealed segment refused");
+        system(("rm -rf " + dir3).c_str());
+    }
+
+    // Concurrent writers share fsyncs through group commit
+    {
+        char dir2Template[] = "/tmp/durable-avl-test-XXXXXX";
+        string dir2 = mkdtemp(dir2Template);
+        DurableAVLTree<int, string> tree(dir2);
+        vector<thread> writers;
+        for(int t = 0; t < 4; ++t) {
+            writers.push_back(thread([&tree, t]() {
+                for(int i = 0; i < 50; ++i) tree.insert(make_pair(t * 1000 + i, string("value")));
+            }));
+        }
+        for(size_t t = 0; t < writers.size(); ++t) writers[t].join();
+        check(tree.size() == 200, "Concurrent inserts");
+        check(tree.fsyncCount() <= 200, "Group commit batches fsyncs");
+        cout << "  fsyncs for 200 inserts: " << tree.fsyncCount() << endl;
+        system(("rm -rf " + dir2).c_str());
+    }
+
+    system(("rm -rf " + dir).c_str());
+    return failures() == 0 ? 0 : 1;
+}
@@ -0,0 +1,878 @@
+#ifndef DURABLE_AVL_H
+#define DURABLE_AVL_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <exception>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "avlbst.h"
+
+/**
+* Encodes and decodes keys/values for the log and checkpoint files.
+* The default works for trivially copyable types; specialize it for
+* anything else (std::string is provided below).
+*/
+template <typename T>
+struct DurableCodec
+{
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "DurableCodec must be specialized for non trivially copyable types");
+
+    static void encode(const T& item, std::string& out)
+    {
+        out.append(reinterpret_cast<const char*>(&item), sizeof(T));
+    }
+
+    static bool decode(const char*& pos, const char* end, T& item)
+    {
+        if((size_t)(end - pos) < sizeof(T)) return false;
+        std::memcpy(&item, pos, sizeof(T));
+        pos += sizeof(T);
+        return true;
+    }
+};
+
+/**
+* Strings are stored as a 32-bit length followed by the raw bytes.
+*/
+template <>
+struct DurableCodec<std::string>
+{
+    static void encode(const std::string& item, std::string& out)
+    {
+        uint32_t len = (uint32_t)item.size();
+        out.append(reinterpret_cast<const char*>(&len), sizeof(len));
+        out.append(item);
+    }
+
+    static bool decode(const char*& pos, const char* end, std::string& item)
+    {
+        uint32_t len;
+        if((size_t)(end - pos) < sizeof(len)) return false;
+        std::memcpy(&len, pos, sizeof(len));
+        pos += sizeof(len);
+        if((size_t)(end - pos) < len) return false;
+        item.assign(pos, len);
+        pos += len;
+        return true;
+    }
+};
+
+/**
+* CRC-32 (IEEE 802.3, reflected) used to checksum every log record
+* and the checkpoint body.
+*/
+struct DurableCrcTable
+{
+    DurableCrcTable()
+    {
+        for(uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for(int k = 0; k < 8; ++k) {
+                c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+            }
+            entries[i] = c;
+        }
+    }
+    uint32_t entries[256];
+};
+
+inline uint32_t durableCrc32(const char* data, size_t len, uint32_t crc = 0)
+{
+    static const DurableCrcTable table;
+    crc = ~crc;
+    for(size_t i = 0; i < len; ++i) {
+        crc = table.entries[(crc ^ (uint8_t)data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+/**
+* Controls when insert/remove return relative to the log reaching disk.
+*   SYNC_EACH  - every operation waits for its own group commit (durable on return)
+*   SYNC_NONE  - operations return once buffered; call sync() to wait
+*/
+enum DurableSyncMode { SYNC_EACH, SYNC_NONE };
+
+struct DurableOptions
+{
+    DurableOptions() :
+        syncMode(SYNC_EACH),
+        groupCommitDelayUs(200),
+        checkpointEveryOps(0)
+    {}
+
+    DurableSyncMode syncMode;
+    // How long the flusher lingers after the first pending record so that
+    // concurrent writers can join the same fsync.
+    unsigned groupCommitDelayUs;
+    // Start a background checkpoint after this many logged operations (0 = manual only).
+    size_t checkpointEveryOps;
+};
+
+/**
+* An AVLTree whose insert/remove operations are made durable through a
+* checksummed write-ahead log in a directory on local disk.
+*
+* Log records are appended to an in-memory buffer and a single flusher thread
+* writes and fsyncs everything pending at once (group commit), so concurrent
+* writers share one fsync instead of paying one each.
+*
+* A checkpoint serializes the whole tree to <dir>/checkpoint. Writers wait
+* only while the log switches to a fresh segment; a background thread then
+* rebuilds the state as of the switch from the previous checkpoint and the
+* sealed segments, which are already on disk, and writes it out. Log
+* segments the checkpoint covers are deleted only once it is durably in
+* place.
+* On open, the latest checkpoint is loaded and the log segments are replayed
+* on top of it. Only the newest segment can have a torn tail, which is
+* truncated away; a file that cannot be read, a damaged older segment or a
+* log that starts after the checkpoint is an error rather than lost data.
+*
+* If writing or fsyncing the log fails, nothing after the last good fsync is
+* acknowledged: operations waiting on durability, sync() and every later
+* insert or remove throw the error. The tree may then hold changes that are
+* not on disk.
+*
+* All public member functions are thread safe.
+*/
+template <typename Key, typename Value>
+class DurableAVLTree
+{
+public:
+    DurableAVLTree(const std::string& dir, const DurableOptions& options = DurableOptions());
+    ~DurableAVLTree();
+
+    void insert(const std::pair<const Key, Value>& keyValuePair);
+    void remove(const Key& key);
+    bool find(const Key& key, Value& value) const;
+    bool empty() const;
+    size_t size() const;
+
+    // Blocks until every operation issued so far is on disk.
+    void sync();
+    // Starts a background checkpoint (no-op if one is already running).
+    void checkpoint();
+    // Waits for a running background checkpoint to finish, and throws if
+    // the last one failed (the log it would have replaced is kept).
+    void waitForCheckpoint();
+
+    // Calls f(key, value) for every item in order while holding the lock.
+    template <typename Func>
+    void forEach(Func f) const;
+
+    uint64_t lastLsn() const;
+    uint64_t durableLsn() const;
+    uint64_t fsyncCount() const;
+
+private:
+    DurableAVLTree(const DurableAVLTree&);
+    DurableAVLTree& operator=(const DurableAVLTree&);
+
+    enum OpType { OP_INSERT = 1, OP_REMOVE = 2 };
+
+    // An AVLTree whose insert reports whether the key was new, so that
+    // keeping the count costs no extra search.
+    class LogTree : public AVLTree<Key, Value>
+    {
+    public:
+        bool insertNew(const std::pair<const Key, Value>& item) { return this->insertItem(item); }
+    };
+
+    // The state rebuilt from the files on disk: the items, their count and
+    // the lsn after the last record applied.
+    struct Image
+    {
+        Image() : size(0), nextLsn(1) {}
+
+        LogTree tree;
+        size_t size;
+        uint64_t nextLsn;
+    };
+
+    uint64_t appendRecord(OpType op, const Key& key, const Value* value);
+    void finishOp(std::unique_lock<std::mutex>& lock, uint64_t lsn);
+    void waitDurable(std::unique_lock<std::mutex>& lock, uint64_t lsn);
+    void flusherLoop();
+    void checkpointWorker(uint64_t lsn);
+    void startCheckpointLocked(std::unique_lock<std::mutex>& lock);
+
+    void recover();
+    void loadImage(Image& image, uint64_t upTo, bool recovering) const;
+    bool loadCheckpoint(Image& image, uint64_t& lsn) const;
+    void replaySegment(Image& image, const std::string& path, uint64_t afterLsn, bool truncateTorn) const;
+    std::vector<uint64_t> listSegments() const;
+    std::string segmentPath(uint64_t startLsn) const;
+    void openSegment(uint64_t startLsn);
+    static void writeAll(int fd, const char* data, size_t len);
+    static bool readFile(const std::string& path, std::string& contents);
+    static bool syncDir(const std::string& dir);
+
+    std::string dir_;
+    DurableOptions options_;
+    LogTree tree_;
+    size_t size_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable flushCv_;      // wakes the flusher
+    std::condition_variable durableCv_;    // wakes writers waiting on durability
+    std::condition_variable checkpointCv_; // signals batch and checkpoint completion
+
+    std::string pending_;          // encoded records not yet handed to the flusher
+    uint64_t nextLsn_;
+    uint64_t bufferedLsn_;         // highest lsn appended to pending_
+    uint64_t durableLsn_;          // highest lsn known to be on disk
+    uint64_t fsyncs_;
+    int fd_;                       // current log segment
+    bool stopping_;
+    bool flushing_;
+    std::exception_ptr logError_;  // set once a log write or fsync fails
+
+    bool checkpointRunning_;
+    std::exception_ptr checkpointError_;   // from the last checkpoint, until reported
+    size_t opsSinceCheckpoint_;
+    std::thread flusher_;
+    std::thread checkpointer_;
+};
+
+/*
+  ---------------------------------------------------
+  Begin implementations for the DurableAVLTree class.
+  ---------------------------------------------------
+*/
+
+/**
+* Opens (creating if needed) the log directory, recovers its state and
+* starts the group commit thread.
+*/
+template<typename Key, typename Value>
+DurableAVLTree<Key, Value>::DurableAVLTree(const std::string& dir, const DurableOptions& options) :
+    dir_(dir),
+    options_(options),
+    size_(0),
+    nextLsn_(1),
+    bufferedLsn_(0),
+    durableLsn_(0),
+    fsyncs_(0),
+    fd_(-1),
+    stopping_(false),
+    flushing_(false),
+    checkpointRunning_(false),
+    opsSinceCheckpoint_(0)
+{
+    if(::mkdir(dir_.c_str(), 0755) != 0 && errno != EEXIST) {
+        throw std::runtime_error("DurableAVLTree: cannot create " + dir_);
+    }
+    recover();
+    // Keep appending to the newest surviving segment, if any.
+    std::vector<uint64_t> segments = listSegments();
+    openSegment(segments.empty() ? nextLsn_ : segments.back());
+    flusher_ = std::thread(&DurableAVLTree<Key, Value>::flusherLoop, this);
+}
+
+/**
+* Flushes outstanding records, finishes any checkpoint and stops the flusher.
+*/
+template<typename Key, typename Value>
+DurableAVLTree<Key, Value>::~DurableAVLTree()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while(checkpointRunning_) {
+            checkpointCv_.wait(lock);
+        }
+    }
+    if(checkpointer_.joinable()) checkpointer_.join();
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    flushCv_.notify_all();
+    flusher_.join();
+    if(fd_ >= 0) ::close(fd_);
+}
+
+template<typename Key, typename Value>
+void DurableAVLTree<Key, Value>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    uint64_t lsn = appendRecord(OP_INSERT, keyValuePair.first, &keyValuePair.second);
+    if(tree_.insertNew(keyValuePair)) ++size_;
+    finishOp(lock, lsn);
+}
+
+template<typename Key, typename Value>
+void DurableAVLTree<Key, Value>::remove(const Key& key)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if(tree_.find(key) == tree_.end()) return;
+    uint64_t lsn = appendRecord(OP_REMOVE, key, NULL);
+    tree_.remove(key);
+    --size_;
+    finishOp(lock, lsn);
+}
+
+/**
+* Copies the value stored under key into value; returns false if absent.
+*/
+template<typename Key, typename Value>
+bool DurableAVLTree<Key, Value>::find(const Key& key, Value& value) const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    typename AVLTree<Key, Value>::iterator it = tree_.find(key);
+    if(it == tree_.end()) return false;
+    value = it->second;
+    return true;
+}
+
+template<typename Key, typename Value>
+bool DurableAVLTree<Key, Value>::empty() const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    return tree_.empty();
+}
+
+template<typename Key, typename Value>
+size_t DurableAVLTree<Key, Value>::size() const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    return size_;
+}
+
+template<typename Key, typename Value>
+template<typename Func>
+void DurableAVLTree<Key, Value>::forEach(Func f) const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    for(typename AVLTree<Key, Value>::iterator it = tree_.begin(); it != tree_.end(); ++it) {
+        f(it->first, it->second);
+    }
+}
+
+template<typename Key, typename Value>
+void DurableAVLTree<Key, Value>::sync()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    waitDurable(lock, bufferedLsn_);
+}
+
+template<typename Key, typename Value>
+uint64_t DurableAVLTree<Key, Value>::lastLsn() const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    return bufferedLsn_;
+}
+
+template<typename Key, typename Value>
+uint64_t DurableAVLTree<Key, Value>::durableLsn() const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    return durableLsn_;
+}
+
+template<typename Key, typename Value>
+uint64_t DurableAVLTree<Key, Value>::fsyncCount() const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    return fsyncs_;
+}
+
+/**
+* Encodes one record and appends it to the pending buffer.
+* Record layout: [u32 body length][u32 crc32 of body][body]
+* where body = [u64 lsn][u8 op][key][value (inserts only)].
+* Must be called with mutex_ held; throws if the log has failed.
+*/
+template<typename Key, typename Value>
+uint64_t DurableAVLTree<Key, Value>::appendRecord(OpType op, const Key& key, const Value* value)
+{
+    if(logError_) std::rethrow_exception(logError_);
+    uint64_t lsn = nextLsn_++;
+    std::string body;
+    body.append(reinterpret_cast<const char*>(&lsn), sizeof(lsn));
+    body.push_back((char)op);
+    DurableCodec<Key>::encode(key, body);
+    if(value != NULL) DurableCodec<Value>::encode(*value, body);
+
+    uint32_t len = (uint32_t)body.size();
+    uint32_t crc = durableCrc32(body.data(), body.size());
+    pending_.append(reinterpret_cast<const char*>(&len), sizeof(len));
+    pending_.append(reinterpret_cast<const char*>(&crc), sizeof(crc));
+    pending_.append(body);
+    bufferedLsn_ = lsn;
+    flushCv_.notify_one();
+    return lsn;
+}
+
+/**
+* Runs after the tree reflects record lsn: starts an automatic checkpoint
+* if one is due and, in SYNC_EACH mode, waits for the group commit.
+*/
+template<typename Key, typename Value>
+void DurableAVLTree<Key, Value>::finishOp(std::unique_lock<std::mutex>& lock, uint64_t lsn)
+{
+    if(options_.checkpointEveryOps != 0 && ++opsSinceCheckpoint_ >= options_.checkpointEveryOps
+       && !checkpointRunning_) {
+        startCheckpointLocked(lock);
+    }
+    if(options_.syncMode == SYNC_EACH) waitDurable(lock, lsn);
+}
+
+/**
+* Waits (releasing the lock) until lsn has been fsynced by the flusher, and
+* throws the log's error if it never will be.
+*/
+template<typename Key, typename Value>
+void DurableAVLTree<Key, Value>::waitDurable(std::unique_lock<std::mutex>& lock, uint64_t lsn)
+{
+    flushCv_.notify_one();
+    while(durableLsn_ < lsn && !logError_) {
+        durableCv_.wait(lock);
+    }
+    if(durableLsn_ < lsn) std::rethrow_exception(logError_);
+}
+
+/**
+* Group commit loop: grab everything pending, write it with a single
+* write()+fsync() outside the lock, then publish the new durable lsn.
+* A failed write or fsync is kept in logError_ instead; the durable lsn
+* stops there and records still pending are dropped.
+*/
+template<typename Key, typename Value>
+void DurableAVLTree<Key, Value>::flusherLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while(true) {
+        while(pending_.empty() && !stopping_) {
+            flushCv_.wait(lock);
+        }
+        if(pending_.empty() && stopping_) break;
+
+        if(options_.groupCommitDelayUs != 0 && !stopping_) {
+            // Let other writers pile on before paying for the fsync; their
+            // notifications must not end the wait early.
+            std::chrono::steady_clock::time_point deadline =
+                std::chrono::steady_clock::now() + std::chrono::microseconds(options_.groupCommitDelayUs);
+            while(!stopping_ && flushCv_.wait_until(lock, deadline) == std::cv_status::no_timeout) {
+            }
+        }
+
+        std::string batch;
+        batch.swap(pending_);
+        uint64_t batchLsn = bufferedLsn_;
+        int fd = fd_;
+        flushing_ = true;
+        lock.unlock();
+
+        std::exception_ptr error;
+        try {
+            writeAll(fd, batch.data(), batch.size());
+            if(::fsync(fd) != 0) throw std::runtime_error("DurableAVLTree: log fsync failed");
+        }
+        catch(...) {
+            error = std::current_exception();
+        }
+
+        lock.lock();
+        flushing_ = false;
+        if(error) {
+            // Part of the batch may be in the file; recovery truncates a torn tail.
+            if(!logError_) logError_ = error;
+            pending_.clear();
+        }
+        else if(!logError_) {
+            ++fsyncs_;
+            durableLsn_ = batchLsn;
+        }
+        durableCv_.notify_all();
+        checkpointCv_.notify_all();
+    }
+}
+
+template<typename Key, typename Value>
+void DurableAVLTree<Key, Value>::checkpoint()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if(checkpointRunning_) return;
+    startCheckpointLocked(lock);
+}
+
+/**
+* Switches writers to a new log segment and starts the background thread
+* that checkpoints everything before it. Nothing proportional to the tree
+* happens here. Must be called with mutex_ held.
+*/
+template<typename Key, typename Value>
+void DurableAVLTree<Key, Value>::startCheckpointLocked(std::unique_lock<std::mutex>& lock)
+{
+    checkpointRunning_ = true;
+    opsSinceCheckpoint_ = 0;
+    if(checkpointer_.joinable()) checkpointer_.join();
+
+    // Records already buffered belong to the old segment; let the flusher
+    // drain them so that segment holds nothing newer than the snapshot.
+    while(!pending_.empty() || flushing_) {
+        flushCv_.notify_one();
+        checkpointCv_.wait(lock);
+    }
+    if(!logError_) {
+        ::close(fd_);
+        fd_ = -1;
+        try {
+            openSegment(nextLsn_);
+        }
+        catch(...) {
+            // Nowhere left to log to.
+            logError_ = std::current_exception();
+            durableCv_.notify_all();
+        }
+    }
+    if(logError_) {
+        checkpointRunning_ = false;
+        checkpointCv_.notify_all();
+        std::rethrow_exception(logError_);
+    }
+
+    // Every record up to lsn is now durable in the sealed segments, and
+    // every later one goes to the new segment.
+    uint64_t lsn = nextLsn_ - 1;
+    checkpointer_ = std::thread(&DurableAVLTree<Key, Value>::checkpointWorker, this, lsn);
+}
+
+/**
+* Background half of a checkpoint: rebuild the state as of lsn from the
+* previous checkpoint and the sealed segments, encode it, write it to a
+* temporary file, fsync, atomically rename, fsync the directory, and only
+* then drop covered log segments. Any failure before that keeps the
+* segments and is reported by waitForCheckpoint().
+*/
+template<typename Key, typename Value>
+void DurableAVLTree<Key, Value>::checkpointWorker(uint64_t lsn)
+{
+    std::string tmpPath = dir_ + "/checkpoint.tmp";
+    std::exception_ptr error;
+    try {
+        std::string body;
+        {
+            Image image;
+            loadImage(image, lsn, false);
+            uint64_t count = image.size;
+            body.append(reinterpret_cast<const char*>(&lsn), sizeof(lsn));
+            body.append(reinterpret_cast<const char*>(&count), sizeof(count));
+            for(typename AVLTree<Key, Value>::iterator it = image.tree.begin(); it != image.tree.end(); ++it) {
+                DurableCodec<Key>::encode(it->first, body);
+                DurableCodec<Value>::encode(it->second, body);
+            }
+        }
+
+        uint32_t crc = durableCrc32(body.data(), body.size());
+        int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if(fd < 0) throw std::runtime_error("DurableAVLTree: cannot create " + tmpPath);
+        try {
+            writeAll(fd, reinterpret_cast<const char*>(&crc), sizeof(crc));
+            writeAll(fd, body.data(), body.size());
+            if(::fsync(fd) != 0) throw std::runtime_error("DurableAVLTree: cannot fsync " + tmpPath);
+        }
+        catch(...) {
+            ::close(fd);
+            throw;
+        }
+        if(::close(fd) != 0) throw std::runtime_error("DurableAVLTree: cannot close " + tmpPath);
+        if(::rename(tmpPath.c_str(), (dir_ + "/checkpoint").c_str()) != 0) {
+            throw std::runtime_error("DurableAVLTree: cannot rename " + tmpPath);
+        }
+        if(!syncDir(dir_)) throw std::runtime_error("DurableAVLTree: cannot fsync " + dir_);
+
+        // A segment that fails to go is only replayed and skipped next time.
+        std::vector<uint64_t> segments = listSegments();
+        for(size_t i = 0; i < segments.size(); ++i) {
+            if(segments[i] <= lsn) ::unlink(segmentPath(segments[i]).c_str());
+        }
+    }
+    catch(...) {
+        error = std::current_exception();
+        ::unlink(tmpPath.c_str());
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    checkpointError_ = error;
+    checkpointRunning_ = false;
+    checkpointCv_.notify_all();
+}
+
+template<typename Key, typename Value>
+void DurableAVLTree<Key, Value>::waitForCheckpoint()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while(checkpointRunning_) {
+        checkpointCv_.wait(lock);
+    }
+    if(checkpointError_) {
+        std::exception_ptr error = checkpointError_;
+        checkpointError_ = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+/**
+* Rebuilds the tree from the checkpoint plus every log segment after it.
+*/
+template<typename Key, typename Value>
+void DurableAVLTree<Key, Value>::recover()
+{
+    Image image;
+    loadImage(image, UINT64_MAX, true);
+    tree_ = std::move(image.tree);
+    size_ = image.size;
+    nextLsn_ = image.nextLsn;
+    bufferedLsn_ = durableLsn_ = nextLsn_ - 1;
+}
+
+/**
+* Loads into image the checkpoint plus every log segment that starts at or
+* before lsn upTo. When recovering, the newest segment may end in a torn
+* record, which is truncated; a checkpoint reads only sealed segments,
+* which must be intact. Touches no member state, so it runs without the
+* lock.
+*/
+template<typename Key, typename Value>
+void DurableAVLTree<Key, Value>::loadImage(Image& image, uint64_t upTo, bool recovering) const
+{
+    uint64_t checkpointLsn = 0;
+    loadCheckpoint(image, checkpointLsn);
+    image.nextLsn = checkpointLsn + 1;
+
+    // Segments are named after their first lsn, and only those a checkpoint
+    // covers are ever deleted, so the log must pick up where it left off.
+    std::vector<uint64_t> segments = listSegments();
+    if(!segments.empty() && segments.front() > image.nextLsn) {
+        throw std::runtime_error("DurableAVLTree: log in " + dir_ + " starts after the checkpoint");
+    }
+    for(size_t i = 0; i < segments.size() && segments[i] <= upTo; ++i) {
+        bool last = recovering && (i + 1 == segments.size());
+        replaySegment(image, segmentPath(segments[i]), checkpointLsn, last);
+    }
+}
+
+/**
+* Loads <dir>/checkpoint into the tree. Returns false if there is none, and
+* throws if it exists but cannot be read. A checkpoint that fails its
+* checksum is skipped (returning false) only while the log still starts at
+* lsn 1, so that replaying it from scratch restores everything; once a
+* checkpoint has deleted segments, it throws instead.
+*/
+template<typename Key, typename Value>
+bool DurableAVLTree<Key, Value>::loadCheckpoint(Image& image, uint64_t& lsn) const
+{
+    std::string contents;
+    if(!readFile(dir_ + "/checkpoint", contents)) return false;
+
+    uint32_t crc = 0;
+    bool intact = contents.size() >= sizeof(crc) + 2 * sizeof(uint64_t);
+    if(intact) {
+        std::memcpy(&crc, contents.data(), sizeof(crc));
+        intact = durableCrc32(contents.data() + sizeof(crc), contents.size() - sizeof(crc)) == crc;
+    }
+    if(!intact) {
+        std::vector<uint64_t> segments = listSegments();
+        if(!segments.empty() && segments.front() == 1) return false;
+        throw std::runtime_error("DurableAVLTree: corrupt checkpoint and truncated log in " + dir_);
+    }
+
+    const char* pos = contents.data() + sizeof(crc);
+    const char* end = contents.data() + contents.size();
+    uint64_t count;
+    std::memcpy(&lsn, pos, sizeof(lsn));
+    pos += sizeof(lsn);
+    std::memcpy(&count, pos, sizeof(count));
+    pos += sizeof(count);
+
+    for(uint64_t i = 0; i < count; ++i) {
+        Key key;
+        Value value;
+        if(!DurableCodec<Key>::decode(pos, end, key) || !DurableCodec<Value>::decode(pos, end, value)) {
+            throw std::runtime_error("DurableAVLTree: malformed checkpoint");
+        }
+        if(image.tree.insertNew(std::make_pair(key, value))) ++image.size;
+    }
+    return true;
+}
+
+/**
+* Applies every valid record with lsn > afterLsn. Replay stops at the first
+* short or checksum-failing record. Only the newest segment (truncateTorn)
+* can end that way after a crash, and it is truncated there so new records
+* are not appended after garbage; in an older segment it would leave a hole
+* in the log, so that throws.
+*/
+template<typename Key, typename Value>
+void DurableAVLTree<Key, Value>::replaySegment(Image& image, const std::string& path, uint64_t afterLsn,
+                                               bool truncateTorn) const
+{
+    std::string contents;
+    if(!readFile(path, contents)) throw std::runtime_error("DurableAVLTree: log segment " + path + " is gone");
+
+    const char* begin = contents.data();
+    const char* pos = begin;
+    const char* end = begin + contents.size();
+    while((size_t)(end - pos) >= 2 * sizeof(uint32_t)) {
+        uint32_t len, crc;
+        std::memcpy(&len, pos, sizeof(len));
+        std::memcpy(&crc, pos + sizeof(len), sizeof(crc));
+        const char* body = pos + 2 * sizeof(uint32_t);
+        if((size_t)(end - body) < len || durableCrc32(body, len) != crc) break;
+
+        const char* field = body;
+        const char* bodyEnd = body + len;
+        uint64_t lsn;
+        std::memcpy(&lsn, field, sizeof(lsn));
+        field += sizeof(lsn);
+        char op = *field++;
+        Key key;
+        if(!DurableCodec<Key>::decode(field, bodyEnd, key)) break;
+
+        if(lsn > afterLsn) {
+            if(op == OP_INSERT) {
+                Value value;
+                if(!DurableCodec<Value>::decode(field, bodyEnd, value)) break;
+                if(image.tree.insertNew(std::make_pair(key, value))) ++image.size;
+            }
+            else if(image.tree.find(key) != image.tree.end()) {
+                image.tree.remove(key);
+                --image.size;
+            }
+        }
+        if(lsn >= image.nextLsn) image.nextLsn = lsn + 1;
+        pos = bodyEnd;
+    }
+
+    if(pos != end && !truncateTorn) {
+        throw std::runtime_error("DurableAVLTree: damaged record in sealed log segment " + path);
+    }
+    if(pos != end) {
+        if(::truncate(path.c_str(), pos - begin) != 0) {
+            throw std::runtime_error("DurableAVLTree: cannot truncate torn log " + path);
+        }
+    }
+}
+
+/**
+* Returns the starting lsns of all log segments, sorted ascending.
+*/
+template<typename Key, typename Value>
+std::vector<uint64_t> DurableAVLTree<Key, Value>::listSegments() const
+{
+    std::vector<uint64_t> segments;
+    DIR* d = ::opendir(dir_.c_str());
+    if(d == NULL) return segments;
+    struct dirent* entry;
+    while((entry = ::readdir(d)) != NULL) {
+        unsigned long long start;
+        char tail;
+        if(std::sscanf(entry->d_name, "wal-%llu.lo%c", &start, &tail) == 2 && tail == 'g') {
+            segments.push_back((uint64_t)start);
+        }
+    }
+    ::closedir(d);
+    std::sort(segments.begin(), segments.end());
+    return segments;
+}
+
+template<typename Key, typename Value>
+std::string DurableAVLTree<Key, Value>::segmentPath(uint64_t startLsn) const
+{
+    char name[48];
+    std::snprintf(name, sizeof(name), "/wal-%020llu.log", (unsigned long long)startLsn);
+    return dir_ + name;
+}
+
+/**
+* Opens (or creates) the segment that new records are appended to.
+*/
+template<typename Key, typename Value>
+void DurableAVLTree<Key, Value>::openSegment(uint64_t startLsn)
+{
+    std::string path = segmentPath(startLsn);
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if(fd_ < 0) throw std::runtime_error("DurableAVLTree: cannot open " + path);
+    if(!syncDir(dir_)) throw std::runtime_error("DurableAVLTree: cannot fsync " + dir_);
+}
+
+template<typename Key, typename Value>
+void DurableAVLTree<Key, Value>::writeAll(int fd, const char* data, size_t len)
+{
+    while(len > 0) {
+        ssize_t written = ::write(fd, data, len);
+        if(written < 0) {
+            if(errno == EINTR) continue;
+            throw std::runtime_error("DurableAVLTree: write failed");
+        }
+        data += written;
+        len -= written;
+    }
+}
+
+/**
+* Reads a whole file. Returns false only if it does not exist; any other
+* failure to open or read it throws.
+*/
+template<typename Key, typename Value>
+bool DurableAVLTree<Key, Value>::readFile(const std::string& path, std::string& contents)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0) {
+        if(errno == ENOENT) return false;
+        throw std::runtime_error("DurableAVLTree: cannot open " + path + ": " + std::strerror(errno));
+    }
+    char buf[1 << 16];
+    ssize_t got;
+    while((got = ::read(fd, buf, sizeof(buf))) != 0) {
+        if(got < 0) {
+            if(errno == EINTR) continue;
+            int error = errno;
+            ::close(fd);
+            throw std::runtime_error("DurableAVLTree: cannot read " + path + ": " + std::strerror(error));
+        }
+        contents.append(buf, got);
+    }
+    ::close(fd);
+    return true;
+}
+
+/**
+* fsyncs the directory so that file creations/renames are durable.
+* Returns false if that could not be done.
+*/
+template<typename Key, typename Value>
+bool DurableAVLTree<Key, Value>::syncDir(const std::string& dir)
+{
+    int fd = ::open(dir.c_str(), O_RDONLY);
+    if(fd < 0) return false;
+    bool synced = ::fsync(fd) == 0;
+    ::close(fd);
+    return synced;
+}
+
+/*
+  -------------------------------------------------
+  End implementations for the DurableAVLTree class.
+  -------------------------------------------------
+*/
+
+#endif
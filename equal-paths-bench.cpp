@@ -0,0 +1,152 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+#include <algorithm>
+#include "equal-paths.h"
+#include "equal-paths-parallel.h"
+#include "equal-paths-flat.h"
+
+using namespace std;
+
+/**
+ * Links nodes[0, n) into a complete tree in heap order (children of i are
+ * 2i+1 and 2i+2), so leaves sit on at most two levels.
+ */
+Node* linkHeap(vector<Node>& nodes, size_t n)
+{
+    for(size_t i = 0; i < n; ++i) {
+        nodes[i].key = (int)i;
+        nodes[i].left = (2 * i + 1 < n) ? &nodes[2 * i + 1] : nullptr;
+        nodes[i].right = (2 * i + 2 < n) ? &nodes[2 * i + 2] : nullptr;
+    }
+    return n ? &nodes[0] : nullptr;
+}
+
+/**
+ * Builds a forest of small random trees: each is a perfect tree of depth
+ * 3..10, and every other one has its last leaf removed so about half the
+ * trees fail the check.
+ */
+vector<Node*> makeForest(vector<Node>& storage, size_t trees, unsigned seed)
+{
+    srand(seed);
+    vector<size_t> sizes(trees);
+    size_t total = 0;
+    for(size_t t = 0; t < trees; ++t) {
+        size_t perfect = ((size_t)1 << (3 + rand() % 8)) - 1;
+        sizes[t] = (t % 2) ? perfect - 1 : perfect;
+        total += sizes[t];
+    }
+    storage.assign(total, Node(0));
+    vector<Node*> roots(trees);
+    size_t offset = 0;
+    for(size_t t = 0; t < trees; ++t) {
+        for(size_t i = 0; i < sizes[t]; ++i) {
+            Node& node = storage[offset + i];
+            node.key = (int)i;
+            node.left = (2 * i + 1 < sizes[t]) ? &storage[offset + 2 * i + 1] : nullptr;
+            node.right = (2 * i + 2 < sizes[t]) ? &storage[offset + 2 * i + 2] : nullptr;
+        }
+        roots[t] = &storage[offset];
+        offset += sizes[t];
+    }
+    return roots;
+}
+
+template<typename F>
+double timeMs(F f)
+{
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    f();
+    chrono::steady_clock::time_point stop = chrono::steady_clock::now();
+    return chrono::duration<double, milli>(stop - start).count();
+}
+
+int main(int argc, char *argv[])
+{
+    int depth = (argc > 1) ? atoi(argv[1]) : 23;
+    size_t forestSize = (argc > 2) ? (size_t)atol(argv[2]) : 200000;
+    bool ok = true;
+
+    vector<unsigned> threadCounts;
+    threadCounts.push_back(1);
+    threadCounts.push_back(2);
+    threadCounts.push_back(4);
+    unsigned hw = max(thread::hardware_concurrency(), 1u);
+    if(hw > 4) threadCounts.push_back(hw);
+
+    // One big perfect tree (all paths equal, so every leaf is visited), and
+    // the same tree with its last leaf missing (mismatch found at the end)
+    size_t n = ((size_t)1 << depth) - 1;
+    vector<Node> nodes(n, Node(0));
+    cout << "single tree: " << n << " nodes, " << hw << " hardware threads (ms)" << endl;
+    cout << left << setw(16) << "shape" << right << setw(12) << "sequential";
+    for(size_t t = 0; t < threadCounts.size(); ++t) cout << setw(9) << threadCounts[t] << " thr";
+    cout << endl;
+
+    for(int shape = 0; shape < 2; ++shape) {
+        Node* root = linkHeap(nodes, shape ? n - 1 : n);
+        bool expected = false;
+        double seq = timeMs([&] { expected = equalPaths(root); });
+        cout << left << setw(16) << (shape ? "last leaf gone" : "perfect") << right << fixed
+             << setprecision(1) << setw(12) << seq;
+        for(size_t t = 0; t < threadCounts.size(); ++t) {
+            LeafDepthPool pool(threadCounts[t]);
+            bool got = !expected;
+            cout << setw(13) << timeMs([&] { got = pool.equalPaths(root); });
+            if(got != expected) ok = false;
+        }
+        cout << endl;
+    }
+
+    // Repeated analyses of one tree: pointer walk vs the flattened copy
+    {
+        const int repeats = 10;
+        Node* root = linkHeap(nodes, n - 1);
+        FlatTree flat;
+        double build = timeMs([&] { flat.assign(root); });
+        bool expected = equalPaths(root);
+        bool got = !expected;
+        double pointerMs = timeMs([&] { for(int r = 0; r < repeats; ++r) expected = equalPaths(root); });
+        double flatMs = timeMs([&] { for(int r = 0; r < repeats; ++r) got = flat.equalPaths(); });
+        size_t leaves = 0;
+        double leafMs = timeMs([&] { for(int r = 0; r < repeats; ++r) leaves += flat.leafCount(); });
+        if(got != expected or leaves != repeats * (size_t)(n / 2)) ok = false;
+        cout << endl << "flattened, " << repeats << " repeats (ms per analysis)" << endl;
+        cout << "build " << build << ", pointer equalPaths " << pointerMs / repeats
+             << ", flat equalPaths " << flatMs / repeats << ", flat leafCount " << leafMs / repeats << endl;
+        flat.assign(nullptr);
+    }
+    nodes.clear();
+    nodes.shrink_to_fit();
+
+    // Many small trees, spread across the pool one root at a time
+    vector<Node> storage;
+    vector<Node*> roots = makeForest(storage, forestSize, 5);
+    cout << endl << "forest: " << roots.size() << " trees, " << storage.size() << " nodes (ms)" << endl;
+    cout << left << setw(16) << "" << right << setw(12) << "sequential";
+    for(size_t t = 0; t < threadCounts.size(); ++t) cout << setw(9) << threadCounts[t] << " thr";
+    cout << endl;
+
+    vector<bool> expected(roots.size());
+    double seq = timeMs([&] {
+        for(size_t i = 0; i < roots.size(); ++i) expected[i] = equalPaths(roots[i]);
+    });
+    cout << left << setw(16) << "equalPaths" << right << fixed << setprecision(1) << setw(12) << seq;
+    for(size_t t = 0; t < threadCounts.size(); ++t) {
+        LeafDepthPool pool(threadCounts[t]);
+        vector<bool> got;
+        cout << setw(13) << timeMs([&] { got = pool.equalPaths(roots); });
+        if(got != expected) ok = false;
+    }
+    cout << endl;
+
+    if(!ok) {
+        cout << "MISMATCH between sequential and parallel results" << endl;
+        return 1;
+    }
+    return 0;
+}
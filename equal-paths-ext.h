@@ -0,0 +1,35 @@
+#ifndef EQUAL_PATHS_EXT_H
+#define EQUAL_PATHS_EXT_H
+
+#include "equal-paths.h"
+
+/**
+ * @brief Describes why equalPathsWitness() failed: the first leaf it reached
+ *        and the first leaf whose depth differs from it. Depths count edges
+ *        from the root, so a lone root leaf has depth 0. Both leaves are
+ *        nullptr when the paths are equal.
+ */
+struct PathWitness {
+    Node* firstLeaf;
+    int firstDepth;
+    Node* mismatchLeaf;
+    int mismatchDepth;
+
+    PathWitness() :
+        firstLeaf(nullptr), firstDepth(0), mismatchLeaf(nullptr), mismatchDepth(0)
+    {}
+};
+
+/**
+ * @brief Same check as equalPaths(), but on failure fills in witness with
+ *        the offending pair of leaves and their depths.
+ *
+ *        Runs in O(n) time without recursion (O(height) extra space), and
+ *        stops at the first leaf whose depth does not match.
+ *
+ * @param root Pointer to the root of the tree to check for equal paths
+ * @param witness Filled in with the first leaf and, on failure, the mismatch
+ */
+bool equalPathsWitness(Node * root, PathWitness& witness);
+
+#endif
@@ -0,0 +1,152 @@
+#include <stdexcept>
+#include <limits>
+#include "equal-paths-flat.h"
+using namespace std;
+
+/*
+  ----------------------------------------------
+  Begin implementations for the FlatTree class.
+  ----------------------------------------------
+*/
+
+FlatTree::FlatTree()
+{
+
+}
+
+FlatTree::FlatTree(Node* root)
+{
+    assign(root);
+}
+
+/**
+ * Breadth-first walk in which the output order doubles as the queue:
+ * node i's children get the next free indices when i is reached.
+ */
+void FlatTree::assign(Node* root)
+{
+    keys_.clear();
+    left_.clear();
+    right_.clear();
+    levelStart_.clear();
+    if(root == nullptr) return;
+
+    vector<Node*> order(1, root);
+    size_t levelEnd = 1;
+    levelStart_.push_back(0);
+    for(size_t i = 0; i < order.size(); ++i){
+        if(i == levelEnd){
+            levelStart_.push_back(i);
+            levelEnd = order.size();
+        }
+        Node* node = order[i];
+        if(order.size() + 2 > numeric_limits<uint32_t>::max()){
+            throw length_error("FlatTree holds at most 2^32 - 1 nodes");
+        }
+        keys_.push_back(node->key);
+        left_.push_back(0);
+        right_.push_back(0);
+        if(node->left != nullptr){
+            left_[i] = (uint32_t)order.size();
+            order.push_back(node->left);
+        }
+        if(node->right != nullptr){
+            right_[i] = (uint32_t)order.size();
+            order.push_back(node->right);
+        }
+    }
+    levelStart_.push_back(order.size());
+}
+
+size_t FlatTree::size() const
+{
+    return keys_.size();
+}
+
+int FlatTree::height() const
+{
+    return levelStart_.empty() ? 0 : (int)levelStart_.size() - 1;
+}
+
+size_t FlatTree::levelBegin(int depth) const
+{
+    return levelStart_[depth];
+}
+
+size_t FlatTree::levelEnd(int depth) const
+{
+    return levelStart_[depth + 1];
+}
+
+int FlatTree::key(size_t i) const
+{
+    return keys_[i];
+}
+
+uint32_t FlatTree::left(size_t i) const
+{
+    return left_[i];
+}
+
+uint32_t FlatTree::right(size_t i) const
+{
+    return right_[i];
+}
+
+/**
+ * Branch-free count of childless nodes in [begin, end).
+ */
+size_t FlatTree::countLeaves(const uint32_t* left, const uint32_t* right, size_t begin, size_t end)
+{
+    size_t count = 0;
+    for(size_t i = begin; i < end; ++i){
+        count += ((left[i] | right[i]) == 0);
+    }
+    return count;
+}
+
+size_t FlatTree::leafCount() const
+{
+    return countLeaves(left_.data(), right_.data(), 0, size());
+}
+
+std::vector<size_t> FlatTree::leafCountsByLevel() const
+{
+    vector<size_t> counts(height());
+    for(int d = 0; d < height(); ++d){
+        counts[d] = countLeaves(left_.data(), right_.data(), levelBegin(d), levelEnd(d));
+    }
+    return counts;
+}
+
+/**
+ * The deepest level is all leaves, so only the shallowest level holding a
+ * leaf has to be searched for.
+ */
+LeafDepthRange FlatTree::leafDepthRange() const
+{
+    LeafDepthRange range;
+    if(height() == 0) return range;
+    for(int d = 0; d < height(); ++d){
+        if(countLeaves(left_.data(), right_.data(), levelBegin(d), levelEnd(d)) != 0){
+            range.addLeaf(d);
+            break;
+        }
+    }
+    range.addLeaf(height() - 1);
+    return range;
+}
+
+/**
+ * All paths are equal exactly when no level above the last holds a leaf.
+ */
+bool FlatTree::equalPaths() const
+{
+    return leafDepthRange().uniform();
+}
+
+/*
+  --------------------------------------------
+  End implementations for the FlatTree class.
+  --------------------------------------------
+*/
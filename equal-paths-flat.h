@@ -0,0 +1,54 @@
+#ifndef EQUAL_PATHS_FLAT_H
+#define EQUAL_PATHS_FLAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "equal-paths.h"
+#include "equal-paths-parallel.h"
+
+/**
+ * @brief A read-only copy of a Node tree packed into breadth-first arrays.
+ *
+ *        Node i's children are at indices left(i) and right(i), with 0
+ *        meaning "no child" (the root is index 0 and is nobody's child).
+ *        Because the order is breadth-first, each level occupies one
+ *        contiguous index range, [levelBegin(d), levelEnd(d)).
+ *
+ *        The analyses walk those ranges one level at a time with plain
+ *        counting loops over the child arrays, which the compiler can
+ *        vectorize, instead of chasing pointers. Build once, analyze many
+ *        times; the copy does not follow later changes to the Node tree.
+ */
+class FlatTree {
+public:
+    FlatTree();
+    explicit FlatTree(Node* root);
+
+    // Repacks from root, reusing the existing storage.
+    void assign(Node* root);
+
+    size_t size() const;
+    int height() const;             // number of levels, 0 when empty
+    size_t levelBegin(int depth) const;
+    size_t levelEnd(int depth) const;
+
+    int key(size_t i) const;
+    uint32_t left(size_t i) const;
+    uint32_t right(size_t i) const;
+
+    size_t leafCount() const;
+    std::vector<size_t> leafCountsByLevel() const;
+    LeafDepthRange leafDepthRange() const;
+    bool equalPaths() const;
+
+private:
+    static size_t countLeaves(const uint32_t* left, const uint32_t* right, size_t begin, size_t end);
+
+    std::vector<int> keys_;
+    std::vector<uint32_t> left_;
+    std::vector<uint32_t> right_;
+    std::vector<size_t> levelStart_;    // height() + 1 entries when non-empty
+};
+
+#endif
@@ -0,0 +1,252 @@
+#include <utility>
+#include <algorithm>
+#include "equal-paths-parallel.h"
+using namespace std;
+
+// Check the shared stop flag once per this many nodes.
+static const size_t STOP_CHECK_INTERVAL = 4096;
+
+void LeafDepthRange::addLeaf(int depth)
+{
+    if(empty()){
+        minDepth = maxDepth = depth;
+        return;
+    }
+    minDepth = min(minDepth, depth);
+    maxDepth = max(maxDepth, depth);
+}
+
+void LeafDepthRange::merge(const LeafDepthRange& other)
+{
+    if(other.empty()) return;
+    addLeaf(other.minDepth);
+    addLeaf(other.maxDepth);
+}
+
+/**
+ * Depth-first walk over an explicit stack. With a stop flag, the walk gives
+ * up as soon as the flag is raised; with an expected depth as well, every
+ * leaf is checked against the first leaf depth published by any task, and a
+ * mismatch raises the flag for everyone.
+ */
+static LeafDepthRange scanLeaves(Node* root, int rootDepth,
+                                 atomic<bool>* stop, atomic<int>* expected)
+{
+    LeafDepthRange range;
+    if(root == nullptr) return range;
+
+    vector<pair<Node*, int> > stack;
+    stack.push_back(make_pair(root, rootDepth));
+    size_t visited = 0;
+    int want = -1;
+    while(!stack.empty()){
+        if(stop != nullptr and ++visited % STOP_CHECK_INTERVAL == 0 and stop->load(memory_order_relaxed)){
+            break;
+        }
+        Node* node = stack.back().first;
+        int depth = stack.back().second;
+        stack.pop_back();
+
+        if((node->left == nullptr) and (node->right == nullptr)){
+            range.addLeaf(depth);
+            if(expected != nullptr){
+                // Only the first leaf touches the shared depth; later ones
+                // just have to match it.
+                if(want < 0 and !expected->compare_exchange_strong(want, depth) and want != depth){
+                    stop->store(true, memory_order_relaxed);
+                    break;
+                }
+                want = depth;
+                if(!range.uniform()){
+                    stop->store(true, memory_order_relaxed);
+                    break;
+                }
+            }
+            continue;
+        }
+        if(node->right != nullptr) stack.push_back(make_pair(node->right, depth + 1));
+        if(node->left != nullptr) stack.push_back(make_pair(node->left, depth + 1));
+    }
+    return range;
+}
+
+LeafDepthRange leafDepthRange(Node* root, int rootDepth)
+{
+    return scanLeaves(root, rootDepth, nullptr, nullptr);
+}
+
+/*
+  ---------------------------------------------------
+  Begin implementations for the LeafDepthPool class.
+  ---------------------------------------------------
+*/
+
+LeafDepthPool::LeafDepthPool(unsigned threads, size_t tasksPerThread) :
+    tasksPerThread_(max<size_t>(tasksPerThread, 1)),
+    body_(nullptr),
+    count_(0),
+    next_(0),
+    busy_(0),
+    generation_(0),
+    stopping_(false)
+{
+    if(threads == 0){
+        threads = max(thread::hardware_concurrency(), 1u);
+    }
+    for(unsigned i = 1; i < threads; ++i){
+        workers_.push_back(thread(&LeafDepthPool::workerLoop, this));
+    }
+}
+
+LeafDepthPool::~LeafDepthPool()
+{
+    {
+        lock_guard<mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for(size_t i = 0; i < workers_.size(); ++i){
+        workers_[i].join();
+    }
+}
+
+unsigned LeafDepthPool::threads() const
+{
+    return (unsigned)workers_.size() + 1;
+}
+
+LeafDepthRange LeafDepthPool::leafDepthRange(Node* root)
+{
+    return scanTree(root, false);
+}
+
+bool LeafDepthPool::equalPaths(Node* root)
+{
+    return scanTree(root, true).uniform();
+}
+
+std::vector<LeafDepthRange> LeafDepthPool::leafDepthRanges(const std::vector<Node*>& roots)
+{
+    vector<LeafDepthRange> ranges(roots.size());
+    parallelFor(roots.size(), [&](size_t i) {
+        ranges[i] = scanLeaves(roots[i], 0, nullptr, nullptr);
+    });
+    return ranges;
+}
+
+std::vector<bool> LeafDepthPool::equalPaths(const std::vector<Node*>& roots)
+{
+    // vector<bool> packs bits, so workers write to bytes and we convert.
+    vector<char> equal(roots.size());
+    parallelFor(roots.size(), [&](size_t i) {
+        atomic<bool> stop(false);
+        atomic<int> expected(-1);
+        equal[i] = scanLeaves(roots[i], 0, &stop, &expected).uniform();
+    });
+    return vector<bool>(equal.begin(), equal.end());
+}
+
+/**
+ * Splits the tree into a frontier of subtrees (see the class comment) and
+ * scans them in parallel, merging the partial ranges.
+ */
+LeafDepthRange LeafDepthPool::scanTree(Node* root, bool stopOnMismatch)
+{
+    LeafDepthRange range;
+    if(root == nullptr) return range;
+
+    // With no workers the whole tree is a single task for the caller.
+    size_t target = (threads() == 1) ? 1 : tasksPerThread_ * threads();
+    vector<Node*> frontier(1, root);
+    vector<Node*> next;
+    int depth = 0;
+    while(!frontier.empty() and frontier.size() < target){
+        next.clear();
+        for(size_t i = 0; i < frontier.size(); ++i){
+            Node* node = frontier[i];
+            if((node->left == nullptr) and (node->right == nullptr)){
+                range.addLeaf(depth);
+                continue;
+            }
+            if(node->left != nullptr) next.push_back(node->left);
+            if(node->right != nullptr) next.push_back(node->right);
+        }
+        frontier.swap(next);
+        ++depth;
+        if(stopOnMismatch and !range.uniform()) return range;
+    }
+    if(frontier.empty()) return range;
+
+    atomic<bool> stop(false);
+    atomic<int> expected(range.empty() ? -1 : range.minDepth);
+    vector<LeafDepthRange> parts(frontier.size());
+    parallelFor(frontier.size(), [&](size_t i) {
+        if(stopOnMismatch){
+            if(stop.load(memory_order_relaxed)) return;
+            parts[i] = scanLeaves(frontier[i], depth, &stop, &expected);
+        }
+        else {
+            parts[i] = scanLeaves(frontier[i], depth, nullptr, nullptr);
+        }
+    });
+
+    // A worker that raises the stop flag has recorded the mismatching leaf,
+    // and the leaf it disagreed with was recorded by whoever published it,
+    // so an early stop still merges into a non-uniform range.
+    for(size_t i = 0; i < parts.size(); ++i){
+        range.merge(parts[i]);
+    }
+    return range;
+}
+
+/**
+ * Runs body(0) .. body(count - 1) on the workers and the calling thread,
+ * handing indices out one at a time, and returns when all have finished.
+ */
+void LeafDepthPool::parallelFor(size_t count, const std::function<void(size_t)>& body)
+{
+    if(count == 0) return;
+    unique_lock<mutex> lock(mutex_);
+    body_ = &body;
+    count_ = count;
+    next_.store(0);
+    busy_ = workers_.size();
+    ++generation_;
+    lock.unlock();
+    wake_.notify_all();
+
+    runTasks();
+
+    lock.lock();
+    done_.wait(lock, [this] { return busy_ == 0; });
+    body_ = nullptr;
+}
+
+void LeafDepthPool::runTasks()
+{
+    size_t i;
+    while((i = next_.fetch_add(1)) < count_){
+        (*body_)(i);
+    }
+}
+
+void LeafDepthPool::workerLoop()
+{
+    size_t seen = 0;
+    unique_lock<mutex> lock(mutex_);
+    while(true){
+        wake_.wait(lock, [&] { return stopping_ or generation_ != seen; });
+        if(stopping_) return;
+        seen = generation_;
+        lock.unlock();
+        runTasks();
+        lock.lock();
+        if(--busy_ == 0) done_.notify_one();
+    }
+}
+
+/*
+  -------------------------------------------------
+  End implementations for the LeafDepthPool class.
+  -------------------------------------------------
+*/
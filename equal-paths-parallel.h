@@ -0,0 +1,96 @@
+#ifndef EQUAL_PATHS_PARALLEL_H
+#define EQUAL_PATHS_PARALLEL_H
+
+#include <cstddef>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include "equal-paths.h"
+
+/**
+ * @brief The shallowest and deepest leaf of a tree (or part of one). Depths
+ *        count edges from the root. Ranges of disjoint subtrees combine with
+ *        merge(), so a tree can be split up, scanned in pieces and put back
+ *        together. All paths are equal exactly when the range is uniform().
+ */
+struct LeafDepthRange {
+    int minDepth;   // -1 when no leaf has been seen
+    int maxDepth;
+
+    LeafDepthRange() : minDepth(-1), maxDepth(-1) {}
+
+    bool empty() const { return minDepth < 0; }
+    bool uniform() const { return minDepth == maxDepth; }
+    void addLeaf(int depth);
+    void merge(const LeafDepthRange& other);
+};
+
+/**
+ * @brief Sequential, iterative scan of every leaf below root.
+ *
+ * @param root Root of the (sub)tree to scan
+ * @param rootDepth Depth to assign to root itself
+ */
+LeafDepthRange leafDepthRange(Node* root, int rootDepth = 0);
+
+/**
+ * @brief A fixed set of worker threads that scans large trees and whole
+ *        forests for leaf depths.
+ *
+ *        A single tree is split by expanding it breadth-first from the root
+ *        until the frontier holds enough subtrees to keep every thread busy
+ *        (tasksPerThread per thread); leaves met on the way are counted
+ *        directly. Trees too small to produce such a frontier never leave
+ *        the calling thread. The frontier subtrees are handed out to the
+ *        workers one at a time and their ranges merged at the end.
+ *
+ *        Batches of roots are handed out the same way, one root per task.
+ *        Batch scans are sequential per root, so a forest holding one giant
+ *        tree is better served by calling the single-root functions on it.
+ *
+ *        The equalPaths() variants stop every worker as soon as any of them
+ *        sees a leaf whose depth disagrees with one seen elsewhere.
+ *        Calls are not reentrant: use one pool per calling thread.
+ */
+class LeafDepthPool {
+public:
+    // threads == 0 uses one thread per hardware core. The calling thread
+    // counts as one of them.
+    explicit LeafDepthPool(unsigned threads = 0, size_t tasksPerThread = 8);
+    ~LeafDepthPool();
+
+    unsigned threads() const;
+
+    LeafDepthRange leafDepthRange(Node* root);
+    bool equalPaths(Node* root);
+
+    std::vector<LeafDepthRange> leafDepthRanges(const std::vector<Node*>& roots);
+    std::vector<bool> equalPaths(const std::vector<Node*>& roots);
+
+private:
+    LeafDepthPool(const LeafDepthPool&);
+    LeafDepthPool& operator=(const LeafDepthPool&);
+
+    LeafDepthRange scanTree(Node* root, bool stopOnMismatch);
+    void parallelFor(size_t count, const std::function<void(size_t)>& body);
+    void runTasks();
+    void workerLoop();
+
+    size_t tasksPerThread_;
+    std::vector<std::thread> workers_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    const std::function<void(size_t)>* body_;
+    size_t count_;
+    std::atomic<size_t> next_;
+    size_t busy_;
+    size_t generation_;
+    bool stopping_;
+};
+
+#endif
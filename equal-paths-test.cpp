@@ -1,6 +1,10 @@
 #include <iostream>
 #include <cstdlib>
+#include <vector>
 #include "equal-paths.h"
+#include "equal-paths-ext.h"
+#include "equal-paths-parallel.h"
+#include "equal-paths-flat.h"
 using namespace std;
 
 
@@ -55,22 +59,122 @@ void test5(const char* msg)
   cout << msg << ": " <<   equalPaths(a) << endl;
 }
 
+void test6(const char* msg)
+{
+  setNode(a,1,b,c);
+  setNode(b,2,NULL,d);
+  setNode(c,3,NULL,NULL);
+  setNode(d,4,NULL,NULL);
+  PathWitness w;
+  bool result = equalPathsWitness(a, w);
+  cout << msg << ": " << result << " (leaf " << w.firstLeaf->key << " at depth " << w.firstDepth
+       << ", leaf " << w.mismatchLeaf->key << " at depth " << w.mismatchDepth << ")" << endl;
+}
+
+// A chain far deeper than the call stack could hold recursively, with and
+// without a short branch hanging off the root.
+void test7(const char* msg)
+{
+  const int n = 5000000;
+  std::vector<Node> chain(n, Node(0));
+  for(int i = 0; i < n; ++i){
+    chain[i].key = i;
+    chain[i].left = (i + 1 < n) ? &chain[i + 1] : NULL;
+  }
+  cout << msg << " (chain): " << equalPaths(&chain[0]) << endl;
+
+  Node branch(-1);
+  chain[0].right = &branch;
+  PathWitness w;
+  bool result = equalPathsWitness(&chain[0], w);
+  cout << msg << " (chain + branch): " << result << " (leaf " << w.firstLeaf->key << " at depth " << w.firstDepth
+       << ", leaf " << w.mismatchLeaf->key << " at depth " << w.mismatchDepth << ")" << endl;
+}
+
+// The thread pool must agree with equalPaths on small trees (which stay on
+// the calling thread), on the deep chain and on a forest of both.
+void test8(const char* msg)
+{
+  LeafDepthPool pool(4, 2);
+  setNode(a,1,b,c);
+  setNode(b,2,NULL,d);
+  setNode(c,3,NULL,NULL);
+  setNode(d,4,NULL,NULL);
+  LeafDepthRange range = pool.leafDepthRange(a);
+  cout << msg << " (Test5 tree): " << pool.equalPaths(a) << " depths " << range.minDepth << ".." << range.maxDepth << endl;
+
+  const int n = 1 << 20;
+  std::vector<Node> heap(n - 1, Node(0));
+  for(int i = 0; i < n - 1; ++i){
+    heap[i].left = (2 * i + 1 < n - 1) ? &heap[2 * i + 1] : NULL;
+    heap[i].right = (2 * i + 2 < n - 1) ? &heap[2 * i + 2] : NULL;
+  }
+  cout << msg << " (perfect tree): " << pool.equalPaths(&heap[0]) << endl;
+  heap[(n - 2 - 1) / 2].left = NULL;
+  heap[(n - 2 - 1) / 2].right = NULL;
+  cout << msg << " (perfect tree, leaf removed): " << pool.equalPaths(&heap[0]) << endl;
+
+  std::vector<Node*> forest;
+  forest.push_back(a);
+  forest.push_back(&heap[0]);
+  forest.push_back(&heap[1]);
+  forest.push_back(NULL);
+  std::vector<bool> results = pool.equalPaths(forest);
+  cout << msg << " (forest):";
+  for(size_t i = 0; i < results.size(); ++i) cout << " " << results[i];
+  cout << endl;
+}
+
+// Flattened copies must give the same answers as the pointer trees.
+void test9(const char* msg)
+{
+  setNode(a,1,b,c);
+  setNode(b,2,NULL,d);
+  setNode(c,3,NULL,NULL);
+  setNode(d,4,NULL,NULL);
+  FlatTree flat(a);
+  std::vector<size_t> perLevel = flat.leafCountsByLevel();
+  cout << msg << " (Test5 tree): " << flat.equalPaths() << " height " << flat.height()
+       << " leaves " << flat.leafCount() << " per level";
+  for(size_t i = 0; i < perLevel.size(); ++i) cout << " " << perLevel[i];
+  cout << endl;
+
+  setNode(a,1,b,c);
+  setNode(b,2,d,NULL);
+  setNode(c,3,NULL,e);
+  setNode(d,4,NULL,NULL);
+  setNode(e,5,NULL,NULL);
+  flat.assign(a);
+  cout << msg << " (two long paths): " << flat.equalPaths() << " order";
+  for(size_t i = 0; i < flat.size(); ++i) cout << " " << flat.key(i);
+  cout << endl;
+
+  flat.assign(NULL);
+  cout << msg << " (empty): " << flat.equalPaths() << " height " << flat.height() << endl;
+}
+
 int main()
 {
   a = new Node(1);
   b = new Node(2);
   c = new Node(3);
   d = new Node(4);
+  e = new Node(5);
 
   test1("Test1");
   test2("Test2");
   test3("Test3");
   test4("Test4");
   test5("Test5");
+  test6("Test6");
+  test7("Test7");
+  test8("Test8");
+  test9("Test9");
  
   delete a;
   delete b;
   delete c;
   delete d;
+  delete e;
 }
 
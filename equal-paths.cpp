@@ -1,40 +1,49 @@
 #ifndef RECCHECK
 //if you want to add any #includes like <iostream> you must do them here (before the next endif)
-
+#include <vector>
+#include <utility>
 #endif
 
 #include "equal-paths.h"
+#include "equal-paths-ext.h"
 using namespace std;
 
 
-// You may add any prototypes of helper functions here
-int height(Node* root){
-	if(root == nullptr) return 0;
-
-
-
-	return(1+ max(height(root->left), height(root->right)));
-}
-
-
 bool equalPaths(Node * root)
 {
-    // Add your code below
-		if(root == nullptr) return true;
-		if((root->left == nullptr) and (root->right == nullptr)) return true;
-		
-		int leftHeight = height(root->left);
-		int rightHeight = height(root->right);
-
-		if((root->left != nullptr) and (root->right != nullptr) and (leftHeight != rightHeight)) return false;
-
-		return (equalPaths(root->left) and equalPaths(root->right));
-
-		if(leftHeight == rightHeight){
-			return true;
-		}
-
-
+    PathWitness witness;
+    return equalPathsWitness(root, witness);
+}
 
+// Depth-first walk over an explicit stack of (node, depth) pairs, so deep
+// trees cannot overflow the call stack. Every node is pushed at most once.
+bool equalPathsWitness(Node * root, PathWitness& witness)
+{
+    witness = PathWitness();
+    if(root == nullptr) return true;
+
+    vector<pair<Node*, int> > stack;
+    stack.push_back(make_pair(root, 0));
+    while(!stack.empty()){
+        Node* node = stack.back().first;
+        int depth = stack.back().second;
+        stack.pop_back();
+
+        if((node->left == nullptr) and (node->right == nullptr)){
+            if(witness.firstLeaf == nullptr){
+                witness.firstLeaf = node;
+                witness.firstDepth = depth;
+            }
+            else if(depth != witness.firstDepth){
+                witness.mismatchLeaf = node;
+                witness.mismatchDepth = depth;
+                return false;
+            }
+            continue;
+        }
+        if(node->right != nullptr) stack.push_back(make_pair(node->right, depth + 1));
+        if(node->left != nullptr) stack.push_back(make_pair(node->left, depth + 1));
+    }
+    return true;
 }
 
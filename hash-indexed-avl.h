@@ -0,0 +1,337 @@
+#ifndef HASH_INDEXED_AVL_H
+#define HASH_INDEXED_AVL_H
+
+#include <cstddef>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include "bst.h"
+#include "avlbst.h"
+
+/**
+* An AVLNode that is also an entry of a hash table: it keeps its key's
+* hash and the next node in its bucket's chain.
+*/
+template <typename Key, typename Value>
+class HashedNode : public AVLNode<Key, Value>
+{
+public:
+    HashedNode(const Key& key, const Value& value, AVLNode<Key, Value>* parent, size_t hash) :
+        AVLNode<Key, Value>(key, value, parent), hash_(hash), hashNext_(nullptr) {}
+
+    size_t hash_;
+    HashedNode<Key, Value>* hashNext_;
+};
+
+/**
+* An AVL tree that is also a chained hash table over the same nodes, in
+* place of a std::unordered_map kept next to it. find(), operator[],
+* contains() and overwriting inserts go through the table in O(1)
+* expected; new keys and removes pay the usual O(log n) descent plus O(1)
+* for the chain. Iteration, lower_bound and everything else ordered is
+* the AVL tree's, and each key is still one allocation.
+*
+* Hash and KeyEqual must agree with Compare: keys that hash differently
+* or are not equal must not be equivalent. The table doubles when it has
+* more nodes than buckets.
+*/
+template <class Key, class Value, class Hash = std::hash<Key>, class KeyEqual = std::equal_to<Key>,
+          class Compare = std::less<Key>, class Stats = NullTreeStats>
+class HashIndexedAVLTree : public AVLTree<Key, Value, Compare, Stats>
+{
+public:
+    typedef typename BinarySearchTree<Key, Value, Compare, Stats>::iterator iterator;
+
+    explicit HashIndexedAVLTree(size_t buckets = 16, const Hash& hash = Hash(), const KeyEqual& equal = KeyEqual());
+    HashIndexedAVLTree(const HashIndexedAVLTree& other);
+    HashIndexedAVLTree(HashIndexedAVLTree&& other) noexcept;
+    HashIndexedAVLTree& operator=(const HashIndexedAVLTree& other);
+    HashIndexedAVLTree& operator=(HashIndexedAVLTree&& other) noexcept;
+
+    virtual void insert(const std::pair<const Key, Value>& new_item);
+    virtual void remove(const Key& key);
+    virtual void clear();
+    void swap(HashIndexedAVLTree& other) noexcept;
+
+    iterator find(const Key& key) const;
+    bool contains(const Key& key) const;
+    Value& operator[](const Key& key);
+    Value const & operator[](const Key& key) const;
+
+    size_t size() const;
+    size_t bucketCount() const;
+    double loadFactor() const;
+
+protected:
+    typedef HashedNode<Key, Value> HNode;
+
+    virtual Node<Key, Value>* createNode(const Key& key, const Value& value, Node<Key, Value>* parent);
+    virtual Node<Key, Value>* cloneNode(const Node<Key, Value>* source, Node<Key, Value>* parent) const;
+    virtual void cloneContents(const BinarySearchTree<Key, Value, Compare, Stats>& other, unsigned threads);
+
+    HNode* hashFind(const Key& key, size_t hash) const;
+    void link(HNode* node);
+    void unlink(HNode* node);
+    void grow();
+
+    std::vector<HNode*> buckets_;   // size is a power of two, or 0 once moved from
+    size_t size_;
+    Hash hash_;
+    KeyEqual equal_;
+};
+
+/*
+  -----------------------------------------------------------
+  Begin implementations for the HashIndexedAVLTree class.
+  -----------------------------------------------------------
+*/
+
+template<class Key, class Value, class Hash, class KeyEqual, class Compare, class Stats>
+HashIndexedAVLTree<Key, Value, Hash, KeyEqual, Compare, Stats>::HashIndexedAVLTree(size_t buckets, const Hash& hash,
+                                                                                   const KeyEqual& equal) :
+    size_(0),
+    hash_(hash),
+    equal_(equal)
+{
+    size_t count = 1;
+    while(count < buckets) count <<= 1;
+    buckets_.assign(count, nullptr);
+}
+
+/**
+* Copies the tree with each node's hash, then chains the nodes into a
+* table of the same size; nothing is hashed again.
+*/
+template<class Key, class Value, class Hash, class KeyEqual, class Compare, class Stats>
+HashIndexedAVLTree<Key, Value, Hash, KeyEqual, Compare, Stats>::HashIndexedAVLTree(const HashIndexedAVLTree& other) :
+    AVLTree<Key, Value, Compare, Stats>(other.key_comp()),
+    buckets_(other.buckets_.size(), nullptr),
+    size_(0),
+    hash_(other.hash_),
+    equal_(other.equal_)
+{
+    this->cloneContents(other, 1);
+}
+
+template<class Key, class Value, class Hash, class KeyEqual, class Compare, class Stats>
+HashIndexedAVLTree<Key, Value, Hash, KeyEqual, Compare, Stats>::HashIndexedAVLTree(HashIndexedAVLTree&& other) noexcept :
+    AVLTree<Key, Value, Compare, Stats>(std::move(other)),
+    size_(other.size_),
+    hash_(other.hash_),
+    equal_(other.equal_)
+{
+    buckets_.swap(other.buckets_);
+    other.size_ = 0;
+}
+
+template<class Key, class Value, class Hash, class KeyEqual, class Compare, class Stats>
+HashIndexedAVLTree<Key, Value, Hash, KeyEqual, Compare, Stats>&
+HashIndexedAVLTree<Key, Value, Hash, KeyEqual, Compare, Stats>::operator=(const HashIndexedAVLTree& other)
+{
+    this->copyFrom(other);
+    return *this;
+}
+
+template<class Key, class Value, class Hash, class KeyEqual, class Compare, class Stats>
+HashIndexedAVLTree<Key, Value, Hash, KeyEqual, Compare, Stats>&
+HashIndexedAVLTree<Key, Value, Hash, KeyEqual, Compare, Stats>::operator=(HashIndexedAVLTree&& other) noexcept
+{
+    if(this != &other) {
+        HashIndexedAVLTree old(std::move(other));
+        swap(old);
+    }
+    return *this;
+}
+
+/**
+* An existing key is overwritten in place without touching the tree.
+*/
+template<class Key, class Value, class Hash, class KeyEqual, class Compare, class Stats>
+void HashIndexedAVLTree<Key, Value, Hash, KeyEqual, Compare, Stats>::insert(const std::pair<const Key, Value>& new_item)
+{
+    HNode* node = hashFind(new_item.first, hash_(new_item.first));
+    if(node != nullptr) {
+        node->setValue(new_item.second);
+        return;
+    }
+    AVLTree<Key, Value, Compare, Stats>::insert(new_item);
+}
+
+/**
+* Out of the chain first: the node is freed by the tree's remove.
+*/
+template<class Key, class Value, class Hash, class KeyEqual, class Compare, class Stats>
+void HashIndexedAVLTree<Key, Value, Hash, KeyEqual, Compare, Stats>::remove(const Key& key)
+{
+    HNode* node = hashFind(key, hash_(key));
+    if(node == nullptr) return;
+    unlink(node);
+    AVLTree<Key, Value, Compare, Stats>::remove(key);
+}
+
+template<class Key, class Value, class Hash, class KeyEqual, class Compare, class Stats>
+void HashIndexedAVLTree<Key, Value, Hash, KeyEqual, Compare, Stats>::clear()
+{
+    AVLTree<Key, Value, Compare, Stats>::clear();
+    std::fill(buckets_.begin(), buckets_.end(), (HNode*)nullptr);
+    size_ = 0;
+}
+
+template<class Key, class Value, class Hash, class KeyEqual, class Compare, class Stats>
+void HashIndexedAVLTree<Key, Value, Hash, KeyEqual, Compare, Stats>::swap(HashIndexedAVLTree& other) noexcept
+{
+    AVLTree<Key, Value, Compare, Stats>::swap(other);
+    buckets_.swap(other.buckets_);
+    std::swap(size_, other.size_);
+    std::swap(hash_, other.hash_);
+    std::swap(equal_, other.equal_);
+}
+
+template<class Key, class Value, class Hash, class KeyEqual, class Compare, class Stats>
+typename HashIndexedAVLTree<Key, Value, Hash, KeyEqual, Compare, Stats>::iterator
+HashIndexedAVLTree<Key, Value, Hash, KeyEqual, Compare, Stats>::find(const Key& key) const
+{
+    return this->iteratorAt(hashFind(key, hash_(key)));
+}
+
+template<class Key, class Value, class Hash, class KeyEqual, class Compare, class Stats>
+bool HashIndexedAVLTree<Key, Value, Hash, KeyEqual, Compare, Stats>::contains(const Key& key) const
+{
+    return hashFind(key, hash_(key)) != nullptr;
+}
+
+template<class Key, class Value, class Hash, class KeyEqual, class Compare, class Stats>
+Value& HashIndexedAVLTree<Key, Value, Hash, KeyEqual, Compare, Stats>::operator[](const Key& key)
+{
+    HNode* node = hashFind(key, hash_(key));
+    if(node == nullptr) throw std::out_of_range("Invalid key");
+    return node->getValue();
+}
+
+template<class Key, class Value, class Hash, class KeyEqual, class Compare, class Stats>
+Value const & HashIndexedAVLTree<Key, Value, Hash, KeyEqual, Compare, Stats>::operator[](const Key& key) const
+{
+    HNode* node = hashFind(key, hash_(key));
+    if(node == nullptr) throw std::out_of_range("Invalid key");
+    return node->getValue();
+}
+
+template<class Key, class Value, class Hash, class KeyEqual, class Compare, class Stats>
+size_t HashIndexedAVLTree<Key, Value, Hash, KeyEqual, Compare, Stats>::size() const
+{
+    return size_;
+}
+
+template<class Key, class Value, class Hash, class KeyEqual, class Compare, class Stats>
+size_t HashIndexedAVLTree<Key, Value, Hash, KeyEqual, Compare, Stats>::bucketCount() const
+{
+    return buckets_.size();
+}
+
+template<class Key, class Value, class Hash, class KeyEqual, class Compare, class Stats>
+double HashIndexedAVLTree<Key, Value, Hash, KeyEqual, Compare, Stats>::loadFactor() const
+{
+    return buckets_.empty() ? 0.0 : (double)size_ / buckets_.size();
+}
+
+/**
+* Every node the tree creates goes into its bucket as it is made, so the
+* AVL insert needs no changes.
+*/
+template<class Key, class Value, class Hash, class KeyEqual, class Compare, class Stats>
+Node<Key, Value>* HashIndexedAVLTree<Key, Value, Hash, KeyEqual, Compare, Stats>::createNode(const Key& key, const Value& value,
+                                                                                             Node<Key, Value>* parent)
+{
+    this->stats_.allocation();
+    HNode* node = new HNode(key, value, static_cast<AVLNode<Key, Value>*>(parent), hash_(key));
+    link(node);
+    return node;
+}
+
+/**
+* Copies keep the hash, but are chained in by cloneContents: a parallel
+* copy makes nodes on several threads.
+*/
+template<class Key, class Value, class Hash, class KeyEqual, class Compare, class Stats>
+Node<Key, Value>* HashIndexedAVLTree<Key, Value, Hash, KeyEqual, Compare, Stats>::cloneNode(const Node<Key, Value>* source,
+                                                                                            Node<Key, Value>* parent) const
+{
+    const HNode* from = static_cast<const HNode*>(source);
+    HNode* node = new HNode(from->getKey(), from->getValue(), static_cast<AVLNode<Key, Value>*>(parent), from->hash_);
+    node->setBalance(from->getBalance());
+    return node;
+}
+
+template<class Key, class Value, class Hash, class KeyEqual, class Compare, class Stats>
+void HashIndexedAVLTree<Key, Value, Hash, KeyEqual, Compare, Stats>::cloneContents(
+    const BinarySearchTree<Key, Value, Compare, Stats>& other, unsigned threads)
+{
+    const HashIndexedAVLTree& source = static_cast<const HashIndexedAVLTree&>(other);
+    AVLTree<Key, Value, Compare, Stats>::cloneContents(other, threads);
+    hash_ = source.hash_;
+    equal_ = source.equal_;
+    if(buckets_.size() < source.buckets_.size()) buckets_.assign(source.buckets_.size(), nullptr);
+    for(Node<Key, Value>* node = this->getSmallestNode(); node != nullptr; node = this->successor(node)) {
+        link(static_cast<HNode*>(node));
+    }
+}
+
+template<class Key, class Value, class Hash, class KeyEqual, class Compare, class Stats>
+HashedNode<Key, Value>* HashIndexedAVLTree<Key, Value, Hash, KeyEqual, Compare, Stats>::hashFind(const Key& key, size_t hash) const
+{
+    if(buckets_.empty()) return nullptr;
+    for(HNode* node = buckets_[hash & (buckets_.size() - 1)]; node != nullptr; node = node->hashNext_) {
+        if(node->hash_ == hash and equal_(node->getKey(), key)) return node;
+    }
+    return nullptr;
+}
+
+template<class Key, class Value, class Hash, class KeyEqual, class Compare, class Stats>
+void HashIndexedAVLTree<Key, Value, Hash, KeyEqual, Compare, Stats>::link(HNode* node)
+{
+    if(size_ >= buckets_.size()) grow();
+    HNode*& head = buckets_[node->hash_ & (buckets_.size() - 1)];
+    node->hashNext_ = head;
+    head = node;
+    ++size_;
+}
+
+template<class Key, class Value, class Hash, class KeyEqual, class Compare, class Stats>
+void HashIndexedAVLTree<Key, Value, Hash, KeyEqual, Compare, Stats>::unlink(HNode* node)
+{
+    HNode** link = &buckets_[node->hash_ & (buckets_.size() - 1)];
+    while(*link != node) link = &(*link)->hashNext_;
+    *link = node->hashNext_;
+    --size_;
+}
+
+/**
+* Doubles the buckets, moving every node over by its stored hash.
+*/
+template<class Key, class Value, class Hash, class KeyEqual, class Compare, class Stats>
+void HashIndexedAVLTree<Key, Value, Hash, KeyEqual, Compare, Stats>::grow()
+{
+    std::vector<HNode*> old(buckets_.empty() ? 16 : buckets_.size() * 2, nullptr);
+    old.swap(buckets_);
+    size_t mask = buckets_.size() - 1;
+    for(size_t i = 0; i < old.size(); ++i) {
+        HNode* node = old[i];
+        while(node != nullptr) {
+            HNode* next = node->hashNext_;
+            HNode*& head = buckets_[node->hash_ & mask];
+            node->hashNext_ = head;
+            head = node;
+            node = next;
+        }
+    }
+}
+
+/*
+  ---------------------------------------------------------
+  End implementations for the HashIndexedAVLTree class.
+  ---------------------------------------------------------
+*/
+
+#endif
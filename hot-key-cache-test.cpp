@@ -0,0 +1,105 @@
+#include <iostream>
+#include <map>
+#include <string>
+#include <cstdlib>
+#include <stdexcept>
+#include <type_traits>
+#include "bst.h"
+#include "avlbst.h"
+#include "rbbst.h"
+#include "splay.h"
+#include "hot-key-cache.h"
+#include "test-helpers.h"
+
+using namespace std;
+
+int main()
+{
+    CachedTree<AVLTree<int, int> > avl(4);
+    CachedTree<RBTree<int, int> > rb(64);
+    CachedTree<SplayTree<int, int> > splay(1);
+    // a small key range makes removes of cached two-child nodes common,
+    // and a tiny cache makes slots change hands all the time
+    OpMix mix(1, 1, 1, 2);
+    bool randomOk = matchesMap(avl, 1, 100000, 500, mix) && matchesMap(rb, 2, 100000, 500, mix) &&
+                    matchesMap(splay, 3, 100000, 500, mix);
+    bool sizeOk = avl.cacheSlots() == 4 && splay.cacheSlots() == 2;
+
+    // 16 hot keys out of 100000, looked up over and over
+    CachedTree<AVLTree<int, int> > tree(1024);
+    for(int i = 0; i < 100000; ++i) {
+        tree.insert(make_pair(i, i));
+    }
+    long sum = 0;
+    for(int round = 0; round < 1000; ++round) {
+        for(int k = 0; k < 16; ++k) {
+            sum += tree.find(k * 6151)->second;
+        }
+    }
+    double rate = tree.hitRate();
+    bool hotOk = rate > 0.95 && sum == 1000L * 6151 * (15 * 16 / 2);
+    tree.resetCacheStats();
+    hotOk = hotOk && tree.cacheHits() == 0 && tree.cacheMisses() == 0;
+
+    // stale entries never come back
+    tree.remove(0);
+    bool invalidateOk = tree.find(0) == tree.end();
+    tree.insert(make_pair(0, 7));
+    invalidateOk = invalidateOk && tree[0] == 7;
+    tree.clear();
+    invalidateOk = invalidateOk && tree.find(6151) == tree.end() && tree.find(0) == tree.end();
+    try {
+        tree[0];
+        invalidateOk = false;
+    }
+    catch(const out_of_range&) {
+    }
+
+    // copies start cold; moves and swaps keep the cache with the nodes
+    CachedTree<AVLTree<int, int> > warm(64);
+    for(int i = 0; i < 100; ++i) {
+        warm.insert(make_pair(i, i));
+        warm.find(i);
+    }
+    CachedTree<AVLTree<int, int> > copy(warm);
+    copy.remove(5);
+    copy[6] = 60;
+    bool copyOk = copy.cacheHits() == 0 && copy.find(5) == copy.end() && warm.find(5)->second == 5 &&
+                  warm[6] == 6 && copy.cacheSlots() == 64;
+    size_t warmHits = warm.cacheHits();
+    CachedTree<AVLTree<int, int> > moved(std::move(warm));
+    copyOk = copyOk && warm.find(7) == warm.end() && moved.find(7)->second == 7 && moved[6] == 6 &&
+             moved.cacheHits() > warmHits && warm.cacheSlots() == 0;
+    warm.insert(make_pair(7, 70));
+    warm.remove(8);
+    copyOk = copyOk && warm[7] == 70 && warm.find(8) == warm.end();
+    moved = std::move(warm);
+    copyOk = copyOk && moved[7] == 70 && moved.cacheSlots() == 0 && warm.cacheSlots() == 64 && warm.empty() &&
+             warm.find(7) == warm.end();
+    warm.insert(make_pair(1, 1));
+    copyOk = copyOk && warm[1] == 1;
+    moved = CachedTree<AVLTree<int, int> >(64);
+    for(int i = 0; i < 100; ++i) moved.insert(make_pair(i, i));
+    moved.find(6);
+    moved[6] = 6;
+    copyOk = copyOk && is_nothrow_move_constructible<CachedTree<AVLTree<int, int> > >::value &&
+             is_nothrow_move_assignable<CachedTree<RBTree<int, int> > >::value;
+    moved.swap(copy);
+    copyOk = copyOk && moved[6] == 60 && copy[6] == 6 && moved.find(5) == moved.end();
+    copy = moved;
+    copyOk = copyOk && copy[6] == 60 && copy.find(5) == copy.end();
+
+    CachedTree<AVLTree<string, int> > names(8);
+    names.insert(make_pair(string("alpha"), 1));
+    names.insert(make_pair(string("beta"), 2));
+    names["alpha"] += 10;
+    bool stringOk = names.find("alpha")->second == 11 && names.find("beta")->second == 2 && names.find("gamma") == names.end();
+
+    cout << "Hot-key hit rate: " << rate << endl;
+    check(randomOk && sizeOk, "Random cached trees");
+    check(hotOk, "Hot keys");
+    check(invalidateOk, "Invalidation");
+    check(stringOk, "String keys");
+    check(copyOk, "Copies");
+    return failures() == 0 ? 0 : 1;
+}
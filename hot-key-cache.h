@@ -0,0 +1,278 @@
+#ifndef HOT_KEY_CACHE_H
+#define HOT_KEY_CACHE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <utility>
+#include <functional>
+#include <stdexcept>
+
+/**
+* Tree with a small direct-mapped cache of key to node in front of its
+* lookups. Every key hashes to one slot holding its hash and a node
+* pointer; a find() or operator[] whose slot holds the key returns that
+* node after one hash and a key check (one call to a three-way Compare,
+* two to a two-way one like std::less), and a miss walks the tree as
+* usual and takes the slot over. Inserts leave the cache alone: a new key
+* gets a new node, an overwrite keeps its node.
+*
+* A node pointer stays right for as long as its node exists. Rotations,
+* rebuilds and nodeSwap only relink nodes, each item staying in the node
+* it was created in, and every tree's remove frees the node holding the
+* removed key (a two-child remove swaps that node down first). So remove
+* drops the key's slot and clear() drops them all, and that is all the
+* invalidation there is.
+*
+* Lookups use internalFind, so in a SplayTree they do not splay, and a
+* hit shows in the tree's statistics as that key check's comparisons.
+*/
+template <typename Tree>
+class CachedTree : public Tree
+{
+public:
+    typedef typename Tree::key_type Key;
+    typedef typename Tree::mapped_type Value;
+
+    // slots is rounded up to a power of two
+    explicit CachedTree(size_t slots = 256);
+    CachedTree(const CachedTree& other);
+    CachedTree(CachedTree&& other) noexcept;
+    CachedTree& operator=(const CachedTree& other);
+    CachedTree& operator=(CachedTree&& other) noexcept;
+
+    virtual void remove(const Key& key);
+    virtual void clear();
+    void swap(CachedTree& other) noexcept;
+    typename Tree::iterator find(const Key& key) const;
+    Value& operator[](const Key& key);
+    Value const & operator[](const Key& key) const;
+
+    size_t cacheSlots() const;
+    size_t cacheHits() const;
+    size_t cacheMisses() const;
+    double hitRate() const;
+    void resetCacheStats();
+
+private:
+    struct Slot
+    {
+        uint64_t hash;
+        Node<Key, Value>* node;   // NULL when empty
+    };
+
+    static uint64_t hashKey(const Key& key);
+    Node<Key, Value>* lookup(const Key& key) const;
+    void forget();
+
+    mutable std::vector<Slot> slots_;
+    int shift_;                 // 64 - log2(slots)
+    mutable size_t hits_;
+    mutable size_t misses_;
+};
+
+/*
+  Begin implementations for the CachedTree class.
+  ----------------------------------------------
+*/
+
+template<typename Tree>
+CachedTree<Tree>::CachedTree(size_t slots) :
+    shift_(63),
+    hits_(0),
+    misses_(0)
+{
+    size_t count = 2;   // at least two, as a shift by 64 is undefined
+    while(count < slots) {
+        count <<= 1;
+        --shift_;
+    }
+    Slot empty = { 0, nullptr };
+    slots_.assign(count, empty);
+}
+
+/**
+* A copy starts with an empty cache of the same size (slots are
+* value-initialized, so empty).
+*/
+template<typename Tree>
+CachedTree<Tree>::CachedTree(const CachedTree& other) :
+    Tree(other),
+    slots_(other.slots_.size()),
+    shift_(other.shift_),
+    hits_(0),
+    misses_(0)
+{
+
+}
+
+/**
+* The slots go with the nodes. other is left with no cache at all
+* (cacheSlots() is 0), which its lookups then skip; that keeps the move
+* free of allocation.
+*/
+template<typename Tree>
+CachedTree<Tree>::CachedTree(CachedTree&& other) noexcept :
+    Tree(std::move(other)),
+    slots_(std::move(other.slots_)),
+    shift_(other.shift_),
+    hits_(other.hits_),
+    misses_(other.misses_)
+{
+    other.slots_.clear();
+}
+
+template<typename Tree>
+CachedTree<Tree>& CachedTree<Tree>::operator=(const CachedTree& other)
+{
+    Tree::operator=(other);   // clears this cache on the way
+    return *this;
+}
+
+/**
+* The slots go with the nodes; other gets this cache's slots, emptied, as
+* the nodes they pointed to are gone.
+*/
+template<typename Tree>
+CachedTree<Tree>& CachedTree<Tree>::operator=(CachedTree&& other) noexcept
+{
+    if(this != &other) {
+        Tree::operator=(std::move(other));
+        slots_.swap(other.slots_);
+        std::swap(shift_, other.shift_);
+        std::swap(hits_, other.hits_);
+        std::swap(misses_, other.misses_);
+        other.forget();
+    }
+    return *this;
+}
+
+template<typename Tree>
+void CachedTree<Tree>::swap(CachedTree& other) noexcept
+{
+    Tree::swap(other);
+    slots_.swap(other.slots_);
+    std::swap(shift_, other.shift_);
+    std::swap(hits_, other.hits_);
+    std::swap(misses_, other.misses_);
+}
+
+template<typename Tree>
+void CachedTree<Tree>::remove(const Key& key)
+{
+    if(!slots_.empty()) slots_[hashKey(key) >> shift_].node = nullptr;
+    Tree::remove(key);
+}
+
+template<typename Tree>
+void CachedTree<Tree>::clear()
+{
+    Tree::clear();
+    forget();
+}
+
+template<typename Tree>
+typename Tree::iterator CachedTree<Tree>::find(const Key& key) const
+{
+    return this->iteratorAt(lookup(key));
+}
+
+template<typename Tree>
+typename CachedTree<Tree>::Value& CachedTree<Tree>::operator[](const Key& key)
+{
+    Node<Key, Value>* node = lookup(key);
+    if(node == nullptr) throw std::out_of_range("Invalid key");
+    return node->getValue();
+}
+
+template<typename Tree>
+typename CachedTree<Tree>::Value const & CachedTree<Tree>::operator[](const Key& key) const
+{
+    Node<Key, Value>* node = lookup(key);
+    if(node == nullptr) throw std::out_of_range("Invalid key");
+    return node->getValue();
+}
+
+template<typename Tree>
+size_t CachedTree<Tree>::cacheSlots() const
+{
+    return slots_.size();
+}
+
+template<typename Tree>
+size_t CachedTree<Tree>::cacheHits() const
+{
+    return hits_;
+}
+
+/**
+* Lookups that walked the tree, including those for absent keys.
+*/
+template<typename Tree>
+size_t CachedTree<Tree>::cacheMisses() const
+{
+    return misses_;
+}
+
+template<typename Tree>
+double CachedTree<Tree>::hitRate() const
+{
+    size_t lookups = hits_ + misses_;
+    return lookups == 0 ? 0.0 : (double)hits_ / lookups;
+}
+
+template<typename Tree>
+void CachedTree<Tree>::resetCacheStats()
+{
+    hits_ = 0;
+    misses_ = 0;
+}
+
+/**
+* std::hash times 2^64 / phi; the slot index is the top bits, which the
+* multiply mixes best (std::hash is the identity for integers).
+*/
+template<typename Tree>
+uint64_t CachedTree<Tree>::hashKey(const Key& key)
+{
+    return (uint64_t)std::hash<Key>()(key) * 0x9e3779b97f4a7c15ull;
+}
+
+/**
+* The node for key, from its slot if the slot holds it and otherwise from
+* the tree, in which case the slot now does. Absent keys are not cached.
+*/
+template<typename Tree>
+Node<typename Tree::key_type, typename Tree::mapped_type>* CachedTree<Tree>::lookup(const Key& key) const
+{
+    if(slots_.empty()) return this->internalFind(key);   // moved from
+    uint64_t hash = hashKey(key);
+    Slot& slot = slots_[hash >> shift_];
+    if(slot.node != nullptr && slot.hash == hash && this->keyOrder(slot.node->getKey(), key) == 0) {
+        ++hits_;
+        return slot.node;
+    }
+    ++misses_;
+    Node<Key, Value>* node = this->internalFind(key);
+    if(node != nullptr) {
+        slot.hash = hash;
+        slot.node = node;
+    }
+    return node;
+}
+
+template<typename Tree>
+void CachedTree<Tree>::forget()
+{
+    for(size_t i = 0; i < slots_.size(); ++i) {
+        slots_[i].node = nullptr;
+    }
+}
+
+/*
+  ----------------------------------------------
+  End implementations for the CachedTree class.
+  ----------------------------------------------
+*/
+
+#endif
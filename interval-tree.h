@@ -0,0 +1,161 @@
+#ifndef INTERVAL_TREE_H
+#define INTERVAL_TREE_H
+
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include "augmented-avl.h"
+
+/**
+* A closed interval [start, end], ordered by start and then end.
+*/
+template <typename Endpoint>
+struct Interval
+{
+    Interval(const Endpoint& s, const Endpoint& e) : start(s), end(e) {}
+
+    bool operator<(const Interval& rhs) const
+    {
+        return start < rhs.start or (!(rhs.start < start) and end < rhs.end);
+    }
+
+    bool operator==(const Interval& rhs) const
+    {
+        return !(start < rhs.start) and !(rhs.start < start) and !(end < rhs.end) and !(rhs.end < end);
+    }
+
+    Endpoint start;
+    Endpoint end;
+};
+
+template <typename Endpoint>
+std::ostream& operator<<(std::ostream& out, const Interval<Endpoint>& interval)
+{
+    return out << '[' << interval.start << ", " << interval.end << ']';
+}
+
+/**
+* Summary for IntervalTree: the largest end in a subtree.
+*/
+template <typename Endpoint>
+struct MaxEndMonoid
+{
+    typedef Endpoint summary_type;
+    static Endpoint identity() { return std::numeric_limits<Endpoint>::lowest(); }
+    template <typename Value>
+    static Endpoint lift(const Interval<Endpoint>& interval, const Value&) { return interval.end; }
+    static Endpoint combine(const Endpoint& a, const Endpoint& b) { return a < b ? b : a; }
+};
+
+/**
+* Intervals with values, keyed by start (then end; one value per distinct
+* interval), for overlap and stabbing queries. Each node keeps the largest
+* end in its subtree, maintained by AugmentedAVLTree through the
+* rotations and nodeSwap. A query walks the tree in order, skips every
+* subtree whose largest end is before the query, and stops at the first
+* start after it. It visits O((k + 1) log n) nodes for k results, and
+* far fewer when the results are clustered, as overlapping intervals are.
+*
+* Queries allocate nothing: they use a fixed stack (an AVL tree is at
+* most about 1.44 log2(n) deep) and write item pointers into the
+* caller's buffer. The pointers stay valid until that item is removed.
+*/
+template <typename Endpoint, typename Value>
+class IntervalTree : public AugmentedAVLTree<Interval<Endpoint>, Value, MaxEndMonoid<Endpoint> >
+{
+public:
+    typedef AugmentedAVLTree<Interval<Endpoint>, Value, MaxEndMonoid<Endpoint> > Base;
+    typedef std::pair<const Interval<Endpoint>, Value> item_type;
+
+    // Deeper than any AVL tree that fits in memory.
+    static const int MAX_DEPTH = 96;
+
+    using Base::insert;
+    using Base::remove;
+    void insert(const Endpoint& start, const Endpoint& end, const Value& value);
+    void remove(const Endpoint& start, const Endpoint& end);
+
+    // The intervals overlapping [lo, hi], in start order. At most capacity
+    // are written to out; returns how many were, stopping early when full.
+    size_t overlaps(const Endpoint& lo, const Endpoint& hi, const item_type** out, size_t capacity) const;
+    // The intervals containing point.
+    size_t stab(const Endpoint& point, const item_type** out, size_t capacity) const;
+    // Calls f(item) for every overlap with [lo, hi]; f returns false to stop.
+    template <typename Func>
+    void forEachOverlap(const Endpoint& lo, const Endpoint& hi, Func f) const;
+};
+
+/*
+  ----------------------------------------------
+  Begin implementations for the IntervalTree class.
+  ----------------------------------------------
+*/
+
+template<typename Endpoint, typename Value>
+void IntervalTree<Endpoint, Value>::insert(const Endpoint& start, const Endpoint& end, const Value& value)
+{
+    if(end < start) throw std::invalid_argument("IntervalTree: interval ends before it starts");
+    Base::insert(item_type(Interval<Endpoint>(start, end), value));
+}
+
+template<typename Endpoint, typename Value>
+void IntervalTree<Endpoint, Value>::remove(const Endpoint& start, const Endpoint& end)
+{
+    Base::remove(Interval<Endpoint>(start, end));
+}
+
+template<typename Endpoint, typename Value>
+size_t IntervalTree<Endpoint, Value>::overlaps(const Endpoint& lo, const Endpoint& hi,
+                                                const item_type** out, size_t capacity) const
+{
+    size_t count = 0;
+    if(capacity == 0) return 0;
+    forEachOverlap(lo, hi, [&](const item_type& item) {
+        out[count++] = &item;
+        return count < capacity;
+    });
+    return count;
+}
+
+template<typename Endpoint, typename Value>
+size_t IntervalTree<Endpoint, Value>::stab(const Endpoint& point, const item_type** out, size_t capacity) const
+{
+    return overlaps(point, point, out, capacity);
+}
+
+/**
+* In-order walk with an explicit stack. Going left stops at a subtree
+* whose largest end is below lo; the walk ends at the first start past
+* hi, since every later one starts later still.
+*/
+template<typename Endpoint, typename Value>
+template<typename Func>
+void IntervalTree<Endpoint, Value>::forEachOverlap(const Endpoint& lo, const Endpoint& hi, Func f) const
+{
+    Node<Interval<Endpoint>, Value>* stack[MAX_DEPTH];
+    int depth = 0;
+    Node<Interval<Endpoint>, Value>* node = this->root_;
+
+    while(true) {
+        while(node != nullptr and !(Base::summaryOf(node) < lo)) {
+            stack[depth++] = node;
+            node = node->getLeft();
+        }
+        if(depth == 0) return;
+
+        node = stack[--depth];
+        const Interval<Endpoint>& interval = node->getKey();
+        if(hi < interval.start) return;
+        if(!(interval.end < lo) and !f(node->getItem())) return;
+        node = node->getRight();
+    }
+}
+
+/*
+  --------------------------------------------
+  End implementations for the IntervalTree class.
+  --------------------------------------------
+*/
+
+#endif
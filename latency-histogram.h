@@ -0,0 +1,484 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <map>
+#include <thread>
+#include <chrono>
+#include <string>
+#include <ostream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/**
+* Reads a cheap timestamp: the TSC where the CPU has one, otherwise the
+* steady clock in nanoseconds. Not serializing, so it can be off by a few
+* cycles around very short operations, which the histogram resolution
+* hides anyway.
+*/
+inline uint64_t readCycleCounter()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+/**
+* Counter ticks per nanosecond, measured once over ~20ms the first time it
+* is needed (never on the recording path).
+*/
+inline double cycleCounterTicksPerNs()
+{
+    static double ticksPerNs = 0;
+    static std::once_flag once;
+    std::call_once(once, [] {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        uint64_t first = readCycleCounter();
+        while(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(20)) {}
+        uint64_t last = readCycleCounter();
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        ticksPerNs = (last - first) / ns;
+        if(ticksPerNs <= 0) ticksPerNs = 1;
+    });
+    return ticksPerNs;
+}
+
+/**
+* A fixed-size log-linear histogram of 64-bit values, in the style of
+* HdrHistogram. Values below 32 get a bucket each; above that, every power
+* of two is split into 32 equal buckets, so any recorded value is known to
+* within about 3%. record() is a few instructions and never allocates.
+*
+* A histogram has a single writer. Counts are relaxed atomics updated with
+* a plain load and store, so another thread may read (or merge) it while
+* it is being written, seeing some recent state.
+*/
+class LatencyHistogram
+{
+public:
+    static const int SUB_BITS = 5;
+    static const int SUB_BUCKETS = 1 << SUB_BITS;
+    static const int NUM_BUCKETS = (64 - SUB_BITS + 1) * SUB_BUCKETS;
+
+    LatencyHistogram();
+
+    void record(uint64_t value);
+    void merge(const LatencyHistogram& other);
+    void reset();
+
+    uint64_t count() const;
+    uint64_t max() const;
+    // Smallest bucket upper bound with at least fraction q of the values
+    // at or below it (never above max()); 0 when empty.
+    uint64_t percentile(double q) const;
+
+    static int bucketOf(uint64_t value);
+    static uint64_t bucketUpperBound(int bucket);
+
+private:
+    LatencyHistogram(const LatencyHistogram&);
+    LatencyHistogram& operator=(const LatencyHistogram&);
+
+    static void bump(std::atomic<uint64_t>& counter, uint64_t amount);
+
+    std::atomic<uint64_t> counts_[NUM_BUCKETS];
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> max_;
+};
+
+/**
+* The operations LatencyTimedTree times.
+*/
+enum LatencyOp { LATENCY_FIND, LATENCY_INSERT, LATENCY_REMOVE, NUM_LATENCY_OPS };
+
+inline const char* latencyOpName(int op)
+{
+    static const char* names[NUM_LATENCY_OPS] = { "find", "insert", "remove" };
+    return names[op];
+}
+
+/**
+* One histogram per operation type.
+*/
+struct OpLatencies
+{
+    LatencyHistogram ops[NUM_LATENCY_OPS];
+
+    void merge(const OpLatencies& other)
+    {
+        for(int op = 0; op < NUM_LATENCY_OPS; ++op) ops[op].merge(other.ops[op]);
+    }
+    void reset()
+    {
+        for(int op = 0; op < NUM_LATENCY_OPS; ++op) ops[op].reset();
+    }
+};
+
+/**
+* Hands every recording thread its own OpLatencies, so threads never share
+* a cache line on the hot path. A thread's set is allocated the first time
+* it records and cached in a thread_local, so later recordings are just a
+* compare and a histogram update. merged() combines all threads.
+*/
+class LatencyRecorder
+{
+public:
+    LatencyRecorder();
+    ~LatencyRecorder();
+
+    OpLatencies& local();
+    void merged(OpLatencies& out) const;
+    void reset();
+
+    /**
+     * Prometheus-style text, in nanoseconds:
+     *   <name>{op="find",quantile="0.99"} 412
+     *   <name>_max{op="find"} 9120
+     *   <name>_count{op="find"} 100000
+     */
+    void exportText(std::ostream& out, const std::string& name = "tree_op_latency_ns") const;
+
+private:
+    LatencyRecorder(const LatencyRecorder&);
+    LatencyRecorder& operator=(const LatencyRecorder&);
+
+    static uint64_t nextId();
+
+    uint64_t id_;       // unique for the process lifetime, unlike an address
+    mutable std::mutex mutex_;
+    std::map<std::thread::id, OpLatencies*> perThread_;
+};
+
+/**
+* Wraps a tree (BinarySearchTree or any subclass) and times every find,
+* operator[], insert and remove into a LatencyRecorder; operator[] counts
+* as a find. The recorder can be the wrapper's own or shared between
+* several trees, e.g. one per thread.
+*
+* insert and remove are virtual and timed however they are called. find
+* and operator[] are not, so only calls through the LatencyTimedTree type
+* are timed: through a Tree& or Tree* they go straight to the tree.
+*/
+template <class Tree>
+class LatencyTimedTree : public Tree
+{
+public:
+    typedef typename Tree::key_type Key;
+    typedef typename Tree::mapped_type Value;
+
+    LatencyTimedTree();
+    explicit LatencyTimedTree(LatencyRecorder& recorder);
+
+    virtual void insert(const std::pair<const Key, Value>& keyValuePair);
+    virtual void remove(const Key& key);
+    typename Tree::iterator find(const Key& key);
+    typename Tree::iterator find(const Key& key) const;
+    Value& operator[](const Key& key);
+    const Value& operator[](const Key& key) const;
+
+    LatencyRecorder& recorder() const;
+
+private:
+    LatencyRecorder own_;
+    LatencyRecorder* recorder_;
+};
+
+/*
+  ---------------------------------------------------
+  Begin implementations for the LatencyHistogram class.
+  ---------------------------------------------------
+*/
+
+inline LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+inline void LatencyHistogram::bump(std::atomic<uint64_t>& counter, uint64_t amount)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+inline int LatencyHistogram::bucketOf(uint64_t value)
+{
+    if(value < (uint64_t)SUB_BUCKETS) return (int)value;
+    int exponent = 63 - __builtin_clzll(value);
+    int sub = (int)((value >> (exponent - SUB_BITS)) & (SUB_BUCKETS - 1));
+    return (exponent - SUB_BITS + 1) * SUB_BUCKETS + sub;
+}
+
+inline uint64_t LatencyHistogram::bucketUpperBound(int bucket)
+{
+    if(bucket < SUB_BUCKETS) return (uint64_t)bucket;
+    int exponent = bucket / SUB_BUCKETS + SUB_BITS - 1;
+    uint64_t sub = (uint64_t)(bucket % SUB_BUCKETS);
+    uint64_t width = (uint64_t)1 << (exponent - SUB_BITS);
+    return ((uint64_t)SUB_BUCKETS + sub) * width + (width - 1);
+}
+
+inline void LatencyHistogram::record(uint64_t value)
+{
+    bump(counts_[bucketOf(value)], 1);
+    bump(count_, 1);
+    if(value > max_.load(std::memory_order_relaxed)) max_.store(value, std::memory_order_relaxed);
+}
+
+/**
+* Adds other's counts into this one. Only the thread that writes this
+* histogram (or nobody) may call it.
+*/
+inline void LatencyHistogram::merge(const LatencyHistogram& other)
+{
+    for(int b = 0; b < NUM_BUCKETS; ++b) {
+        uint64_t n = other.counts_[b].load(std::memory_order_relaxed);
+        if(n != 0) bump(counts_[b], n);
+    }
+    bump(count_, other.count_.load(std::memory_order_relaxed));
+    uint64_t otherMax = other.max_.load(std::memory_order_relaxed);
+    if(otherMax > max_.load(std::memory_order_relaxed)) max_.store(otherMax, std::memory_order_relaxed);
+}
+
+inline void LatencyHistogram::reset()
+{
+    for(int b = 0; b < NUM_BUCKETS; ++b) counts_[b].store(0, std::memory_order_relaxed);
+    count_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+inline uint64_t LatencyHistogram::count() const
+{
+    return count_.load(std::memory_order_relaxed);
+}
+
+inline uint64_t LatencyHistogram::max() const
+{
+    return max_.load(std::memory_order_relaxed);
+}
+
+inline uint64_t LatencyHistogram::percentile(double q) const
+{
+    uint64_t total = count();
+    if(total == 0) return 0;
+    uint64_t rank = (uint64_t)std::ceil(q * total);
+    if(rank < 1) rank = 1;
+    if(rank > total) rank = total;
+    uint64_t seen = 0;
+    for(int b = 0; b < NUM_BUCKETS; ++b) {
+        seen += counts_[b].load(std::memory_order_relaxed);
+        if(seen >= rank) return std::min(bucketUpperBound(b), max());
+    }
+    return max();
+}
+
+/*
+  -------------------------------------------------
+  End implementations for the LatencyHistogram class.
+  -------------------------------------------------
+*/
+
+/*
+  ---------------------------------------------------
+  Begin implementations for the LatencyRecorder class.
+  ---------------------------------------------------
+*/
+
+inline uint64_t LatencyRecorder::nextId()
+{
+    static std::atomic<uint64_t> next(1);
+    return next.fetch_add(1);
+}
+
+inline LatencyRecorder::LatencyRecorder() :
+    id_(nextId())
+{
+
+}
+
+inline LatencyRecorder::~LatencyRecorder()
+{
+    for(std::map<std::thread::id, OpLatencies*>::iterator it = perThread_.begin(); it != perThread_.end(); ++it) {
+        delete it->second;
+    }
+}
+
+inline OpLatencies& LatencyRecorder::local()
+{
+    // One cached (recorder, set) pair per thread covers the common case of
+    // a thread working on one tree; switching recorders takes the lock.
+    static thread_local uint64_t cachedId = 0;
+    static thread_local OpLatencies* cached = nullptr;
+    if(cachedId == id_) return *cached;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    OpLatencies*& slot = perThread_[std::this_thread::get_id()];
+    if(slot == nullptr) slot = new OpLatencies();
+    cachedId = id_;
+    cached = slot;
+    return *slot;
+}
+
+inline void LatencyRecorder::merged(OpLatencies& out) const
+{
+    out.reset();
+    std::lock_guard<std::mutex> lock(mutex_);
+    for(std::map<std::thread::id, OpLatencies*>::const_iterator it = perThread_.begin(); it != perThread_.end(); ++it) {
+        out.merge(*it->second);
+    }
+}
+
+/**
+* Clears every thread's histograms. Only safe while nobody is recording.
+*/
+inline void LatencyRecorder::reset()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for(std::map<std::thread::id, OpLatencies*>::iterator it = perThread_.begin(); it != perThread_.end(); ++it) {
+        it->second->reset();
+    }
+}
+
+inline void LatencyRecorder::exportText(std::ostream& out, const std::string& name) const
+{
+    static const double quantiles[] = { 0.5, 0.99, 0.999 };
+    static const char* labels[] = { "0.5", "0.99", "0.999" };
+    OpLatencies* total = new OpLatencies();    // ~48KB, too big for the stack
+    merged(*total);
+    double ticksPerNs = cycleCounterTicksPerNs();
+    std::ios::fmtflags flags(out.flags());
+    out << std::fixed << std::setprecision(0);
+    for(int op = 0; op < NUM_LATENCY_OPS; ++op) {
+        const LatencyHistogram& h = total->ops[op];
+        for(int q = 0; q < 3; ++q) {
+            out << name << "{op=\"" << latencyOpName(op) << "\",quantile=\"" << labels[q] << "\"} "
+                << h.percentile(quantiles[q]) / ticksPerNs << "\n";
+        }
+        out << name << "_max{op=\"" << latencyOpName(op) << "\"} " << h.max() / ticksPerNs << "\n";
+        out << name << "_count{op=\"" << latencyOpName(op) << "\"} " << h.count() << "\n";
+    }
+    out.flags(flags);
+    delete total;
+}
+
+/*
+  -------------------------------------------------
+  End implementations for the LatencyRecorder class.
+  -------------------------------------------------
+*/
+
+/*
+  ---------------------------------------------------
+  Begin implementations for the LatencyTimedTree class.
+  ---------------------------------------------------
+*/
+
+template<class Tree>
+LatencyTimedTree<Tree>::LatencyTimedTree() :
+    recorder_(&own_)
+{
+
+}
+
+template<class Tree>
+LatencyTimedTree<Tree>::LatencyTimedTree(LatencyRecorder& recorder) :
+    recorder_(&recorder)
+{
+
+}
+
+template<class Tree>
+LatencyRecorder& LatencyTimedTree<Tree>::recorder() const
+{
+    return *recorder_;
+}
+
+template<class Tree>
+void LatencyTimedTree<Tree>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    OpLatencies& local = recorder_->local();
+    uint64_t start = readCycleCounter();
+    Tree::insert(keyValuePair);
+    local.ops[LATENCY_INSERT].record(readCycleCounter() - start);
+}
+
+template<class Tree>
+void LatencyTimedTree<Tree>::remove(const Key& key)
+{
+    OpLatencies& local = recorder_->local();
+    uint64_t start = readCycleCounter();
+    Tree::remove(key);
+    local.ops[LATENCY_REMOVE].record(readCycleCounter() - start);
+}
+
+template<class Tree>
+typename Tree::iterator LatencyTimedTree<Tree>::find(const Key& key)
+{
+    OpLatencies& local = recorder_->local();
+    uint64_t start = readCycleCounter();
+    typename Tree::iterator it = Tree::find(key);
+    local.ops[LATENCY_FIND].record(readCycleCounter() - start);
+    return it;
+}
+
+template<class Tree>
+typename Tree::iterator LatencyTimedTree<Tree>::find(const Key& key) const
+{
+    OpLatencies& local = recorder_->local();
+    uint64_t start = readCycleCounter();
+    typename Tree::iterator it = Tree::find(key);
+    local.ops[LATENCY_FIND].record(readCycleCounter() - start);
+    return it;
+}
+
+/**
+* Timed whether or not the key is there (a missing key throws).
+*/
+template<class Tree>
+typename LatencyTimedTree<Tree>::Value& LatencyTimedTree<Tree>::operator[](const Key& key)
+{
+    OpLatencies& local = recorder_->local();
+    uint64_t start = readCycleCounter();
+    try {
+        Value& value = Tree::operator[](key);
+        local.ops[LATENCY_FIND].record(readCycleCounter() - start);
+        return value;
+    }
+    catch(...) {
+        local.ops[LATENCY_FIND].record(readCycleCounter() - start);
+        throw;
+    }
+}
+
+template<class Tree>
+const typename LatencyTimedTree<Tree>::Value& LatencyTimedTree<Tree>::operator[](const Key& key) const
+{
+    OpLatencies& local = recorder_->local();
+    uint64_t start = readCycleCounter();
+    try {
+        const Value& value = Tree::operator[](key);
+        local.ops[LATENCY_FIND].record(readCycleCounter() - start);
+        return value;
+    }
+    catch(...) {
+        local.ops[LATENCY_FIND].record(readCycleCounter() - start);
+        throw;
+    }
+}
+
+/*
+  -------------------------------------------------
+  End implementations for the LatencyTimedTree class.
+  -------------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,91 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <cstdlib>
+#include <stdexcept>
+#include "bst.h"
+#include "avlbst.h"
+#include "latency-histogram.h"
+#include "test-helpers.h"
+
+using namespace std;
+
+int main()
+{
+    // Every value lands in a bucket whose upper bound is within 1/32 above it
+    bool bucketsOk = true;
+    for(uint64_t v = 0; v < 100000; ++v) {
+        uint64_t upper = LatencyHistogram::bucketUpperBound(LatencyHistogram::bucketOf(v));
+        bucketsOk = bucketsOk && upper >= v && upper - v <= v / 32;
+    }
+    uint64_t big = (uint64_t)1 << 63;
+    bucketsOk = bucketsOk && LatencyHistogram::bucketOf(~(uint64_t)0) == LatencyHistogram::NUM_BUCKETS - 1 &&
+                LatencyHistogram::bucketUpperBound(LatencyHistogram::bucketOf(big)) >= big;
+    check(bucketsOk, "Bucket bounds");
+
+    // Percentiles of 1..10000
+    LatencyHistogram* h = new LatencyHistogram();
+    for(uint64_t v = 1; v <= 10000; ++v) h->record(v);
+    uint64_t p50 = h->percentile(0.5), p99 = h->percentile(0.99), p999 = h->percentile(0.999);
+    bool percentilesOk = h->count() == 10000 && h->max() == 10000 &&
+                         p50 >= 5000 && p50 <= 5000 + 5000 / 32 &&
+                         p99 >= 9900 && p99 <= 9900 + 9900 / 32 &&
+                         p999 >= 9990 && p999 <= 10000 && h->percentile(1.0) == 10000;
+    check(percentilesOk, "Percentiles");
+    cout << "  p50 " << p50 << ", p99 " << p99 << ", p999 " << p999 << endl;
+    delete h;
+
+    // The wrapper records one sample per operation
+    LatencyTimedTree<AVLTree<int, int> > timed;
+    for(int i = 0; i < 1000; ++i) timed.insert(make_pair(i, i));
+    for(int i = 0; i < 500; ++i) timed.find(i);
+    for(int i = 0; i < 250; ++i) timed.remove(i);
+    OpLatencies* totals = new OpLatencies();
+    timed.recorder().merged(*totals);
+    bool wrapperOk = totals->ops[LATENCY_INSERT].count() == 1000 && totals->ops[LATENCY_FIND].count() == 500 &&
+                     totals->ops[LATENCY_REMOVE].count() == 250 && timed.find(999) != timed.end() &&
+                     timed.find(0) == timed.end();
+    check(wrapperOk, "Timed tree");
+
+    // operator[] is timed as a find, a missing key included; calls through
+    // the base type are not timed
+    const LatencyTimedTree<AVLTree<int, int> >& constTimed = timed;
+    timed[999] = 7;
+    bool indexOk = constTimed[999] == 7;
+    try {
+        timed[0];
+        indexOk = false;
+    }
+    catch(const std::out_of_range&) {
+    }
+    AVLTree<int, int>& base = timed;
+    base.find(999);
+    timed.recorder().merged(*totals);
+    indexOk = indexOk && totals->ops[LATENCY_FIND].count() == 505;
+    check(indexOk, "Timed operator[]");
+
+    // Four threads, one tree each, one shared recorder
+    LatencyRecorder shared;
+    vector<thread> threads;
+    for(int t = 0; t < 4; ++t) {
+        threads.push_back(thread([&shared, t] {
+            LatencyTimedTree<AVLTree<int, int> > tree(shared);
+            for(int i = 0; i < 10000; ++i) tree.insert(make_pair(i * 4 + t, i));
+            for(int i = 0; i < 10000; ++i) tree.remove(i * 4 + t);
+        }));
+    }
+    for(size_t t = 0; t < threads.size(); ++t) threads[t].join();
+    shared.merged(*totals);
+    ostringstream text;
+    shared.exportText(text);
+    bool threadsOk = totals->ops[LATENCY_INSERT].count() == 40000 && totals->ops[LATENCY_REMOVE].count() == 40000 &&
+                     text.str().find("tree_op_latency_ns_count{op=\"remove\"} 40000") != string::npos &&
+                     text.str().find("tree_op_latency_ns{op=\"insert\",quantile=\"0.999\"}") != string::npos;
+    check(threadsOk, "Per-thread merge");
+    cout << text.str();
+    delete totals;
+
+    return failures() == 0 ? 0 : 1;
+}
@@ -0,0 +1,130 @@
+#include <iostream>
+#include <map>
+#include <string>
+#include <cstdlib>
+#include <utility>
+#include <stdexcept>
+#include "bst.h"
+#include "avlbst.h"
+#include "node-pool.h"
+#include "test-helpers.h"
+
+using namespace std;
+
+size_t countItems(const PooledAVLTree<int, int>& tree)
+{
+    size_t count = 0;
+    for(PooledAVLTree<int, int>::iterator it = tree.begin(); it != tree.end(); ++it) ++count;
+    return count;
+}
+
+// The pool holds exactly the tree's nodes.
+bool poolMatches(const PooledAVLTree<int, int>& tree)
+{
+    size_t count = countItems(tree);
+    if(tree.pool() == NULL) return count == 0;
+    return tree.pool()->slotsInUse() == count &&
+           tree.pool()->bytesMapped() >= count * tree.pool()->slotSize();
+}
+
+int main()
+{
+    PooledAVLTree<int, int> small(false);
+    PooledAVLTree<int, int> huge(true);
+    // enough keys to span several chunks, with freed slots reused along the way
+    OpMix mix(1, 2, 0, 1);
+    bool randomOk = matchesMap(small, 1, 200000, 20000, mix) && matchesMap(huge, 2, 200000, 20000, mix) &&
+                    small.isBalanced() && huge.isBalanced() && poolMatches(small) && poolMatches(huge);
+
+    // chunks are 2MB with huge pages, and each came from one of the three sources
+    const NodePool* pool = huge.pool();
+    bool hugeOk = pool != NULL && pool->hugePages() && pool->bytesMapped() == pool->chunks() * NodePool::HUGE_PAGE &&
+                  pool->hugeChunks() + pool->advisedChunks() <= pool->chunks();
+    for(int i = 0; i < 100000; ++i) huge.insert(make_pair(i, i));
+    hugeOk = hugeOk && poolMatches(huge) && huge.pool()->chunks() > 1 &&
+             (size_t)huge.pool()->slotsInUse() * huge.pool()->slotSize() <= huge.pool()->bytesMapped();
+
+    // freed slots are reused before the pool grows
+    PooledAVLTree<int, int> reuse(false);
+    for(int i = 0; i < 10000; ++i) reuse.insert(make_pair(i, i));
+    size_t mapped = reuse.pool()->bytesMapped();
+    for(int round = 0; round < 5; ++round) {
+        for(int i = 0; i < 10000; i += 2) reuse.remove(i);
+        for(int i = 0; i < 10000; i += 2) reuse.insert(make_pair(i, round));
+    }
+    reuse.clear();
+    bool reuseOk = reuse.pool()->bytesMapped() == mapped && reuse.pool()->slotsInUse() == 0 && poolMatches(reuse);
+
+    // NUMA binding: only the online nodes are real, binding to one must
+    // not lose data even where mbind is refused
+    vector<int> nodes = NodePool::onlineNodes();
+    PooledAVLTree<int, int> bound(true, nodes.back());
+    for(int i = 0; i < 50000; ++i) bound.insert(make_pair(i, 2 * i));
+    bool numaOk = !nodes.empty() && NodePool::currentNode() >= 0 && bound[49999] == 99998 &&
+                  bound.pool()->numaNode() == nodes.back() && bound.pool()->numaFailures() <= bound.pool()->chunks();
+    if(bound.pool()->numaFailures() == 0) {
+        int node = NodePool::nodeOf(&bound[0]);
+        numaOk = numaOk && (node == -1 || node == nodes.back());
+    }
+
+    // copies get their own pool with the same options
+    PooledAVLTree<int, int> copy(huge);
+    bool copyOk = copy.pool() != huge.pool() && copy.pool()->hugePages() && poolMatches(copy) &&
+                  countItems(copy) == countItems(huge) && copy.isBalanced();
+    copy.insert(make_pair(-1, -1));
+    copyOk = copyOk && huge.find(-1) == huge.end() && copy[-1] == -1;
+    PooledAVLTree<int, int> assigned(false);
+    assigned.insert(make_pair(5, 5));
+    assigned = copy;
+    copyOk = copyOk && countItems(assigned) == countItems(copy) && poolMatches(assigned) && assigned[-1] == -1;
+    assigned = assigned;
+    copyOk = copyOk && countItems(assigned) == countItems(copy);
+
+    // moves and swaps take the pool along with the nodes
+    const NodePool* hugePool = huge.pool();
+    size_t hugeCount = countItems(huge);
+    PooledAVLTree<int, int> moved(std::move(huge));
+    bool moveOk = moved.pool() == hugePool && huge.pool() == NULL && huge.empty() && countItems(moved) == hugeCount;
+    huge.insert(make_pair(1, 1));
+    moveOk = moveOk && huge.pool() != NULL && poolMatches(huge);
+    moved.swap(small);
+    moveOk = moveOk && small.pool() == hugePool && poolMatches(small) && poolMatches(moved) &&
+             !moved.pool()->hugePages();
+    moved = std::move(small);
+    moveOk = moveOk && moved.pool() == hugePool && countItems(moved) == hugeCount && poolMatches(moved);
+
+    // replicas stay identical, and lookups go to the caller's node
+    NumaReplicatedTree<int, int> replicated(true);
+    for(int i = 0; i < 20000; ++i) replicated.insert(make_pair(i, i));
+    for(int i = 0; i < 20000; i += 3) replicated.remove(i);
+    bool replicaOk = replicated.replicas() == nodes.size() && !replicated.empty();
+    for(size_t r = 0; r < replicated.replicas(); ++r) replicaOk = replicaOk && replicated.nodeOf(r) == nodes[r];
+    size_t found = 0;
+    for(int i = 0; i < 20000; ++i) {
+        if(replicated.find(i) != replicated.end()) {
+            ++found;
+            replicaOk = replicaOk && i % 3 != 0 && replicated[i] == i;
+        }
+    }
+    size_t lookups = 0;
+    for(size_t r = 0; r < replicated.replicas(); ++r) lookups += replicated.lookups(r);
+    replicaOk = replicaOk && found == 20000 - 6667 && lookups == 20000 + found;
+    replicaOk = replicaOk && replicated.contains(1) && !replicated.contains(3) && !replicated.contains(-1);
+    try {
+        replicated[0];
+        replicaOk = false;
+    }
+    catch(const out_of_range&) {
+    }
+    replicated.clear();
+    replicaOk = replicaOk && replicated.empty() && poolMatches(replicated.local());
+
+    check(randomOk, "Random pooled trees");
+    check(hugeOk, "Huge pages");
+    check(reuseOk, "Slot reuse");
+    check(numaOk, "NUMA binding");
+    check(copyOk, "Copies");
+    check(moveOk, "Moves and swaps");
+    check(replicaOk, "Replicas");
+    return failures() == 0 ? 0 : 1;
+}
@@ -0,0 +1,691 @@
+#ifndef NODE_POOL_H
+#define NODE_POOL_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <utility>
+#include <functional>
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+#include "bst.h"
+#include "avlbst.h"
+
+/**
+* Fixed-size slots for tree nodes, carved out of 2MB chunks instead of
+* one new per node, so a large tree sits on few pages and few TLB
+* entries. With hugePages each chunk is first asked for as a hugetlbfs
+* page (MAP_HUGETLB, which needs pages reserved in
+* /proc/sys/vm/nr_hugepages), then as a 2MB-aligned mapping advised for
+* transparent huge pages (MADV_HUGEPAGE), then as ordinary pages;
+* hugeChunks() and advisedChunks() tell which happened. Without it the
+* chunks are smaller and ordinary.
+*
+* With numaNode >= 0 every chunk is bound to that NUMA node (mbind)
+* before it is touched. A failed bind leaves the chunk wherever the
+* kernel puts it and is counted in numaFailures().
+*
+* Freed slots are reused, newest first; chunks go back only when the
+* pool is destroyed, which must be after every slot is freed. Like the
+* trees, a pool is for one thread at a time.
+*/
+class NodePool
+{
+public:
+    static const size_t HUGE_PAGE = 2 * 1024 * 1024;
+    static const size_t SMALL_CHUNK = 256 * 1024;
+
+    NodePool(size_t slotSize, size_t alignment, bool hugePages = true, int numaNode = -1);
+    ~NodePool();
+
+    void* allocate();
+    void deallocate(void* slot);
+
+    size_t slotSize() const;
+    bool hugePages() const;
+    int numaNode() const;
+
+    size_t slotsInUse() const;
+    size_t chunks() const;
+    size_t hugeChunks() const;      // hugetlbfs pages
+    size_t advisedChunks() const;   // transparent huge page candidates
+    size_t bytesMapped() const;
+    size_t numaFailures() const;
+
+    // The NUMA node holding the page at address, or -1 if unknown.
+    static int nodeOf(const void* address);
+    // The NUMA node of the CPU the caller runs on (0 if unknown).
+    static int currentNode();
+    // The online NUMA nodes, from sysfs ({0} if unknown).
+    static std::vector<int> onlineNodes();
+    // Transparent huge pages backing this process, in kB (-1 if unknown).
+    static long anonHugePagesKb();
+
+private:
+    NodePool(const NodePool&);
+    NodePool& operator=(const NodePool&);
+
+    void grow();
+    char* mapChunk(size_t bytes);
+
+    size_t slotSize_;
+    bool hugePages_;
+    int numaNode_;
+    size_t chunkSize_;
+    void* free_;            // freed slots, linked through their first word
+    char* next_;            // unused part of the newest chunk
+    char* end_;
+    size_t slotsInUse_;
+    size_t hugeChunks_;
+    size_t advisedChunks_;
+    size_t numaFailures_;
+    std::vector<std::pair<char*, size_t> > chunks_;
+};
+
+/**
+* An AVLTree whose nodes live in its own NodePool, for large trees where
+* TLB misses and remote NUMA memory dominate lookups. The pool is made on
+* the first insert; copies use a pool with the same options and are made
+* on one thread, as the pool is not thread-safe.
+*/
+template <class Key, class Value, class Compare = std::less<Key>, class Stats = NullTreeStats>
+class PooledAVLTree : public AVLTree<Key, Value, Compare, Stats>
+{
+public:
+    explicit PooledAVLTree(bool hugePages = true, int numaNode = -1, const Compare& comp = Compare());
+    PooledAVLTree(const PooledAVLTree& other);
+    PooledAVLTree(PooledAVLTree&& other) noexcept;
+    PooledAVLTree& operator=(const PooledAVLTree& other);
+    PooledAVLTree& operator=(PooledAVLTree&& other) noexcept;
+    virtual ~PooledAVLTree();
+
+    void swap(PooledAVLTree& other) noexcept;
+
+    // NULL until the first node is made.
+    const NodePool* pool() const;
+
+protected:
+    virtual Node<Key, Value>* createNode(const Key& key, const Value& value, Node<Key, Value>* parent);
+    virtual Node<Key, Value>* cloneNode(const Node<Key, Value>* source, Node<Key, Value>* parent) const;
+    virtual void destroyNode(Node<Key, Value>* node);
+    virtual void cloneContents(const BinarySearchTree<Key, Value, Compare, Stats>& other, unsigned threads);
+
+    NodePool& slots() const;
+
+    bool hugePages_;
+    int numaNode_;
+    mutable std::unique_ptr<NodePool> pool_;
+};
+
+/**
+* A read-mostly tree kept once per NUMA node: each replica is a
+* PooledAVLTree bound to its node, updates go to every replica, and
+* lookups read the replica of the node the calling thread runs on, so
+* they never cross the interconnect. Costs a copy of the tree per node.
+* lookups(replica) counts the lookups each replica has served. Lookups
+* may run concurrently with each other (not with updates); each replica's
+* counter is a relaxed atomic two cache lines from the next, so readers
+* on different nodes do not share a line.
+*/
+template <class Key, class Value, class Compare = std::less<Key> >
+class NumaReplicatedTree
+{
+public:
+    typedef PooledAVLTree<Key, Value, Compare> Replica;
+    typedef typename Replica::iterator iterator;
+
+    explicit NumaReplicatedTree(bool hugePages = true);
+
+    void insert(const std::pair<const Key, Value>& keyValuePair);
+    void remove(const Key& key);
+    void clear();
+
+    // find() may be served by a different replica than a later call if the
+    // thread migrates; compare its result against end() here, which every
+    // replica shares, not against local().end().
+    iterator find(const Key& key) const;
+    iterator end() const;
+    bool contains(const Key& key) const;
+    const Value& operator[](const Key& key) const;
+    bool empty() const;
+
+    // The replica for the caller's node; iterate it for ordered access,
+    // taking begin() and end() from the same reference.
+    const Replica& local() const;
+    size_t replicas() const;
+    int nodeOf(size_t replica) const;
+    size_t lookups(size_t replica) const;
+
+private:
+    NumaReplicatedTree(const NumaReplicatedTree&);
+    NumaReplicatedTree& operator=(const NumaReplicatedTree&);
+
+    struct Counter
+    {
+        std::atomic<size_t> lookups;
+        char padding[128 - sizeof(std::atomic<size_t>)];
+    };
+
+    size_t localIndex() const;
+
+    std::vector<int> nodes_;
+    std::vector<std::unique_ptr<Replica> > replicas_;
+    std::unique_ptr<Counter[]> counters_;
+};
+
+/*
+  ----------------------------------------------
+  Begin implementations for the NodePool class.
+  ----------------------------------------------
+*/
+
+inline NodePool::NodePool(size_t slotSize, size_t alignment, bool hugePages, int numaNode) :
+    hugePages_(hugePages),
+    numaNode_(numaNode),
+    chunkSize_(hugePages ? HUGE_PAGE : SMALL_CHUNK),
+    free_(NULL),
+    next_(NULL),
+    end_(NULL),
+    slotsInUse_(0),
+    hugeChunks_(0),
+    advisedChunks_(0),
+    numaFailures_(0)
+{
+    if(alignment < sizeof(void*)) alignment = sizeof(void*);
+    if(slotSize < sizeof(void*)) slotSize = sizeof(void*);
+    slotSize_ = (slotSize + alignment - 1) / alignment * alignment;
+}
+
+inline NodePool::~NodePool()
+{
+    for(size_t i = 0; i < chunks_.size(); ++i) {
+#ifdef __linux__
+        munmap(chunks_[i].first, chunks_[i].second);
+#else
+        std::free(chunks_[i].first);
+#endif
+    }
+}
+
+inline void* NodePool::allocate()
+{
+    void* slot = free_;
+    if(slot != NULL) {
+        free_ = *static_cast<void**>(slot);
+    }
+    else {
+        if(next_ == end_) grow();
+        slot = next_;
+        next_ += slotSize_;
+    }
+    ++slotsInUse_;
+    return slot;
+}
+
+inline void NodePool::deallocate(void* slot)
+{
+    *static_cast<void**>(slot) = free_;
+    free_ = slot;
+    --slotsInUse_;
+}
+
+inline size_t NodePool::slotSize() const
+{
+    return slotSize_;
+}
+
+inline bool NodePool::hugePages() const
+{
+    return hugePages_;
+}
+
+inline int NodePool::numaNode() const
+{
+    return numaNode_;
+}
+
+inline size_t NodePool::slotsInUse() const
+{
+    return slotsInUse_;
+}
+
+inline size_t NodePool::chunks() const
+{
+    return chunks_.size();
+}
+
+inline size_t NodePool::hugeChunks() const
+{
+    return hugeChunks_;
+}
+
+inline size_t NodePool::advisedChunks() const
+{
+    return advisedChunks_;
+}
+
+inline size_t NodePool::bytesMapped() const
+{
+    size_t bytes = 0;
+    for(size_t i = 0; i < chunks_.size(); ++i) bytes += chunks_[i].second;
+    return bytes;
+}
+
+inline size_t NodePool::numaFailures() const
+{
+    return numaFailures_;
+}
+
+/**
+* Starts a new chunk; the unused tail of the old one (less than a slot)
+* is dropped.
+*/
+inline void NodePool::grow()
+{
+    char* chunk = mapChunk(chunkSize_);
+    next_ = chunk;
+    end_ = chunk + chunkSize_ / slotSize_ * slotSize_;
+}
+
+/**
+* One chunk, trying the huge page options in order when asked to. The
+* NUMA binding comes before anything touches the memory, since pages are
+* placed when first written.
+*/
+inline char* NodePool::mapChunk(size_t bytes)
+{
+#ifdef __linux__
+    const int prot = PROT_READ | PROT_WRITE;
+    const int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    char* chunk = NULL;
+    void* p = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    if(hugePages_) p = mmap(NULL, bytes, prot, flags | MAP_HUGETLB, -1, 0);
+#endif
+    if(p != MAP_FAILED) {
+        chunk = static_cast<char*>(p);
+        ++hugeChunks_;
+    }
+    else if(hugePages_) {
+        // twice the size, then trim to the 2MB-aligned middle
+        p = mmap(NULL, 2 * bytes, prot, flags, -1, 0);
+        if(p == MAP_FAILED) throw std::bad_alloc();
+        char* raw = static_cast<char*>(p);
+        chunk = raw + (HUGE_PAGE - (size_t)raw % HUGE_PAGE) % HUGE_PAGE;
+        if(chunk != raw) munmap(raw, chunk - raw);
+        munmap(chunk + bytes, raw + 2 * bytes - (chunk + bytes));
+#ifdef MADV_HUGEPAGE
+        if(madvise(chunk, bytes, MADV_HUGEPAGE) == 0) ++advisedChunks_;
+#endif
+    }
+    else {
+        p = mmap(NULL, bytes, prot, flags, -1, 0);
+        if(p == MAP_FAILED) throw std::bad_alloc();
+        chunk = static_cast<char*>(p);
+    }
+    chunks_.push_back(std::make_pair(chunk, bytes));
+
+    if(numaNode_ >= 0) {
+        const int MPOL_BIND_MODE = 2;   // MPOL_BIND in <numaif.h>
+        const size_t MASK_WORDS = 16;
+        unsigned long mask[MASK_WORDS];
+        memset(mask, 0, sizeof(mask));
+        const size_t wordBits = 8 * sizeof(unsigned long);
+        if((size_t)numaNode_ >= MASK_WORDS * wordBits or
+           syscall(SYS_mbind, chunk, bytes, MPOL_BIND_MODE,
+                   (mask[numaNode_ / wordBits] |= 1UL << (numaNode_ % wordBits), mask),
+                   MASK_WORDS * wordBits + 1, 0) != 0) {
+            ++numaFailures_;
+        }
+    }
+    return chunk;
+#else
+    char* chunk = static_cast<char*>(std::malloc(bytes));
+    if(chunk == NULL) throw std::bad_alloc();
+    chunks_.push_back(std::make_pair(chunk, bytes));
+    if(numaNode_ >= 0) ++numaFailures_;
+    return chunk;
+#endif
+}
+
+inline int NodePool::nodeOf(const void* address)
+{
+#ifdef __linux__
+    const unsigned long MPOL_F_NODE_FLAG = 1, MPOL_F_ADDR_FLAG = 2;   // from <numaif.h>
+    int node = -1;
+    if(syscall(SYS_get_mempolicy, &node, NULL, 0, address, MPOL_F_NODE_FLAG | MPOL_F_ADDR_FLAG) == 0) return node;
+#endif
+    (void)address;
+    return -1;
+}
+
+inline int NodePool::currentNode()
+{
+#ifdef __linux__
+    unsigned cpu = 0, node = 0;
+    if(syscall(SYS_getcpu, &cpu, &node, NULL) == 0) return (int)node;
+#endif
+    return 0;
+}
+
+/**
+* Parses a sysfs node list such as "0-1,3".
+*/
+inline std::vector<int> NodePool::onlineNodes()
+{
+    std::vector<int> nodes;
+    FILE* file = std::fopen("/sys/devices/system/node/online", "r");
+    if(file != NULL) {
+        int first, last;
+        char separator;
+        while(std::fscanf(file, "%d", &first) == 1) {
+            last = first;
+            separator = (char)std::fgetc(file);
+            if(separator == '-') {
+                if(std::fscanf(file, "%d", &last) != 1) break;
+                separator = (char)std::fgetc(file);
+            }
+            for(int node = first; node <= last; ++node) nodes.push_back(node);
+            if(separator != ',') break;
+        }
+        std::fclose(file);
+    }
+    if(nodes.empty()) nodes.push_back(0);
+    return nodes;
+}
+
+inline long NodePool::anonHugePagesKb()
+{
+    FILE* file = std::fopen("/proc/self/smaps_rollup", "r");
+    if(file == NULL) return -1;
+    long kb = -1;
+    char line[256];
+    while(std::fgets(line, sizeof(line), file) != NULL) {
+        if(std::sscanf(line, "AnonHugePages: %ld kB", &kb) == 1) break;
+    }
+    std::fclose(file);
+    return kb;
+}
+
+/*
+  --------------------------------------------
+  End implementations for the NodePool class.
+  --------------------------------------------
+*/
+
+/*
+  ---------------------------------------------------
+  Begin implementations for the PooledAVLTree class.
+  ---------------------------------------------------
+*/
+
+template<class Key, class Value, class Compare, class Stats>
+PooledAVLTree<Key, Value, Compare, Stats>::PooledAVLTree(bool hugePages, int numaNode, const Compare& comp) :
+    AVLTree<Key, Value, Compare, Stats>(comp),
+    hugePages_(hugePages),
+    numaNode_(numaNode)
+{
+
+}
+
+template<class Key, class Value, class Compare, class Stats>
+PooledAVLTree<Key, Value, Compare, Stats>::PooledAVLTree(const PooledAVLTree& other) :
+    AVLTree<Key, Value, Compare, Stats>(other.key_comp()),
+    hugePages_(other.hugePages_),
+    numaNode_(other.numaNode_)
+{
+    this->cloneContents(other, 1);
+}
+
+/**
+* The pool goes with the nodes; other makes a new one if it is reused.
+*/
+template<class Key, class Value, class Compare, class Stats>
+PooledAVLTree<Key, Value, Compare, Stats>::PooledAVLTree(PooledAVLTree&& other) noexcept :
+    AVLTree<Key, Value, Compare, Stats>(std::move(other)),
+    hugePages_(other.hugePages_),
+    numaNode_(other.numaNode_),
+    pool_(std::move(other.pool_))
+{
+
+}
+
+template<class Key, class Value, class Compare, class Stats>
+PooledAVLTree<Key, Value, Compare, Stats>& PooledAVLTree<Key, Value, Compare, Stats>::operator=(const PooledAVLTree& other)
+{
+    this->copyFrom(other);
+    return *this;
+}
+
+template<class Key, class Value, class Compare, class Stats>
+PooledAVLTree<Key, Value, Compare, Stats>& PooledAVLTree<Key, Value, Compare, Stats>::operator=(PooledAVLTree&& other) noexcept
+{
+    if(this != &other) {
+        PooledAVLTree old(std::move(other));
+        swap(old);
+    }
+    return *this;
+}
+
+/**
+* The nodes are freed here, while destroyNode still returns them to the
+* pool; the base destructor would delete them.
+*/
+template<class Key, class Value, class Compare, class Stats>
+PooledAVLTree<Key, Value, Compare, Stats>::~PooledAVLTree()
+{
+    this->clear();
+}
+
+template<class Key, class Value, class Compare, class Stats>
+void PooledAVLTree<Key, Value, Compare, Stats>::swap(PooledAVLTree& other) noexcept
+{
+    AVLTree<Key, Value, Compare, Stats>::swap(other);
+    std::swap(hugePages_, other.hugePages_);
+    std::swap(numaNode_, other.numaNode_);
+    pool_.swap(other.pool_);
+}
+
+template<class Key, class Value, class Compare, class Stats>
+const NodePool* PooledAVLTree<Key, Value, Compare, Stats>::pool() const
+{
+    return pool_.get();
+}
+
+template<class Key, class Value, class Compare, class Stats>
+Node<Key, Value>* PooledAVLTree<Key, Value, Compare, Stats>::createNode(const Key& key, const Value& value,
+                                                                        Node<Key, Value>* parent)
+{
+    this->stats_.allocation();
+    void* slot = slots().allocate();
+    try {
+        return new(slot) AVLNode<Key, Value>(key, value, static_cast<AVLNode<Key, Value>*>(parent));
+    }
+    catch(...) {
+        pool_->deallocate(slot);
+        throw;
+    }
+}
+
+template<class Key, class Value, class Compare, class Stats>
+Node<Key, Value>* PooledAVLTree<Key, Value, Compare, Stats>::cloneNode(const Node<Key, Value>* source,
+                                                                       Node<Key, Value>* parent) const
+{
+    void* slot = slots().allocate();
+    try {
+        AVLNode<Key, Value>* node = new(slot) AVLNode<Key, Value>(source->getKey(), source->getValue(),
+                                                                  static_cast<AVLNode<Key, Value>*>(parent));
+        node->setBalance(static_cast<const AVLNode<Key, Value>*>(source)->getBalance());
+        return node;
+    }
+    catch(...) {
+        pool_->deallocate(slot);
+        throw;
+    }
+}
+
+template<class Key, class Value, class Compare, class Stats>
+void PooledAVLTree<Key, Value, Compare, Stats>::destroyNode(Node<Key, Value>* node)
+{
+    this->stats_.deallocation();
+    node->~Node<Key, Value>();
+    pool_->deallocate(node);
+}
+
+template<class Key, class Value, class Compare, class Stats>
+void PooledAVLTree<Key, Value, Compare, Stats>::cloneContents(const BinarySearchTree<Key, Value, Compare, Stats>& other,
+                                                              unsigned)
+{
+    AVLTree<Key, Value, Compare, Stats>::cloneContents(other, 1);
+}
+
+template<class Key, class Value, class Compare, class Stats>
+NodePool& PooledAVLTree<Key, Value, Compare, Stats>::slots() const
+{
+    if(pool_ == nullptr) {
+        pool_.reset(new NodePool(sizeof(AVLNode<Key, Value>), alignof(AVLNode<Key, Value>), hugePages_, numaNode_));
+    }
+    return *pool_;
+}
+
+/*
+  -------------------------------------------------
+  End implementations for the PooledAVLTree class.
+  -------------------------------------------------
+*/
+
+/*
+  --------------------------------------------------------
+  Begin implementations for the NumaReplicatedTree class.
+  --------------------------------------------------------
+*/
+
+template<class Key, class Value, class Compare>
+NumaReplicatedTree<Key, Value, Compare>::NumaReplicatedTree(bool hugePages) :
+    nodes_(NodePool::onlineNodes())
+{
+    for(size_t i = 0; i < nodes_.size(); ++i) {
+        replicas_.push_back(std::unique_ptr<Replica>(new Replica(hugePages, nodes_[i])));
+    }
+    counters_.reset(new Counter[nodes_.size()]);
+    for(size_t i = 0; i < nodes_.size(); ++i) counters_[i].lookups.store(0);
+}
+
+template<class Key, class Value, class Compare>
+void NumaReplicatedTree<Key, Value, Compare>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    for(size_t i = 0; i < replicas_.size(); ++i) replicas_[i]->insert(keyValuePair);
+}
+
+template<class Key, class Value, class Compare>
+void NumaReplicatedTree<Key, Value, Compare>::remove(const Key& key)
+{
+    for(size_t i = 0; i < replicas_.size(); ++i) replicas_[i]->remove(key);
+}
+
+template<class Key, class Value, class Compare>
+void NumaReplicatedTree<Key, Value, Compare>::clear()
+{
+    for(size_t i = 0; i < replicas_.size(); ++i) replicas_[i]->clear();
+}
+
+template<class Key, class Value, class Compare>
+typename NumaReplicatedTree<Key, Value, Compare>::iterator
+NumaReplicatedTree<Key, Value, Compare>::find(const Key& key) const
+{
+    size_t index = localIndex();
+    counters_[index].lookups.fetch_add(1, std::memory_order_relaxed);
+    return replicas_[index]->find(key);
+}
+
+/**
+* The end of every replica: a null iterator, the same for all of them.
+*/
+template<class Key, class Value, class Compare>
+typename NumaReplicatedTree<Key, Value, Compare>::iterator
+NumaReplicatedTree<Key, Value, Compare>::end() const
+{
+    return replicas_[0]->end();
+}
+
+/**
+* Looks key up in one replica and tests the result against that same
+* replica.
+*/
+template<class Key, class Value, class Compare>
+bool NumaReplicatedTree<Key, Value, Compare>::contains(const Key& key) const
+{
+    size_t index = localIndex();
+    counters_[index].lookups.fetch_add(1, std::memory_order_relaxed);
+    const Replica& replica = *replicas_[index];
+    return replica.find(key) != replica.end();
+}
+
+template<class Key, class Value, class Compare>
+const Value& NumaReplicatedTree<Key, Value, Compare>::operator[](const Key& key) const
+{
+    size_t index = localIndex();
+    counters_[index].lookups.fetch_add(1, std::memory_order_relaxed);
+    const Replica& replica = *replicas_[index];
+    return replica[key];
+}
+
+template<class Key, class Value, class Compare>
+bool NumaReplicatedTree<Key, Value, Compare>::empty() const
+{
+    return replicas_[0]->empty();
+}
+
+template<class Key, class Value, class Compare>
+const typename NumaReplicatedTree<Key, Value, Compare>::Replica& NumaReplicatedTree<Key, Value, Compare>::local() const
+{
+    return *replicas_[localIndex()];
+}
+
+template<class Key, class Value, class Compare>
+size_t NumaReplicatedTree<Key, Value, Compare>::replicas() const
+{
+    return replicas_.size();
+}
+
+template<class Key, class Value, class Compare>
+int NumaReplicatedTree<Key, Value, Compare>::nodeOf(size_t replica) const
+{
+    return nodes_[replica];
+}
+
+template<class Key, class Value, class Compare>
+size_t NumaReplicatedTree<Key, Value, Compare>::lookups(size_t replica) const
+{
+    return counters_[replica].lookups.load(std::memory_order_relaxed);
+}
+
+/**
+* The replica of the caller's node, or the first one if that node has
+* none (a node without memory).
+*/
+template<class Key, class Value, class Compare>
+size_t NumaReplicatedTree<Key, Value, Compare>::localIndex() const
+{
+    int node = NodePool::currentNode();
+    for(size_t i = 0; i < nodes_.size(); ++i) {
+        if(nodes_[i] == node) return i;
+    }
+    return 0;
+}
+
+/*
+  ------------------------------------------------------
+  End implementations for the NumaReplicatedTree class.
+  ------------------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,75 @@
+#include <iostream>
+#include <map>
+#include <cstdlib>
+#include <unistd.h>
+#include "paged-bst.h"
+#include "test-helpers.h"
+
+using namespace std;
+
+template<typename Key, typename Value>
+bool sameContents(const PagedBST<Key, Value>& tree, const map<Key, Value>& expected)
+{
+    typename map<Key, Value>::const_iterator e = expected.begin();
+    for(typename PagedBST<Key, Value>::iterator it = tree.begin(); it != tree.end(); ++it, ++e) {
+        if(e == expected.end() || it->first != e->first || it->second != e->second) return false;
+    }
+    return e == expected.end() && tree.size() == expected.size();
+}
+
+int main()
+{
+    char pathTemplate[] = "/tmp/paged-bst-test-XXXXXX";
+    int fd = mkstemp(pathTemplate);
+    close(fd);
+    string path = pathTemplate;
+
+    map<int, long> expected;
+    {
+        // 8 pages of 1K each: far smaller than the data, so pages are evicted
+        PagedBST<int, long> tree(path, 8 * 1024, 1024, true);
+        srand(104);
+        for(int i = 0; i < 20000; ++i) {
+            int key = rand() % 5000;
+            if(rand() % 3 == 0) {
+                tree.remove(key);
+                expected.erase(key);
+            }
+            else {
+                tree.insert(make_pair(key, (long)i));
+                expected[key] = i;
+            }
+        }
+        check(sameContents(tree, expected), "Random insert/remove");
+        check(tree.height() <= 18, "Height stays logarithmic");
+
+        PagedBST<int, long>::iterator it = tree.find(expected.begin()->first);
+        check(it != tree.end() && it->second == expected.begin()->second, "Find present key");
+        check(tree.find(-1) == tree.end(), "Find missing key");
+        check(tree[expected.rbegin()->first] == expected.rbegin()->second, "operator[]");
+
+        const PageStats& stats = tree.pageStats();
+        check(stats.misses > 0 && stats.evictions > 0, "Buffer pool evicts under budget");
+        cout << "  hits " << stats.hits << " misses " << stats.misses
+             << " evictions " << stats.evictions << " writebacks " << stats.writebacks << endl;
+
+        // an overwrite rewrites one page and removing a missing key none;
+        // the header page goes back on every flush
+        tree.flush();
+        tree.resetPageStats();
+        tree.insert(make_pair(expected.begin()->first, -1L));
+        expected[expected.begin()->first] = -1;
+        tree.remove(-1);
+        tree.flush();
+        check(tree.pageStats().writebacks <= 2, "Unchanged path not rewritten");
+    }
+    {
+        PagedBST<int, long> tree(path, 8 * 1024, 1024);
+        check(sameContents(tree, expected), "Reopen from file");
+        tree.clear();
+        check(tree.empty() && tree.begin() == tree.end(), "Clear");
+    }
+
+    unlink(path.c_str());
+    return failures() == 0 ? 0 : 1;
+}
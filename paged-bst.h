@@ -0,0 +1,843 @@
+#ifndef PAGED_BST_H
+#define PAGED_BST_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+
+/**
+* Counters reported by the buffer pool of a PagedBST.
+*/
+struct PageStats
+{
+    PageStats() : hits(0), misses(0), evictions(0), writebacks(0) {}
+
+    uint64_t hits;        // page requests served from memory
+    uint64_t misses;      // page requests that had to read the file
+    uint64_t evictions;   // frames reused for a different page
+    uint64_t writebacks;  // dirty pages written back to the file
+};
+
+/**
+* A fixed-size page cache over a file using the CLOCK (second chance)
+* replacement policy. Memory use is bounded by the number of frames
+* chosen at construction; pages outside the pool live only on disk.
+*
+* Pointers returned by getPage() are only valid until the next call,
+* which may evict the frame they point into.
+*/
+class BufferPool
+{
+public:
+    BufferPool(int fd, size_t pageSize, size_t numFrames);
+    ~BufferPool();
+
+    char* getPage(uint64_t pageId, bool forWrite);
+    // Throws on a failed write; the destructor's own flush cannot.
+    void flush();
+
+    size_t pageSize() const { return pageSize_; }
+    size_t numFrames() const { return frames_.size(); }
+    const PageStats& stats() const { return stats_; }
+    void resetStats() { stats_ = PageStats(); }
+
+private:
+    BufferPool(const BufferPool&);
+    BufferPool& operator=(const BufferPool&);
+
+    struct Frame
+    {
+        Frame() : pageId(0), valid(false), referenced(false), dirty(false) {}
+        uint64_t pageId;
+        bool valid;
+        bool referenced;
+        bool dirty;
+    };
+
+    size_t chooseVictim();
+    void writeBack(size_t frame);
+
+    int fd_;
+    size_t pageSize_;
+    std::vector<char> memory_;
+    std::vector<Frame> frames_;
+    std::unordered_map<uint64_t, size_t> pageTable_;
+    size_t hand_;
+    PageStats stats_;
+};
+
+/**
+* An ordered map whose nodes live in fixed-size pages of a file and are
+* cached through a BufferPool with a configurable memory budget, so the
+* data set may be much larger than RAM.
+*
+* The tree is AVL balanced (each node stores its height) so lookups read
+* O(log n) pages. Keys and values must be trivially copyable, since nodes
+* are stored as raw bytes. Node id 0 is the null link; page 0 holds the
+* file header.
+*
+* Items are returned by value: operator[] and iterator dereference give
+* copies, and any modification of the tree invalidates iterators.
+*/
+template <typename Key, typename Value>
+class PagedBST
+{
+public:
+    static_assert(std::is_trivially_copyable<Key>::value, "PagedBST keys must be trivially copyable");
+    static_assert(std::is_trivially_copyable<Value>::value, "PagedBST values must be trivially copyable");
+
+    /**
+    * Opens path (creating it if missing or if truncate is set) with at most
+    * memoryBudget bytes of cached pages.
+    */
+    PagedBST(const std::string& path, size_t memoryBudget,
+             size_t pageSize = 4096, bool truncate = false);
+    ~PagedBST();
+
+    void insert(const std::pair<const Key, Value>& keyValuePair);
+    void remove(const Key& key);
+    void clear();
+    bool empty() const;
+    size_t size() const;
+    int height() const;
+    // Throws on a failed write. The destructor flushes too but swallows
+    // errors, so call this first to find out whether everything landed.
+    void flush();
+
+    class iterator
+    {
+    public:
+        iterator();
+
+        const std::pair<Key, Value>& operator*() const;
+        const std::pair<Key, Value>* operator->() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    protected:
+        friend class PagedBST<Key, Value>;
+        iterator(const PagedBST<Key, Value>* tree, uint64_t current, const std::vector<uint64_t>& pending);
+        void load();
+
+        const PagedBST<Key, Value>* tree_;
+        uint64_t current_;
+        std::vector<uint64_t> pending_;   // ancestors whose left subtree we are in
+        std::pair<Key, Value> item_;
+    };
+
+    iterator begin() const;
+    iterator end() const;
+    iterator find(const Key& key) const;
+    Value operator[](const Key& key) const;
+
+    const PageStats& pageStats() const;
+    void resetPageStats();
+
+protected:
+    struct Record
+    {
+        Key key;
+        Value value;
+        uint64_t left;
+        uint64_t right;
+        int32_t height;
+    };
+
+    struct Header
+    {
+        uint64_t magic;
+        uint64_t pageSize;
+        uint64_t recordSize;
+        uint64_t root;
+        uint64_t count;
+        uint64_t nextId;
+        uint64_t freeList;
+    };
+
+    static const uint64_t MAGIC = 0x5041474544425354ULL; // "PAGEDBST"
+
+    void readRecord(uint64_t id, Record& rec) const;
+    void writeRecord(uint64_t id, const Record& rec);
+    uint64_t allocRecord();
+    void freeRecord(uint64_t id);
+    int heightOf(uint64_t id) const;
+
+    // Height reported by the recursive updates for a subtree whose root and
+    // height are both as they were, so the parent need not be rewritten.
+    static const int UNCHANGED = -1;
+
+    uint64_t insertAt(uint64_t id, const Key& key, const Value& value, int& height);
+    uint64_t removeAt(uint64_t id, const Key& key, int& height);
+    uint64_t removeMax(uint64_t id, Record& removed, int& height);
+    uint64_t rebalance(uint64_t id, Record& rec, int leftHeight, int rightHeight, int& height);
+    uint64_t rotateLeft(uint64_t id, Record& rec);
+    uint64_t rotateRight(uint64_t id, Record& rec);
+
+    int fd_;
+    size_t perPage_;
+    Header header_;
+    mutable BufferPool* pool_;
+};
+
+/*
+  --------------------------------------------
+  Begin implementations for the BufferPool class.
+  --------------------------------------------
+*/
+
+inline BufferPool::BufferPool(int fd, size_t pageSize, size_t numFrames) :
+    fd_(fd),
+    pageSize_(pageSize),
+    memory_(pageSize * numFrames),
+    frames_(numFrames),
+    hand_(0)
+{
+    pageTable_.reserve(numFrames * 2);
+}
+
+inline BufferPool::~BufferPool()
+{
+    // nothing may throw out of a destructor; flush() reports the error
+    try {
+        flush();
+    }
+    catch(const std::exception&) {
+    }
+}
+
+/**
+* Returns the in-memory copy of pageId, reading it on a miss. Pages past the
+* end of the file read as zeroes. forWrite marks the frame dirty.
+*/
+inline char* BufferPool::getPage(uint64_t pageId, bool forWrite)
+{
+    std::unordered_map<uint64_t, size_t>::iterator it = pageTable_.find(pageId);
+    size_t frame;
+    if(it != pageTable_.end()) {
+        ++stats_.hits;
+        frame = it->second;
+    }
+    else {
+        ++stats_.misses;
+        frame = chooseVictim();
+        char* data = &memory_[frame * pageSize_];
+        ssize_t got = ::pread(fd_, data, pageSize_, (off_t)(pageId * pageSize_));
+        if(got < 0) throw std::runtime_error("BufferPool: read failed");
+        std::memset(data + got, 0, pageSize_ - got);
+        frames_[frame].pageId = pageId;
+        frames_[frame].valid = true;
+        frames_[frame].dirty = false;
+        pageTable_[pageId] = frame;
+    }
+    frames_[frame].referenced = true;
+    if(forWrite) frames_[frame].dirty = true;
+    return &memory_[frame * pageSize_];
+}
+
+/**
+* Advances the clock hand to a frame whose reference bit is clear, giving
+* every referenced frame a second chance, and empties it.
+*/
+inline size_t BufferPool::chooseVictim()
+{
+    while(true) {
+        Frame& f = frames_[hand_];
+        size_t frame = hand_;
+        hand_ = (hand_ + 1) % frames_.size();
+        if(!f.valid) return frame;
+        if(f.referenced) {
+            f.referenced = false;
+            continue;
+        }
+        writeBack(frame);
+        pageTable_.erase(f.pageId);
+        f.valid = false;
+        ++stats_.evictions;
+        return frame;
+    }
+}
+
+inline void BufferPool::writeBack(size_t frame)
+{
+    Frame& f = frames_[frame];
+    if(!f.valid || !f.dirty) return;
+    const char* data = &memory_[frame * pageSize_];
+    if(::pwrite(fd_, data, pageSize_, (off_t)(f.pageId * pageSize_)) != (ssize_t)pageSize_) {
+        throw std::runtime_error("BufferPool: write failed");
+    }
+    f.dirty = false;
+    ++stats_.writebacks;
+}
+
+/**
+* Writes every dirty page back to the file.
+*/
+inline void BufferPool::flush()
+{
+    for(size_t i = 0; i < frames_.size(); ++i) {
+        writeBack(i);
+    }
+}
+
+/*
+  ------------------------------------------
+  End implementations for the BufferPool class.
+  ------------------------------------------
+*/
+
+/*
+  ------------------------------------------------------
+  Begin implementations for the PagedBST::iterator class.
+  ------------------------------------------------------
+*/
+
+template<typename Key, typename Value>
+PagedBST<Key, Value>::iterator::iterator() :
+    tree_(NULL),
+    current_(0)
+{
+
+}
+
+template<typename Key, typename Value>
+PagedBST<Key, Value>::iterator::iterator(const PagedBST<Key, Value>* tree, uint64_t current,
+                                         const std::vector<uint64_t>& pending) :
+    tree_(tree),
+    current_(current),
+    pending_(pending)
+{
+    load();
+}
+
+/**
+* Copies the current record's key and value out of the buffer pool.
+*/
+template<typename Key, typename Value>
+void PagedBST<Key, Value>::iterator::load()
+{
+    if(current_ == 0) return;
+    Record rec;
+    tree_->readRecord(current_, rec);
+    item_ = std::make_pair(rec.key, rec.value);
+}
+
+template<typename Key, typename Value>
+const std::pair<Key, Value>& PagedBST<Key, Value>::iterator::operator*() const
+{
+    return item_;
+}
+
+template<typename Key, typename Value>
+const std::pair<Key, Value>* PagedBST<Key, Value>::iterator::operator->() const
+{
+    return &item_;
+}
+
+template<typename Key, typename Value>
+bool PagedBST<Key, Value>::iterator::operator==(const iterator& rhs) const
+{
+    return current_ == rhs.current_;
+}
+
+template<typename Key, typename Value>
+bool PagedBST<Key, Value>::iterator::operator!=(const iterator& rhs) const
+{
+    return current_ != rhs.current_;
+}
+
+/**
+* Advances in key order: the leftmost node of the right subtree if there is
+* one, otherwise the nearest ancestor we descended left from.
+*/
+template<typename Key, typename Value>
+typename PagedBST<Key, Value>::iterator& PagedBST<Key, Value>::iterator::operator++()
+{
+    if(current_ == 0) return *this;
+
+    Record rec;
+    tree_->readRecord(current_, rec);
+    if(rec.right != 0) {
+        uint64_t next = rec.right;
+        tree_->readRecord(next, rec);
+        while(rec.left != 0) {
+            pending_.push_back(next);
+            next = rec.left;
+            tree_->readRecord(next, rec);
+        }
+        current_ = next;
+    }
+    else if(!pending_.empty()) {
+        current_ = pending_.back();
+        pending_.pop_back();
+    }
+    else {
+        current_ = 0;
+    }
+    load();
+    return *this;
+}
+
+/*
+  ----------------------------------------------------
+  End implementations for the PagedBST::iterator class.
+  ----------------------------------------------------
+*/
+
+/*
+  ---------------------------------------------
+  Begin implementations for the PagedBST class.
+  ---------------------------------------------
+*/
+
+template<typename Key, typename Value>
+PagedBST<Key, Value>::PagedBST(const std::string& path, size_t memoryBudget, size_t pageSize, bool truncate) :
+    fd_(-1),
+    perPage_(pageSize / sizeof(Record)),
+    pool_(NULL)
+{
+    if(perPage_ == 0 || pageSize < sizeof(Header)) {
+        throw std::invalid_argument("PagedBST: page size too small for one node");
+    }
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | (truncate ? O_TRUNC : 0), 0644);
+    if(fd_ < 0) throw std::runtime_error("PagedBST: cannot open " + path);
+
+    size_t frames = std::max<size_t>(memoryBudget / pageSize, 2);
+    pool_ = new BufferPool(fd_, pageSize, frames);
+
+    std::memcpy(&header_, pool_->getPage(0, false), sizeof(Header));
+    if(header_.magic != MAGIC) {
+        header_.magic = MAGIC;
+        header_.pageSize = pageSize;
+        header_.recordSize = sizeof(Record);
+        header_.root = 0;
+        header_.count = 0;
+        header_.nextId = perPage_;   // first slot of page 1
+        header_.freeList = 0;
+    }
+    else if(header_.pageSize != pageSize || header_.recordSize != sizeof(Record)) {
+        delete pool_;
+        ::close(fd_);
+        throw std::runtime_error("PagedBST: " + path + " was created with a different layout");
+    }
+}
+
+template<typename Key, typename Value>
+PagedBST<Key, Value>::~PagedBST()
+{
+    // nothing may throw out of a destructor; flush() reports the error
+    try {
+        flush();
+    }
+    catch(const std::exception&) {
+    }
+    delete pool_;
+    ::close(fd_);
+}
+
+/**
+* Writes the header and all dirty pages back to the file.
+*/
+template<typename Key, typename Value>
+void PagedBST<Key, Value>::flush()
+{
+    std::memcpy(pool_->getPage(0, true), &header_, sizeof(Header));
+    pool_->flush();
+}
+
+template<typename Key, typename Value>
+void PagedBST<Key, Value>::readRecord(uint64_t id, Record& rec) const
+{
+    const char* page = pool_->getPage(id / perPage_, false);
+    std::memcpy(&rec, page + (id % perPage_) * sizeof(Record), sizeof(Record));
+}
+
+template<typename Key, typename Value>
+void PagedBST<Key, Value>::writeRecord(uint64_t id, const Record& rec)
+{
+    char* page = pool_->getPage(id / perPage_, true);
+    std::memcpy(page + (id % perPage_) * sizeof(Record), &rec, sizeof(Record));
+}
+
+/**
+* Reuses a slot from the free list (chained through left) or takes the next
+* unused one, so consecutive inserts fill a page before touching another.
+*/
+template<typename Key, typename Value>
+uint64_t PagedBST<Key, Value>::allocRecord()
+{
+    if(header_.freeList != 0) {
+        uint64_t id = header_.freeList;
+        Record rec;
+        readRecord(id, rec);
+        header_.freeList = rec.left;
+        return id;
+    }
+    return header_.nextId++;
+}
+
+template<typename Key, typename Value>
+void PagedBST<Key, Value>::freeRecord(uint64_t id)
+{
+    Record rec;
+    std::memset(&rec, 0, sizeof(rec));
+    rec.left = header_.freeList;
+    writeRecord(id, rec);
+    header_.freeList = id;
+}
+
+template<typename Key, typename Value>
+int PagedBST<Key, Value>::heightOf(uint64_t id) const
+{
+    if(id == 0) return 0;
+    Record rec;
+    readRecord(id, rec);
+    return rec.height;
+}
+
+template<typename Key, typename Value>
+bool PagedBST<Key, Value>::empty() const
+{
+    return header_.root == 0;
+}
+
+template<typename Key, typename Value>
+size_t PagedBST<Key, Value>::size() const
+{
+    return header_.count;
+}
+
+template<typename Key, typename Value>
+int PagedBST<Key, Value>::height() const
+{
+    return heightOf(header_.root);
+}
+
+template<typename Key, typename Value>
+const PageStats& PagedBST<Key, Value>::pageStats() const
+{
+    return pool_->stats();
+}
+
+template<typename Key, typename Value>
+void PagedBST<Key, Value>::resetPageStats()
+{
+    pool_->resetStats();
+}
+
+/**
+* An insert method that overwrites the value if the key is already present.
+*/
+template<typename Key, typename Value>
+void PagedBST<Key, Value>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    int height;
+    header_.root = insertAt(header_.root, keyValuePair.first, keyValuePair.second, height);
+}
+
+/**
+* Inserts into the subtree at id and returns the (possibly new) subtree
+* root, with its new height, or UNCHANGED if neither the root nor the
+* height changed. Only records that actually change are written, so an
+* overwrite dirties one page and the path above a stable height none.
+*/
+template<typename Key, typename Value>
+uint64_t PagedBST<Key, Value>::insertAt(uint64_t id, const Key& key, const Value& value, int& height)
+{
+    Record rec;
+    if(id == 0) {
+        uint64_t newId = allocRecord();
+        std::memset(&rec, 0, sizeof(rec));
+        rec.key = key;
+        rec.value = value;
+        rec.height = 1;
+        writeRecord(newId, rec);
+        ++header_.count;
+        height = 1;
+        return newId;
+    }
+
+    readRecord(id, rec);
+    int childHeight;
+    if(key < rec.key) {
+        uint64_t child = insertAt(rec.left, key, value, childHeight);
+        if(childHeight == UNCHANGED) {
+            height = UNCHANGED;
+            return id;
+        }
+        rec.left = child;
+        return rebalance(id, rec, childHeight, -1, height);
+    }
+    if(rec.key < key) {
+        uint64_t child = insertAt(rec.right, key, value, childHeight);
+        if(childHeight == UNCHANGED) {
+            height = UNCHANGED;
+            return id;
+        }
+        rec.right = child;
+        return rebalance(id, rec, -1, childHeight, height);
+    }
+    rec.value = value;
+    writeRecord(id, rec);
+    height = UNCHANGED;
+    return id;
+}
+
+/**
+* Removes key if present. A node with two children is replaced by its
+* predecessor, matching BinarySearchTree::remove.
+*/
+template<typename Key, typename Value>
+void PagedBST<Key, Value>::remove(const Key& key)
+{
+    int height;
+    header_.root = removeAt(header_.root, key, height);
+}
+
+/**
+* Removes key from the subtree at id; returns the new subtree root and its
+* height as insertAt does. Removing a missing key writes nothing.
+*/
+template<typename Key, typename Value>
+uint64_t PagedBST<Key, Value>::removeAt(uint64_t id, const Key& key, int& height)
+{
+    if(id == 0) {
+        height = UNCHANGED;
+        return 0;
+    }
+
+    Record rec;
+    readRecord(id, rec);
+    int childHeight;
+    if(key < rec.key) {
+        uint64_t child = removeAt(rec.left, key, childHeight);
+        if(childHeight == UNCHANGED) {
+            height = UNCHANGED;
+            return id;
+        }
+        rec.left = child;
+        return rebalance(id, rec, childHeight, -1, height);
+    }
+    if(rec.key < key) {
+        uint64_t child = removeAt(rec.right, key, childHeight);
+        if(childHeight == UNCHANGED) {
+            height = UNCHANGED;
+            return id;
+        }
+        rec.right = child;
+        return rebalance(id, rec, -1, childHeight, height);
+    }
+
+    --header_.count;
+    if(rec.left == 0 || rec.right == 0) {
+        uint64_t child = (rec.left != 0) ? rec.left : rec.right;
+        freeRecord(id);
+        height = heightOf(child);
+        return child;
+    }
+    // Pull the predecessor out of the left subtree and give its slot our
+    // children; the predecessor record keeps its own id.
+    Record pred;
+    uint64_t newLeft = removeMax(rec.left, pred, childHeight);
+    uint64_t predId = pred.left;   // removeMax stashes the id here
+    pred.left = newLeft;
+    pred.right = rec.right;
+    freeRecord(id);
+    uint64_t root = rebalance(predId, pred, childHeight, -1, height);
+    // The subtree has a new root, so its parent always relinks.
+    if(height == UNCHANGED) height = pred.height;
+    return root;
+}
+
+/**
+* Unlinks the largest node of the subtree at id, copying it into removed
+* (with removed.left set to its id), and returns the new subtree root and
+* its height as insertAt does.
+*/
+template<typename Key, typename Value>
+uint64_t PagedBST<Key, Value>::removeMax(uint64_t id, Record& removed, int& height)
+{
+    Record rec;
+    readRecord(id, rec);
+    if(rec.right == 0) {
+        removed = rec;
+        removed.left = id;
+        height = heightOf(rec.left);
+        return rec.left;
+    }
+    int childHeight;
+    uint64_t child = removeMax(rec.right, removed, childHeight);
+    if(childHeight == UNCHANGED) {
+        height = UNCHANGED;
+        return id;
+    }
+    rec.right = child;
+    return rebalance(id, rec, -1, childHeight, height);
+}
+
+/**
+* Recomputes the height of rec (stored at id) after one of its links
+* changed, rotates if its children's heights differ by two, and writes it
+* back. A child height the caller already knows is passed in; -1 reads it
+* from the child's record. Returns the subtree root with its new height,
+* or UNCHANGED if the root is still id at the height rec had.
+*/
+template<typename Key, typename Value>
+uint64_t PagedBST<Key, Value>::rebalance(uint64_t id, Record& rec, int leftHeight, int rightHeight, int& height)
+{
+    if(leftHeight < 0) leftHeight = heightOf(rec.left);
+    if(rightHeight < 0) rightHeight = heightOf(rec.right);
+
+    if(leftHeight - rightHeight > 1) {
+        Record left;
+        readRecord(rec.left, left);
+        if(heightOf(left.left) < heightOf(left.right)) {
+            rec.left = rotateLeft(rec.left, left);
+        }
+        uint64_t root = rotateRight(id, rec);
+        height = heightOf(root);
+        return root;
+    }
+    if(rightHeight - leftHeight > 1) {
+        Record right;
+        readRecord(rec.right, right);
+        if(heightOf(right.right) < heightOf(right.left)) {
+            rec.right = rotateRight(rec.right, right);
+        }
+        uint64_t root = rotateLeft(id, rec);
+        height = heightOf(root);
+        return root;
+    }
+
+    int oldHeight = rec.height;
+    rec.height = 1 + std::max(leftHeight, rightHeight);
+    writeRecord(id, rec);
+    height = (rec.height == oldHeight) ? UNCHANGED : rec.height;
+    return id;
+}
+
+template<typename Key, typename Value>
+uint64_t PagedBST<Key, Value>::rotateLeft(uint64_t id, Record& rec)
+{
+    uint64_t yId = rec.right;
+    Record y;
+    readRecord(yId, y);
+    rec.right = y.left;
+    rec.height = 1 + std::max(heightOf(rec.left), heightOf(rec.right));
+    writeRecord(id, rec);
+    y.left = id;
+    y.height = 1 + std::max(rec.height, heightOf(y.right));
+    writeRecord(yId, y);
+    return yId;
+}
+
+template<typename Key, typename Value>
+uint64_t PagedBST<Key, Value>::rotateRight(uint64_t id, Record& rec)
+{
+    uint64_t yId = rec.left;
+    Record y;
+    readRecord(yId, y);
+    rec.left = y.right;
+    rec.height = 1 + std::max(heightOf(rec.left), heightOf(rec.right));
+    writeRecord(id, rec);
+    y.right = id;
+    y.height = 1 + std::max(heightOf(y.left), rec.height);
+    writeRecord(yId, y);
+    return yId;
+}
+
+/**
+* Drops every node. The file keeps its size; all slots become reusable.
+*/
+template<typename Key, typename Value>
+void PagedBST<Key, Value>::clear()
+{
+    header_.root = 0;
+    header_.count = 0;
+    header_.nextId = perPage_;
+    header_.freeList = 0;
+}
+
+template<typename Key, typename Value>
+typename PagedBST<Key, Value>::iterator PagedBST<Key, Value>::begin() const
+{
+    std::vector<uint64_t> pending;
+    uint64_t id = header_.root;
+    if(id == 0) return end();
+    Record rec;
+    readRecord(id, rec);
+    while(rec.left != 0) {
+        pending.push_back(id);
+        id = rec.left;
+        readRecord(id, rec);
+    }
+    return iterator(this, id, pending);
+}
+
+template<typename Key, typename Value>
+typename PagedBST<Key, Value>::iterator PagedBST<Key, Value>::end() const
+{
+    return iterator(this, 0, std::vector<uint64_t>());
+}
+
+/**
+* Returns an iterator to key, or end() if it is not present.
+*/
+template<typename Key, typename Value>
+typename PagedBST<Key, Value>::iterator PagedBST<Key, Value>::find(const Key& key) const
+{
+    std::vector<uint64_t> pending;
+    uint64_t id = header_.root;
+    Record rec;
+    while(id != 0) {
+        readRecord(id, rec);
+        if(key < rec.key) {
+            pending.push_back(id);
+            id = rec.left;
+        }
+        else if(rec.key < key) {
+            id = rec.right;
+        }
+        else {
+            return iterator(this, id, pending);
+        }
+    }
+    return end();
+}
+
+/**
+* @precondition The key exists in the map
+* Returns a copy of the value associated with the key
+*/
+template<typename Key, typename Value>
+Value PagedBST<Key, Value>::operator[](const Key& key) const
+{
+    uint64_t id = header_.root;
+    Record rec;
+    while(id != 0) {
+        readRecord(id, rec);
+        if(key < rec.key) id = rec.left;
+        else if(rec.key < key) id = rec.right;
+        else return rec.value;
+    }
+    throw std::out_of_range("Invalid key");
+}
+
+/*
+  -------------------------------------------
+  End implementations for the PagedBST class.
+  -------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,156 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <cstdint>
+#include <cstring>
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+/**
+* Hardware counters (cycles, cache misses, branch misses) for the calling
+* thread, read through perf_event_open(2) as one group so all of them
+* cover the same interval. When the kernel or the sandbox does not allow
+* it (no PMU, perf_event_paranoid too high, not Linux), available() is
+* false and start()/stop() do nothing.
+*
+* Data TLB read misses and reads that missed to another NUMA node's
+* memory are counted too where the CPU has those events; has() says
+* which of them are.
+*/
+class PerfCounters
+{
+public:
+    enum Counter { CYCLES, CACHE_MISSES, BRANCH_MISSES, DTLB_MISSES, NODE_MISSES, NUM_COUNTERS };
+
+    PerfCounters();
+    ~PerfCounters();
+
+    bool available() const;
+    // Whether counter is counted; the first three are whenever available().
+    bool has(Counter counter) const;
+    void start();
+    void stop();
+    // Count accumulated between the last start() and stop().
+    uint64_t value(Counter counter) const;
+
+private:
+    PerfCounters(const PerfCounters&);
+    PerfCounters& operator=(const PerfCounters&);
+
+    static const int REQUIRED = DTLB_MISSES;   // counters before this one must open
+
+    int fds_[NUM_COUNTERS];
+    uint64_t values_[NUM_COUNTERS];
+    int opened_;        // counters in the group
+    bool available_;
+};
+
+/*
+  ------------------------------------------------
+  Begin implementations for the PerfCounters class.
+  ------------------------------------------------
+*/
+
+inline PerfCounters::PerfCounters() :
+    opened_(0),
+    available_(false)
+{
+    for(int i = 0; i < NUM_COUNTERS; ++i) {
+        fds_[i] = -1;
+        values_[i] = 0;
+    }
+#ifdef __linux__
+    // cache events are encoded as cache | (operation << 8) | (result << 16)
+    static const uint32_t types[NUM_COUNTERS] = {
+        PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HW_CACHE
+    };
+    static const uint64_t configs[NUM_COUNTERS] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES,
+        PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+        PERF_COUNT_HW_CACHE_NODE | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)
+    };
+    for(int i = 0; i < NUM_COUNTERS; ++i) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.type = types[i];
+        attr.size = sizeof(attr);
+        attr.config = configs[i];
+        attr.disabled = (i == 0);       // the group leader starts everything
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+        fds_[i] = (int)syscall(__NR_perf_event_open, &attr, 0, -1, (i == 0) ? -1 : fds_[0], 0);
+        if(fds_[i] < 0 && i < REQUIRED) {
+            for(int j = 0; j < i; ++j) close(fds_[j]);
+            for(int j = 0; j < NUM_COUNTERS; ++j) fds_[j] = -1;
+            opened_ = 0;
+            return;
+        }
+        if(fds_[i] >= 0) ++opened_;
+    }
+    available_ = true;
+#endif
+}
+
+inline PerfCounters::~PerfCounters()
+{
+#ifdef __linux__
+    for(int i = 0; i < NUM_COUNTERS; ++i) {
+        if(fds_[i] >= 0) close(fds_[i]);
+    }
+#endif
+}
+
+inline bool PerfCounters::available() const
+{
+    return available_;
+}
+
+inline bool PerfCounters::has(Counter counter) const
+{
+    return available_ && fds_[counter] >= 0;
+}
+
+inline void PerfCounters::start()
+{
+#ifdef __linux__
+    if(!available_) return;
+    ioctl(fds_[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(fds_[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+}
+
+inline void PerfCounters::stop()
+{
+#ifdef __linux__
+    if(!available_) return;
+    ioctl(fds_[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    // PERF_FORMAT_GROUP layout: { nr, value[nr] }, in the order opened
+    uint64_t buffer[1 + NUM_COUNTERS];
+    ssize_t expected = (ssize_t)((1 + opened_) * sizeof(uint64_t));
+    if(read(fds_[0], buffer, sizeof(buffer)) != expected) {
+        available_ = false;
+        return;
+    }
+    for(int i = 0, next = 1; i < NUM_COUNTERS; ++i) {
+        values_[i] = fds_[i] >= 0 ? buffer[next++] : 0;
+    }
+#endif
+}
+
+inline uint64_t PerfCounters::value(Counter counter) const
+{
+    return values_[counter];
+}
+
+/*
+  ----------------------------------------------
+  End implementations for the PerfCounters class.
+  ----------------------------------------------
+*/
+
+#endif
@@ -17,8 +17,8 @@
 // 1 means that it is the root.
 // Returns -1 (not found) if the distance is more than PPBST_MAX_HEIGHT,
 // or -2 if the tree is inconsistent.
-template<typename Key, typename Value>
-int getNodeDepth(BinarySearchTree<Key, Value> const & tree, Node<Key, Value> * root, Node<Key, Value> * node)
+template<typename Tree, typename Key, typename Value>
+int getNodeDepth(Tree const & tree, Node<Key, Value> * root, Node<Key, Value> * node)
 {
     int dist = 1;
 
@@ -92,8 +92,8 @@ int getSubtreeHeight(Node<Key, Value> * root, int recursionDepth = 1)
 
     */
 
-template<typename Key, typename Value>
-void BinarySearchTree<Key, Value>::printRoot (Node<Key, Value>* root) const
+template<typename Key, typename Value, typename Compare, typename Stats>
+void BinarySearchTree<Key, Value, Compare, Stats>::printRoot (Node<Key, Value>* root) const
 {
     // special case for empty trees:
     if(root == nullptr)
@@ -127,17 +127,22 @@ void BinarySearchTree<Key, Value>::printRoot (Node<Key, Value>* root) const
 
     // get placeholders
     // ----------------------------------------------------------------------
-    std::map<Key, uint8_t> valuePlaceholders;
+    // keyed by node rather than by Key, which need not have an operator<
+    // (the tree's Compare decides the order); placeholderOrder keeps the
+    // in-order sequence for the legend
+    std::map<Node<Key, Value>*, uint8_t> valuePlaceholders;
+    std::vector<Node<Key, Value>*> placeholderOrder;
 
     uint8_t nextPlaceHolderVal = 1;
-    for(typename BinarySearchTree<Key, Value>::iterator treeIter = this->begin(); treeIter != this->end(); ++treeIter)
+    for(typename BinarySearchTree<Key, Value, Compare, Stats>::iterator treeIter = this->begin(); treeIter != this->end(); ++treeIter)
     {
 
         if(getNodeDepth(*this, root, treeIter.current_) != -1)
         {
             // note; the iterator will traverse in sorted order so values should get the same placeholders between
             // different calls as long as the tree is the same
-            valuePlaceholders.insert(std::make_pair(treeIter->first, nextPlaceHolderVal++));
+            valuePlaceholders.insert(std::make_pair(treeIter.current_, nextPlaceHolderVal++));
+            placeholderOrder.push_back(treeIter.current_);
         }
 
     }
@@ -167,7 +172,7 @@ void BinarySearchTree<Key, Value>::printRoot (Node<Key, Value>* root) const
             }
             else
             {
-                uint16_t placeholder = valuePlaceholders[currRowNodes[elementIndex]->getItem().first];
+                uint16_t placeholder = valuePlaceholders[currRowNodes[elementIndex]];
                 std::cout << "[" << std::setfill('0') << std::setw(2) << placeholder << "]";
             }
 
@@ -265,22 +270,22 @@ void BinarySearchTree<Key, Value>::printRoot (Node<Key, Value>* root) const
     if(!std::is_same<Key, uint8_t>::value) // print placeholder explanations if needed:
     {
         std::cout << "Tree Placeholders:------------------" << std::endl;
-        for(typename std::map<Key, uint8_t>::iterator placeholdersIter = valuePlaceholders.begin(); placeholdersIter != valuePlaceholders.end(); ++placeholdersIter)
+        for(typename std::vector<Node<Key, Value>*>::iterator placeholdersIter = placeholderOrder.begin(); placeholdersIter != placeholderOrder.end(); ++placeholdersIter)
         {
-            std::cout << '[' << std::setfill('0') << std::setw(2) << ((uint16_t)placeholdersIter->second) << "] -> ";
+            std::cout << '[' << std::setfill('0') << std::setw(2) << ((uint16_t)valuePlaceholders[*placeholdersIter]) << "] -> ";
 
             // print element with original cout flags
             std::cout.flags(origCoutState);
-            std::cout << '(' << placeholdersIter->first << ", ";
+            std::cout << '(' << (*placeholdersIter)->getKey() << ", ";
 
-            typename BinarySearchTree<Key, Value>::iterator elementIter = this->find(placeholdersIter->first);
+            typename BinarySearchTree<Key, Value, Compare, Stats>::iterator elementIter = this->find((*placeholdersIter)->getKey());
             if(elementIter == this->end())
             {
                 std::cout << "<error: lookup failed>";
             }
             else
             {
-                std::cout << elementIter->second;
+                std::cout << (*placeholdersIter)->getValue();
             }
 
             std::cout << ')' << std::endl;
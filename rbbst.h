@@ -0,0 +1,410 @@
+#ifndef RBBST_H
+#define RBBST_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include "bst.h"
+
+/**
+* A special kind of node for a Red-Black tree, which adds the color as a
+* data member. Null children count as black leaves.
+*/
+template <typename Key, typename Value>
+class RBNode : public Node<Key, Value>
+{
+public:
+    enum Color { RED, BLACK };
+
+    // Constructor/destructor.
+    RBNode(const Key& key, const Value& value, RBNode<Key, Value>* parent);
+    virtual ~RBNode();
+
+    // Getter/setter for the node's color.
+    Color getColor() const;
+    void setColor(Color color);
+
+    // Getters for parent, left, and right, redefined to return RBNodes
+    // for the same reasons as in AVLNode.
+    virtual RBNode<Key, Value>* getParent() const override;
+    virtual RBNode<Key, Value>* getLeft() const override;
+    virtual RBNode<Key, Value>* getRight() const override;
+
+protected:
+    Color color_;
+};
+
+/*
+  -------------------------------------------------
+  Begin implementations for the RBNode class.
+  -------------------------------------------------
+*/
+
+/**
+* An explicit constructor; new nodes start out red.
+*/
+template<class Key, class Value>
+RBNode<Key, Value>::RBNode(const Key& key, const Value& value, RBNode<Key, Value> *parent) :
+    Node<Key, Value>(key, value, parent), color_(RED)
+{
+
+}
+
+/**
+* A destructor which does nothing.
+*/
+template<class Key, class Value>
+RBNode<Key, Value>::~RBNode()
+{
+
+}
+
+/**
+* A getter for the color of a RBNode.
+*/
+template<class Key, class Value>
+typename RBNode<Key, Value>::Color RBNode<Key, Value>::getColor() const
+{
+    return color_;
+}
+
+/**
+* A setter for the color of a RBNode.
+*/
+template<class Key, class Value>
+void RBNode<Key, Value>::setColor(Color color)
+{
+    color_ = color;
+}
+
+/**
+* An overridden function for getting the parent since a static_cast is necessary to make sure
+* that our node is a RBNode.
+*/
+template<class Key, class Value>
+RBNode<Key, Value> *RBNode<Key, Value>::getParent() const
+{
+    return static_cast<RBNode<Key, Value>*>(this->parent_);
+}
+
+/**
+* Overridden for the same reasons as above.
+*/
+template<class Key, class Value>
+RBNode<Key, Value> *RBNode<Key, Value>::getLeft() const
+{
+    return static_cast<RBNode<Key, Value>*>(this->left_);
+}
+
+/**
+* Overridden for the same reasons as above.
+*/
+template<class Key, class Value>
+RBNode<Key, Value> *RBNode<Key, Value>::getRight() const
+{
+    return static_cast<RBNode<Key, Value>*>(this->right_);
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the RBNode class.
+  -----------------------------------------------
+*/
+
+/**
+* A Red-Black tree. Insertion needs at most 2 rotations and removal at most 3,
+* so rebalancing never walks rotations all the way up the path the way
+* AVLTree::removeFix can; only recolorings propagate upward. Compare and
+* Stats are passed on to BinarySearchTree, as in AVLTree.
+*/
+template <class Key, class Value, class Compare = std::less<Key>, class Stats = NullTreeStats>
+class RBTree : public BinarySearchTree<Key, Value, Compare, Stats>
+{
+public:
+    RBTree() {}
+    explicit RBTree(const Compare& comp) : BinarySearchTree<Key, Value, Compare, Stats>(comp) {}
+    RBTree(const RBTree& other);
+    RBTree(RBTree&& other) noexcept : BinarySearchTree<Key, Value, Compare, Stats>(std::move(other)) {}
+    RBTree& operator=(const RBTree& other);
+    RBTree& operator=(RBTree&& other) noexcept;
+
+    virtual void insert (const std::pair<const Key, Value> &new_item);
+    virtual void remove(const Key& key);
+protected:
+    virtual void nodeSwap( Node<Key,Value>* n1, Node<Key,Value>* n2);
+    virtual Node<Key, Value>* createNode(const Key& key, const Value& value, Node<Key, Value>* parent);
+    virtual Node<Key, Value>* cloneNode(const Node<Key, Value>* source, Node<Key, Value>* parent) const;
+
+    static bool isRed(RBNode<Key, Value>* node);
+    void insertFix(RBNode<Key, Value>* node);
+    void removeFix(RBNode<Key, Value>* node, RBNode<Key, Value>* parent);
+};
+
+/*
+  -----------------------------------------------
+  Begin implementations for the RBTree class.
+  -----------------------------------------------
+*/
+
+/**
+* Copies the shape and every color in O(n).
+*/
+template<class Key, class Value, class Compare, class Stats>
+RBTree<Key, Value, Compare, Stats>::RBTree(const RBTree& other) :
+    BinarySearchTree<Key, Value, Compare, Stats>(other.key_comp())
+{
+    this->cloneContents(other, 1);
+}
+
+template<class Key, class Value, class Compare, class Stats>
+RBTree<Key, Value, Compare, Stats>& RBTree<Key, Value, Compare, Stats>::operator=(const RBTree& other)
+{
+    this->copyFrom(other);
+    return *this;
+}
+
+template<class Key, class Value, class Compare, class Stats>
+RBTree<Key, Value, Compare, Stats>& RBTree<Key, Value, Compare, Stats>::operator=(RBTree&& other) noexcept
+{
+    BinarySearchTree<Key, Value, Compare, Stats>::operator=(std::move(other));
+    return *this;
+}
+
+/*
+ * Recall: If key is already in the tree, you should
+ * overwrite the current value with the updated value.
+ */
+template<class Key, class Value, class Compare, class Stats>
+void RBTree<Key, Value, Compare, Stats>::insert (const std::pair<const Key, Value> &new_item)
+{
+    Node<Key, Value>* attach = nullptr;
+    bool goRight = false;
+    Node<Key, Value>* existing = this->locate(new_item.first, attach, goRight);
+    if(existing != nullptr){
+        existing->setValue(new_item.second);
+        return;
+    }
+
+    RBNode<Key, Value>* newNode =
+        static_cast<RBNode<Key, Value>*>(this->createNode(new_item.first, new_item.second, attach));
+    if(attach == nullptr){
+        this->root_ = newNode;
+    }
+    else if(goRight){
+        attach->setRight(newNode);
+    }
+    else {
+        attach->setLeft(newNode);
+    }
+    insertFix(newNode);
+}
+
+/**
+* Restores the red-black properties after node (red) was linked in:
+* recolor while the uncle is red, then finish with at most two rotations.
+*/
+template<class Key, class Value, class Compare, class Stats>
+void RBTree<Key, Value, Compare, Stats>::insertFix(RBNode<Key, Value>* node)
+{
+    while(isRed(node->getParent())){
+        RBNode<Key, Value>* parent = node->getParent();
+        RBNode<Key, Value>* grandparent = parent->getParent();
+
+        if(parent == grandparent->getLeft()){
+            RBNode<Key, Value>* uncle = grandparent->getRight();
+            if(isRed(uncle)){
+                parent->setColor(RBNode<Key, Value>::BLACK);
+                uncle->setColor(RBNode<Key, Value>::BLACK);
+                grandparent->setColor(RBNode<Key, Value>::RED);
+                node = grandparent;
+                continue;
+            }
+            if(node == parent->getRight()){
+                this->rotateLeft(parent);
+                node = parent;
+                parent = node->getParent();
+            }
+            parent->setColor(RBNode<Key, Value>::BLACK);
+            grandparent->setColor(RBNode<Key, Value>::RED);
+            this->rotateRight(grandparent);
+        }
+        else {
+            RBNode<Key, Value>* uncle = grandparent->getLeft();
+            if(isRed(uncle)){
+                parent->setColor(RBNode<Key, Value>::BLACK);
+                uncle->setColor(RBNode<Key, Value>::BLACK);
+                grandparent->setColor(RBNode<Key, Value>::RED);
+                node = grandparent;
+                continue;
+            }
+            if(node == parent->getLeft()){
+                this->rotateRight(parent);
+                node = parent;
+                parent = node->getParent();
+            }
+            parent->setColor(RBNode<Key, Value>::BLACK);
+            grandparent->setColor(RBNode<Key, Value>::RED);
+            this->rotateLeft(grandparent);
+        }
+    }
+    static_cast<RBNode<Key, Value>*>(this->root_)->setColor(RBNode<Key, Value>::BLACK);
+}
+
+/*
+ * Recall: The writeup specifies that if a node has 2 children you
+ * should swap with the predecessor and then remove.
+ */
+template<class Key, class Value, class Compare, class Stats>
+void RBTree<Key, Value, Compare, Stats>::remove(const Key& key)
+{
+    RBNode<Key, Value>* node = static_cast<RBNode<Key, Value>*>(this->internalFind(key));
+    if(node == nullptr) return;
+
+    if((node->getLeft() != nullptr) and (node->getRight() != nullptr)){
+        nodeSwap(node, this->predecessor(node));
+    }
+
+    RBNode<Key, Value>* parent = node->getParent();
+    RBNode<Key, Value>* child = (node->getLeft() != nullptr) ? node->getLeft() : node->getRight();
+
+    if(parent == nullptr){
+        this->root_ = child;
+    }
+    else if(parent->getLeft() == node){
+        parent->setLeft(child);
+    }
+    else {
+        parent->setRight(child);
+    }
+    if(child != nullptr){
+        child->setParent(parent);
+    }
+
+    bool removedBlack = !isRed(node);
+    this->destroyNode(node);
+
+    if(removedBlack){
+        removeFix(child, parent);
+    }
+}
+
+/**
+* node (possibly null, hence the explicit parent) carries an extra black
+* after a black node was spliced out above it. Push the extra black up by
+* recoloring, or absorb it with at most three rotations.
+*/
+template<class Key, class Value, class Compare, class Stats>
+void RBTree<Key, Value, Compare, Stats>::removeFix(RBNode<Key, Value>* node, RBNode<Key, Value>* parent)
+{
+    while(node != this->root_ and !isRed(node)){
+        if(node == parent->getLeft()){
+            RBNode<Key, Value>* sibling = parent->getRight();
+            if(isRed(sibling)){
+                sibling->setColor(RBNode<Key, Value>::BLACK);
+                parent->setColor(RBNode<Key, Value>::RED);
+                this->rotateLeft(parent);
+                sibling = parent->getRight();
+            }
+            if(!isRed(sibling->getLeft()) and !isRed(sibling->getRight())){
+                sibling->setColor(RBNode<Key, Value>::RED);
+                node = parent;
+                parent = node->getParent();
+                continue;
+            }
+            if(!isRed(sibling->getRight())){
+                sibling->getLeft()->setColor(RBNode<Key, Value>::BLACK);
+                sibling->setColor(RBNode<Key, Value>::RED);
+                this->rotateRight(sibling);
+                sibling = parent->getRight();
+            }
+            sibling->setColor(parent->getColor());
+            parent->setColor(RBNode<Key, Value>::BLACK);
+            sibling->getRight()->setColor(RBNode<Key, Value>::BLACK);
+            this->rotateLeft(parent);
+            node = static_cast<RBNode<Key, Value>*>(this->root_);
+        }
+        else {
+            RBNode<Key, Value>* sibling = parent->getLeft();
+            if(isRed(sibling)){
+                sibling->setColor(RBNode<Key, Value>::BLACK);
+                parent->setColor(RBNode<Key, Value>::RED);
+                this->rotateRight(parent);
+                sibling = parent->getLeft();
+            }
+            if(!isRed(sibling->getLeft()) and !isRed(sibling->getRight())){
+                sibling->setColor(RBNode<Key, Value>::RED);
+                node = parent;
+                parent = node->getParent();
+                continue;
+            }
+            if(!isRed(sibling->getLeft())){
+                sibling->getRight()->setColor(RBNode<Key, Value>::BLACK);
+                sibling->setColor(RBNode<Key, Value>::RED);
+                this->rotateLeft(sibling);
+                sibling = parent->getLeft();
+            }
+            sibling->setColor(parent->getColor());
+            parent->setColor(RBNode<Key, Value>::BLACK);
+            sibling->getLeft()->setColor(RBNode<Key, Value>::BLACK);
+            this->rotateRight(parent);
+            node = static_cast<RBNode<Key, Value>*>(this->root_);
+        }
+    }
+    if(node != nullptr){
+        node->setColor(RBNode<Key, Value>::BLACK);
+    }
+}
+
+/**
+* Null leaves are black.
+*/
+template<class Key, class Value, class Compare, class Stats>
+bool RBTree<Key, Value, Compare, Stats>::isRed(RBNode<Key, Value>* node)
+{
+    return (node != nullptr) and (node->getColor() == RBNode<Key, Value>::RED);
+}
+
+/**
+* Swaps the nodes' positions and their colors, so colors stay with the
+* positions just as balances do in AVLTree::nodeSwap.
+*/
+template<class Key, class Value, class Compare, class Stats>
+void RBTree<Key, Value, Compare, Stats>::nodeSwap( Node<Key,Value>* n1, Node<Key,Value>* n2)
+{
+    if((n1 == n2) || (n1 == NULL) || (n2 == NULL)) {
+        return;
+    }
+    BinarySearchTree<Key, Value, Compare, Stats>::nodeSwap(n1, n2);
+    RBNode<Key, Value>* r1 = static_cast<RBNode<Key, Value>*>(n1);
+    RBNode<Key, Value>* r2 = static_cast<RBNode<Key, Value>*>(n2);
+    typename RBNode<Key, Value>::Color tempC = r1->getColor();
+    r1->setColor(r2->getColor());
+    r2->setColor(tempC);
+}
+
+template<class Key, class Value, class Compare, class Stats>
+Node<Key, Value>* RBTree<Key, Value, Compare, Stats>::createNode(const Key& key, const Value& value,
+                                                                 Node<Key, Value>* parent)
+{
+    this->stats_.allocation();
+    return new RBNode<Key, Value>(key, value, static_cast<RBNode<Key, Value>*>(parent));
+}
+
+template<class Key, class Value, class Compare, class Stats>
+Node<Key, Value>* RBTree<Key, Value, Compare, Stats>::cloneNode(const Node<Key, Value>* source, Node<Key, Value>* parent) const
+{
+    RBNode<Key, Value>* node = new RBNode<Key, Value>(source->getKey(), source->getValue(),
+                                                      static_cast<RBNode<Key, Value>*>(parent));
+    node->setColor(static_cast<const RBNode<Key, Value>*>(source)->getColor());
+    return node;
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the RBTree class.
+  -----------------------------------------------
+*/
+
+#endif
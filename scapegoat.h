@@ -0,0 +1,341 @@
+#ifndef SCAPEGOAT_H
+#define SCAPEGOAT_H
+
+#include <iostream>
+#include <exception>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstddef>
+#include <cmath>
+#include <vector>
+#include "bst.h"
+
+/**
+* A scapegoat tree: a balanced tree that uses the plain Node class and keeps
+* no balance information in the nodes at all, only two counters for the
+* whole tree.
+*
+* alpha (0.5 < alpha < 1) bounds the depth to log_{1/alpha}(n). When an
+* insert lands deeper than that, the nearest ancestor whose child subtree
+* holds more than alpha of its nodes (the scapegoat) is flattened and
+* rebuilt perfectly balanced in linear time. After enough removes the whole
+* tree is rebuilt the same way. Updates are O(log n) amortized. Smaller
+* alpha means shallower trees but more frequent rebuilds.
+*
+* Compare and Stats are passed on to BinarySearchTree, as in AVLTree.
+*/
+template <class Key, class Value, class Compare = std::less<Key>, class Stats = NullTreeStats>
+class ScapegoatTree : public BinarySearchTree<Key, Value, Compare, Stats>
+{
+public:
+    ScapegoatTree(double alpha = 0.7, const Compare& comp = Compare());
+    ScapegoatTree(const ScapegoatTree& other);
+    ScapegoatTree(ScapegoatTree&& other) noexcept;
+    ScapegoatTree& operator=(const ScapegoatTree& other);
+    ScapegoatTree& operator=(ScapegoatTree&& other) noexcept;
+
+    virtual void insert (const std::pair<const Key, Value> &new_item);
+    virtual void remove(const Key& key);
+    virtual void clear();
+    void swap(ScapegoatTree& other) noexcept;
+
+    double getAlpha() const;
+    size_t size() const;
+    size_t rebuilds() const;
+
+protected:
+    virtual void cloneContents(const BinarySearchTree<Key, Value, Compare, Stats>& other, unsigned threads);
+    int depthLimit() const;
+    static size_t subtreeSize(Node<Key, Value>* node);
+    void rebuild(Node<Key, Value>* node, size_t count);
+    static Node<Key, Value>* buildBalanced(std::vector<Node<Key, Value>*>& nodes,
+                                           size_t lo, size_t hi, Node<Key, Value>* parent);
+
+    double alpha_;
+    double logInvAlpha_;
+    size_t size_;       // number of nodes
+    size_t maxSize_;    // largest size_ since the last full rebuild
+    size_t rebuilds_;
+};
+
+/*
+  ---------------------------------------------------
+  Begin implementations for the ScapegoatTree class.
+  ---------------------------------------------------
+*/
+
+template<class Key, class Value, class Compare, class Stats>
+ScapegoatTree<Key, Value, Compare, Stats>::ScapegoatTree(double alpha, const Compare& comp) :
+    BinarySearchTree<Key, Value, Compare, Stats>(comp),
+    alpha_(alpha),
+    logInvAlpha_(std::log(1.0 / alpha)),
+    size_(0),
+    maxSize_(0),
+    rebuilds_(0)
+{
+    if(!(alpha > 0.5 && alpha < 1.0)) {
+        throw std::invalid_argument("ScapegoatTree alpha must be in (0.5, 1)");
+    }
+}
+
+/**
+* A copy has the same shape, so it needs no rebuild; its rebuild count
+* starts from zero.
+*/
+template<class Key, class Value, class Compare, class Stats>
+ScapegoatTree<Key, Value, Compare, Stats>::ScapegoatTree(const ScapegoatTree& other) :
+    BinarySearchTree<Key, Value, Compare, Stats>(other),
+    alpha_(other.alpha_),
+    logInvAlpha_(other.logInvAlpha_),
+    size_(other.size_),
+    maxSize_(other.maxSize_),
+    rebuilds_(0)
+{
+
+}
+
+template<class Key, class Value, class Compare, class Stats>
+ScapegoatTree<Key, Value, Compare, Stats>::ScapegoatTree(ScapegoatTree&& other) noexcept :
+    BinarySearchTree<Key, Value, Compare, Stats>(std::move(other)),
+    alpha_(other.alpha_),
+    logInvAlpha_(other.logInvAlpha_),
+    size_(other.size_),
+    maxSize_(other.maxSize_),
+    rebuilds_(other.rebuilds_)
+{
+    other.size_ = 0;
+    other.maxSize_ = 0;
+}
+
+template<class Key, class Value, class Compare, class Stats>
+ScapegoatTree<Key, Value, Compare, Stats>& ScapegoatTree<Key, Value, Compare, Stats>::operator=(const ScapegoatTree& other)
+{
+    if(this != &other) {
+        this->copyFrom(other);
+        alpha_ = other.alpha_;
+        logInvAlpha_ = other.logInvAlpha_;
+    }
+    return *this;
+}
+
+template<class Key, class Value, class Compare, class Stats>
+ScapegoatTree<Key, Value, Compare, Stats>& ScapegoatTree<Key, Value, Compare, Stats>::operator=(ScapegoatTree&& other) noexcept
+{
+    if(this != &other) {
+        ScapegoatTree old(std::move(other));
+        swap(old);
+    }
+    return *this;
+}
+
+template<class Key, class Value, class Compare, class Stats>
+void ScapegoatTree<Key, Value, Compare, Stats>::swap(ScapegoatTree& other) noexcept
+{
+    BinarySearchTree<Key, Value, Compare, Stats>::swap(other);
+    std::swap(alpha_, other.alpha_);
+    std::swap(logInvAlpha_, other.logInvAlpha_);
+    std::swap(size_, other.size_);
+    std::swap(maxSize_, other.maxSize_);
+    std::swap(rebuilds_, other.rebuilds_);
+}
+
+template<class Key, class Value, class Compare, class Stats>
+void ScapegoatTree<Key, Value, Compare, Stats>::cloneContents(const BinarySearchTree<Key, Value, Compare, Stats>& other, unsigned threads)
+{
+    BinarySearchTree<Key, Value, Compare, Stats>::cloneContents(other, threads);
+    size_ = static_cast<const ScapegoatTree&>(other).size_;
+    maxSize_ = size_;
+}
+
+template<class Key, class Value, class Compare, class Stats>
+double ScapegoatTree<Key, Value, Compare, Stats>::getAlpha() const
+{
+    return alpha_;
+}
+
+template<class Key, class Value, class Compare, class Stats>
+size_t ScapegoatTree<Key, Value, Compare, Stats>::size() const
+{
+    return size_;
+}
+
+/**
+* Number of subtree rebuilds performed so far.
+*/
+template<class Key, class Value, class Compare, class Stats>
+size_t ScapegoatTree<Key, Value, Compare, Stats>::rebuilds() const
+{
+    return rebuilds_;
+}
+
+/**
+* The deepest a node may sit (root = 0): floor(log_{1/alpha}(size)).
+*/
+template<class Key, class Value, class Compare, class Stats>
+int ScapegoatTree<Key, Value, Compare, Stats>::depthLimit() const
+{
+    return (int)std::floor(std::log((double)size_) / logInvAlpha_);
+}
+
+/*
+ * Recall: If key is already in the tree, you should
+ * overwrite the current value with the updated value.
+ */
+template<class Key, class Value, class Compare, class Stats>
+void ScapegoatTree<Key, Value, Compare, Stats>::insert (const std::pair<const Key, Value> &new_item)
+{
+    Node<Key, Value>* parent = nullptr;
+    bool goRight = false;
+    Node<Key, Value>* existing = this->locate(new_item.first, parent, goRight);
+    if(existing != nullptr){
+        existing->setValue(new_item.second);
+        return;
+    }
+
+    Node<Key, Value>* newNode = this->createNode(new_item.first, new_item.second, parent);
+    if(parent == nullptr){
+        this->root_ = newNode;
+    }
+    else if(goRight){
+        parent->setRight(newNode);
+    }
+    else {
+        parent->setLeft(newNode);
+    }
+    ++size_;
+    if(size_ > maxSize_) maxSize_ = size_;
+
+    // the path just searched is still in cache, so counting it again is cheap
+    int depth = 0;
+    for(Node<Key, Value>* up = parent; up != nullptr; up = up->getParent()) ++depth;
+    if(depth <= depthLimit()) return;
+
+    // Too deep: walk up, growing the subtree size, until a child holds
+    // more than alpha of its parent's subtree. Such an ancestor must exist.
+    Node<Key, Value>* child = newNode;
+    size_t childSize = 1;
+    while(child->getParent() != nullptr){
+        Node<Key, Value>* ancestor = child->getParent();
+        Node<Key, Value>* sibling = (ancestor->getLeft() == child) ? ancestor->getRight() : ancestor->getLeft();
+        size_t ancestorSize = childSize + 1 + subtreeSize(sibling);
+        if((double)childSize > alpha_ * (double)ancestorSize){
+            rebuild(ancestor, ancestorSize);
+            return;
+        }
+        child = ancestor;
+        childSize = ancestorSize;
+    }
+}
+
+/*
+ * Recall: The writeup specifies that if a node has 2 children you
+ * should swap with the predecessor and then remove.
+ */
+template<class Key, class Value, class Compare, class Stats>
+void ScapegoatTree<Key, Value, Compare, Stats>::remove(const Key& key)
+{
+    Node<Key, Value>* node = this->internalFind(key);
+    if(node == nullptr) return;
+
+    this->removeNode(node);
+    --size_;
+    if((double)size_ < alpha_ * (double)maxSize_){
+        if(this->root_ != nullptr) rebuild(this->root_, size_);
+        maxSize_ = size_;
+    }
+}
+
+/**
+* Removes everything and resets the size counters.
+*/
+template<class Key, class Value, class Compare, class Stats>
+void ScapegoatTree<Key, Value, Compare, Stats>::clear()
+{
+    BinarySearchTree<Key, Value, Compare, Stats>::clear();
+    size_ = 0;
+    maxSize_ = 0;
+}
+
+/**
+* Counts the nodes below (and including) node without recursion.
+*/
+template<class Key, class Value, class Compare, class Stats>
+size_t ScapegoatTree<Key, Value, Compare, Stats>::subtreeSize(Node<Key, Value>* node)
+{
+    if(node == nullptr) return 0;
+    size_t count = 0;
+    std::vector<Node<Key, Value>*> stack;
+    stack.push_back(node);
+    while(!stack.empty()){
+        Node<Key, Value>* current = stack.back();
+        stack.pop_back();
+        ++count;
+        if(current->getLeft() != nullptr) stack.push_back(current->getLeft());
+        if(current->getRight() != nullptr) stack.push_back(current->getRight());
+    }
+    return count;
+}
+
+/**
+* Flattens the count nodes under node into key order and relinks them as a
+* perfectly balanced subtree in the same place. Linear time; no node is
+* allocated or freed.
+*/
+template<class Key, class Value, class Compare, class Stats>
+void ScapegoatTree<Key, Value, Compare, Stats>::rebuild(Node<Key, Value>* node, size_t count)
+{
+    Node<Key, Value>* parent = node->getParent();
+    bool wasLeft = (parent != nullptr) and (parent->getLeft() == node);
+
+    std::vector<Node<Key, Value>*> nodes;
+    nodes.reserve(count);
+    std::vector<Node<Key, Value>*> stack;
+    Node<Key, Value>* current = node;
+    while(current != nullptr or !stack.empty()){
+        while(current != nullptr){
+            stack.push_back(current);
+            current = current->getLeft();
+        }
+        current = stack.back();
+        stack.pop_back();
+        nodes.push_back(current);
+        current = current->getRight();
+    }
+
+    Node<Key, Value>* top = buildBalanced(nodes, 0, nodes.size(), parent);
+    if(parent == nullptr){
+        this->root_ = top;
+    }
+    else if(wasLeft){
+        parent->setLeft(top);
+    }
+    else {
+        parent->setRight(top);
+    }
+    ++rebuilds_;
+}
+
+/**
+* Links nodes[lo, hi) into a balanced subtree under parent and returns its
+* root. Recursion depth is only log2 of the subtree size.
+*/
+template<class Key, class Value, class Compare, class Stats>
+Node<Key, Value>* ScapegoatTree<Key, Value, Compare, Stats>::buildBalanced(std::vector<Node<Key, Value>*>& nodes,
+                                                           size_t lo, size_t hi, Node<Key, Value>* parent)
+{
+    if(lo >= hi) return nullptr;
+    size_t mid = lo + (hi - lo) / 2;
+    Node<Key, Value>* root = nodes[mid];
+    root->setParent(parent);
+    root->setLeft(buildBalanced(nodes, lo, mid, root));
+    root->setRight(buildBalanced(nodes, mid + 1, hi, root));
+    return root;
+}
+
+/*
+  -------------------------------------------------
+  End implementations for the ScapegoatTree class.
+  -------------------------------------------------
+*/
+
+#endif
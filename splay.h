@@ -0,0 +1,232 @@
+#ifndef SPLAY_H
+#define SPLAY_H
+
+#include <iostream>
+#include <exception>
+#include <cstdlib>
+#include <stdexcept>
+#include "bst.h"
+
+/**
+* A self-adjusting binary search tree. Every find/insert moves the accessed
+* node (or, on a miss, the last node visited) to the root, so frequently
+* used keys stay near the top. It needs no per-node metadata and uses the
+* plain Node class.
+*
+* In SEMI mode (semi-splaying) the zig-zig case performs only one rotation
+* and continues from the parent, roughly halving each access's depth
+* instead of bringing the node all the way up. That does less restructuring
+* for the same amortized bound.
+*
+* Compare and Stats are passed on to BinarySearchTree, as in AVLTree.
+*/
+template <class Key, class Value, class Compare = std::less<Key>, class Stats = NullTreeStats>
+class SplayTree : public BinarySearchTree<Key, Value, Compare, Stats>
+{
+public:
+    enum SplayMode { FULL, SEMI };
+
+    SplayTree(SplayMode mode = FULL, const Compare& comp = Compare());
+
+    virtual void insert (const std::pair<const Key, Value> &new_item);
+    virtual void remove(const Key& key);
+
+    // Lookups on a non-const tree splay; const lookups do not.
+    using BinarySearchTree<Key, Value, Compare, Stats>::find;
+    typename BinarySearchTree<Key, Value, Compare, Stats>::iterator find(const Key& key);
+    Value& operator[](const Key& key);
+    Value const & operator[](const Key& key) const;
+
+    SplayMode getMode() const;
+    void setMode(SplayMode mode);
+
+protected:
+    Node<Key, Value>* splayFind(const Key& key, SplayMode mode);
+    void splay(Node<Key, Value>* node, SplayMode mode);
+    void rotateUp(Node<Key, Value>* node);
+
+    SplayMode mode_;
+};
+
+/*
+  -----------------------------------------------
+  Begin implementations for the SplayTree class.
+  -----------------------------------------------
+*/
+
+template<class Key, class Value, class Compare, class Stats>
+SplayTree<Key, Value, Compare, Stats>::SplayTree(SplayMode mode, const Compare& comp) :
+    BinarySearchTree<Key, Value, Compare, Stats>(comp),
+    mode_(mode)
+{
+
+}
+
+template<class Key, class Value, class Compare, class Stats>
+typename SplayTree<Key, Value, Compare, Stats>::SplayMode SplayTree<Key, Value, Compare, Stats>::getMode() const
+{
+    return mode_;
+}
+
+template<class Key, class Value, class Compare, class Stats>
+void SplayTree<Key, Value, Compare, Stats>::setMode(SplayMode mode)
+{
+    mode_ = mode;
+}
+
+/*
+ * Recall: If key is already in the tree, you should
+ * overwrite the current value with the updated value.
+ */
+template<class Key, class Value, class Compare, class Stats>
+void SplayTree<Key, Value, Compare, Stats>::insert (const std::pair<const Key, Value> &new_item)
+{
+    Node<Key, Value>* parent = nullptr;
+    bool goRight = false;
+    Node<Key, Value>* existing = this->locate(new_item.first, parent, goRight);
+    if(existing != nullptr){
+        existing->setValue(new_item.second);
+        splay(existing, mode_);
+        return;
+    }
+
+    Node<Key, Value>* newNode = this->createNode(new_item.first, new_item.second, parent);
+    if(parent == nullptr){
+        this->root_ = newNode;
+    }
+    else if(goRight){
+        parent->setRight(newNode);
+    }
+    else {
+        parent->setLeft(newNode);
+    }
+    splay(newNode, mode_);
+}
+
+/**
+* Splays the node all the way to the root (regardless of mode), then joins
+* its subtrees by splaying the predecessor to the top of the left subtree
+* (so it has no right child) and hanging the right subtree there.
+*/
+template<class Key, class Value, class Compare, class Stats>
+void SplayTree<Key, Value, Compare, Stats>::remove(const Key& key)
+{
+    Node<Key, Value>* node = splayFind(key, FULL);
+    if(node == nullptr) return;
+
+    Node<Key, Value>* left = node->getLeft();
+    Node<Key, Value>* right = node->getRight();
+
+    if(left == nullptr){
+        this->root_ = right;
+        if(right != nullptr) right->setParent(nullptr);
+    }
+    else {
+        left->setParent(nullptr);
+        this->root_ = left;
+        Node<Key, Value>* pred = left;
+        while(pred->getRight() != nullptr){
+            pred = pred->getRight();
+        }
+        splay(pred, FULL);
+        pred->setRight(right);
+        if(right != nullptr) right->setParent(pred);
+    }
+    this->destroyNode(node);
+}
+
+/**
+* Returns an iterator to the item with the given key, or end() if it does
+* not exist, splaying the last node visited either way.
+*/
+template<class Key, class Value, class Compare, class Stats>
+typename BinarySearchTree<Key, Value, Compare, Stats>::iterator SplayTree<Key, Value, Compare, Stats>::find(const Key& key)
+{
+    return this->iteratorAt(splayFind(key, mode_));
+}
+
+/**
+ * @precondition The key exists in the map
+ * Returns the value associated with the key
+ */
+template<class Key, class Value, class Compare, class Stats>
+Value& SplayTree<Key, Value, Compare, Stats>::operator[](const Key& key)
+{
+    Node<Key, Value>* node = splayFind(key, mode_);
+    if(node == nullptr) throw std::out_of_range("Invalid key");
+    return node->getValue();
+}
+
+template<class Key, class Value, class Compare, class Stats>
+Value const & SplayTree<Key, Value, Compare, Stats>::operator[](const Key& key) const
+{
+    return BinarySearchTree<Key, Value, Compare, Stats>::operator[](key);
+}
+
+/**
+* Looks key up, splays the found node (or the last node on the search
+* path) and returns the found node or NULL.
+*/
+template<class Key, class Value, class Compare, class Stats>
+Node<Key, Value>* SplayTree<Key, Value, Compare, Stats>::splayFind(const Key& key, SplayMode mode)
+{
+    Node<Key, Value>* last = nullptr;
+    bool goRight = false;
+    Node<Key, Value>* found = this->locate(key, last, goRight);
+    if(found != nullptr) splay(found, mode);
+    else if(last != nullptr) splay(last, mode);
+    return found;
+}
+
+/**
+* Rotates node above its parent.
+*/
+template<class Key, class Value, class Compare, class Stats>
+void SplayTree<Key, Value, Compare, Stats>::rotateUp(Node<Key, Value>* node)
+{
+    Node<Key, Value>* parent = node->getParent();
+    if(parent->getLeft() == node){
+        this->rotateRight(parent);
+    }
+    else {
+        this->rotateLeft(parent);
+    }
+}
+
+/**
+* Zig/zig-zig/zig-zag steps until node is the root. In SEMI mode the
+* zig-zig step rotates only the parent and carries on from there.
+*/
+template<class Key, class Value, class Compare, class Stats>
+void SplayTree<Key, Value, Compare, Stats>::splay(Node<Key, Value>* node, SplayMode mode)
+{
+    while(node->getParent() != nullptr){
+        Node<Key, Value>* parent = node->getParent();
+        Node<Key, Value>* grandparent = parent->getParent();
+
+        if(grandparent == nullptr){
+            rotateUp(node);
+        }
+        else if((node == parent->getLeft()) == (parent == grandparent->getLeft())){
+            rotateUp(parent);
+            if(mode == SEMI){
+                node = parent;
+            }
+            else {
+                rotateUp(node);
+            }
+        }
+        else {
+            rotateUp(node);
+            rotateUp(node);
+        }
+    }
+}
+
+/*
+  -----------------------------------------------
+  End implementations for the SplayTree class.
+  -----------------------------------------------
+*/
+
+#endif
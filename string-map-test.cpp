@@ -0,0 +1,142 @@
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <stdexcept>
+#include <utility>
+#include "string-map.h"
+#include "test-helpers.h"
+
+using namespace std;
+
+/**
+ * Collects forEach output, copying the reused key buffer.
+ */
+struct Collect
+{
+    vector<pair<string, int> >* items;
+    void operator()(const string& key, int value) const { items->push_back(make_pair(key, value)); }
+};
+
+/**
+ * A URL-like key: a few hosts and directories with numbered pages, plus
+ * keys that stress the split (no separator, trailing separator, a prefix
+ * that is a prefix of another prefix).
+ */
+string randomKey()
+{
+    static const char* hosts[] = { "https://example.com/", "https://example.com/a/", "https://example.org/docs/" };
+    static const char* dirs[] = { "", "img/", "api/v1/users/", "a" };
+    int kind = rand() % 20;
+    if(kind == 0) return string("key") + char('a' + rand() % 26);
+    if(kind == 1) return string(hosts[rand() % 3]);
+    string key = string(hosts[rand() % 3]) + dirs[rand() % 4];
+    key += "page-" + to_string(rand() % 300);
+    if(rand() % 4 == 0) key += "-with-a-suffix-longer-than-inline";
+    return key;
+}
+
+int main()
+{
+    StringMap<int> map;
+    std::map<string, int> expected;
+    srand(11);
+    bool randomOk = true;
+    for(int i = 0; i < 50000; ++i) {
+        string key = randomKey();
+        int op = rand() % 4;
+        if(op == 0) {
+            map.remove(key);
+            expected.erase(key);
+        }
+        else if(op == 1) {
+            int value = -1;
+            bool found = map.find(key.c_str(), value);
+            std::map<string, int>::iterator it = expected.find(key);
+            randomOk = randomOk && found == (it != expected.end()) && (!found || value == it->second);
+        }
+        else {
+            map.insert(key, i);
+            expected[key] = i;
+        }
+    }
+    vector<pair<string, int> > items;
+    Collect collect = { &items };
+    map.forEach(collect);
+    randomOk = randomOk && map.size() == expected.size() &&
+               items == vector<pair<string, int> >(expected.begin(), expected.end());
+
+    // iteration, and lower_bound for present and absent keys alike
+    bool iterateOk = true;
+    std::map<string, int>::iterator e = expected.begin();
+    for(StringMap<int>::iterator it = map.begin(); iterateOk && it != map.end(); ++it, ++e) {
+        iterateOk = e != expected.end() && it.key() == e->first && it.value() == e->second;
+    }
+    iterateOk = iterateOk && e == expected.end();
+    for(int i = 0; iterateOk && i < 5000; ++i) {
+        string key = randomKey();
+        if(rand() % 2 == 0) key.erase(key.size() - rand() % key.size() - 1);
+        StringMap<int>::iterator it = map.lower_bound(key);
+        std::map<string, int>::iterator bound = expected.lower_bound(key);
+        iterateOk = bound == expected.end() ? it == map.end() : it != map.end() && it.key() == bound->first;
+    }
+
+    // ordering across prefixes is plain string order
+    StringMap<int> small;
+    const char* keys[] = { "a/bd", "a/b/c", "a/", "a", "a/b/", "b", "a/b" };
+    for(int i = 0; i < 7; ++i) {
+        small.insert(keys[i], i);
+    }
+    vector<pair<string, int> > ordered;
+    Collect collectSmall = { &ordered };
+    small.forEach(collectSmall);
+    const char* sorted[] = { "a", "a/", "a/b", "a/b/", "a/b/c", "a/bd", "b" };
+    bool orderOk = ordered.size() == 7;
+    for(size_t i = 0; orderOk && i < 7; ++i) {
+        orderOk = ordered[i].first == sorted[i];
+    }
+    orderOk = orderOk && !small.contains("a/b/d") && !small.contains("c/d") && small.contains("a/b/");
+    orderOk = orderOk && small.lower_bound("a/b/d").key() == "a/bd" && small.lower_bound("c") == small.end();
+
+    small["a/b"] = 70;
+    bool missingThrew = false;
+    try {
+        small["a/b/d"] = 1;
+    }
+    catch(const std::out_of_range&) {
+        missingThrew = true;
+    }
+    bool indexOk = small["a/b"] == 70 && missingThrew && small.size() == 7;
+    small.clear();
+    orderOk = orderOk && small.empty() && small.size() == 0 && small.prefixes().size() == 1;
+
+    // a moved key takes the suffix block and leaves an empty key behind
+    string longSuffix = "a-suffix-well-past-the-inline-capacity";
+    CompactKey source(3, longSuffix.data(), longSuffix.size());
+    const char* block = source.suffix();
+    CompactKey moved(std::move(source));
+    CompactKey assigned;
+    assigned = std::move(moved);
+    bool moveOk = assigned.suffix() == block && assigned.prefixId() == 3 &&
+                  string(assigned.suffix(), assigned.suffixSize()) == longSuffix &&
+                  source.suffixSize() == 0 && moved.suffixSize() == 0 && moved.heapBytes() == 0;
+
+    // memory against a plain std::string-keyed tree holding the same keys
+    size_t stringTreeBytes = 0;
+    for(std::map<string, int>::iterator it = expected.begin(); it != expected.end(); ++it) {
+        stringTreeBytes += sizeof(AVLNode<string, int>);
+        if(it->first.size() > 15) stringTreeBytes += it->first.size() + 1;
+    }
+    bool memoryOk = map.memoryUsage() < stringTreeBytes && sizeof(CompactKey) < sizeof(string);
+    cout << "Memory for " << map.size() << " keys: " << map.memoryUsage() << " bytes vs "
+         << stringTreeBytes << " with std::string keys (" << map.prefixes().size() << " prefixes)" << endl;
+
+    check(randomOk, "Random StringMap");
+    check(iterateOk, "Iteration and lower_bound");
+    check(orderOk, "Prefix ordering");
+    check(indexOk, "operator[]");
+    check(moveOk, "CompactKey move");
+    check(memoryOk, "Memory");
+    return failures() == 0 ? 0 : 1;
+}
@@ -0,0 +1,788 @@
+#ifndef STRING_MAP_H
+#define STRING_MAP_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <algorithm>
+#include "bst.h"
+#include "avlbst.h"
+
+/**
+* Interned key prefixes, numbered from 0 (always the empty prefix). An
+* open-addressing table finds a prefix from a pointer and length without
+* building a std::string.
+*/
+class PrefixPool
+{
+public:
+    static const uint32_t NOT_FOUND = 0xffffffffu;
+
+    PrefixPool();
+
+    uint32_t intern(const char* data, size_t size);
+    uint32_t lookup(const char* data, size_t size) const;
+    const std::string& prefix(uint32_t id) const;
+    size_t size() const;
+    size_t memoryUsage() const;
+    void clear();
+
+private:
+    static uint64_t hash(const char* data, size_t size);
+    size_t slotOf(const char* data, size_t size) const;
+    void grow();
+
+    std::vector<std::string> prefixes_;
+    std::vector<uint32_t> slots_;   // id + 1, 0 for an empty slot
+};
+
+/**
+* A key as stored in a StringMap node: the id of its prefix and its
+* suffix, held inline up to INLINE_CAPACITY bytes and on the heap past
+* that.
+*/
+class CompactKey
+{
+public:
+    static const size_t INLINE_CAPACITY = 16;
+
+    CompactKey();
+    CompactKey(uint32_t prefixId, const char* suffix, size_t size);
+    CompactKey(const CompactKey& other);
+    CompactKey(CompactKey&& other) noexcept;
+    CompactKey& operator=(const CompactKey& other);
+    CompactKey& operator=(CompactKey&& other) noexcept;
+    ~CompactKey();
+
+    uint32_t prefixId() const;
+    const char* suffix() const;
+    size_t suffixSize() const;
+    size_t heapBytes() const;
+
+private:
+    void assign(uint32_t prefixId, const char* suffix, size_t size);
+    void take(CompactKey& other);
+    void release();
+
+    uint32_t prefix_;
+    uint32_t size_;
+    union
+    {
+        char inline_[INLINE_CAPACITY];
+        char* heap_;
+    };
+};
+
+// Only for printing trees: "#id:suffix".
+inline std::ostream& operator<<(std::ostream& out, const CompactKey& key);
+
+/**
+* A lookup key: the probe string split the same way as a stored key, with
+* its prefix id if the prefix is interned (PrefixPool::NOT_FOUND if not,
+* in which case no stored key shares it).
+*/
+struct StringMapProbe
+{
+    uint32_t prefixId;
+    const char* prefix;
+    size_t prefixSize;
+    const char* suffix;
+    size_t suffixSize;
+};
+
+/**
+* Three-way, transparent comparator over CompactKeys and probes. Equal
+* prefix ids compare the suffixes only; otherwise the prefix and suffix
+* of each side are walked as one string.
+*/
+class CompactKeyCompare
+{
+public:
+    typedef void is_transparent;
+
+    explicit CompactKeyCompare(const PrefixPool* pool = NULL) : pool_(pool) {}
+
+    int operator()(const CompactKey& a, const CompactKey& b) const;
+    int operator()(const StringMapProbe& a, const CompactKey& b) const;
+    int operator()(const CompactKey& a, const StringMapProbe& b) const { return -(*this)(b, a); }
+
+    // Lexicographic comparison of a1 a2 with b1 b2, like std::string's.
+    static int compareParts(const char* a1, size_t n1, const char* a2, size_t n2,
+                            const char* b1, size_t m1, const char* b2, size_t m2);
+
+private:
+    const PrefixPool* pool_;
+};
+
+/**
+* Counts live nodes through the allocation hooks, which gives
+* StringMap::size() without a search before each insert.
+*/
+struct LiveNodeStats : public NullTreeStats
+{
+    LiveNodeStats() : live(0) {}
+    void allocation() { ++live; }
+    void deallocation() { --live; }
+    void reset() {}
+
+    size_t live;
+};
+
+/**
+* An ordered map from strings to values for keys like URLs and paths,
+* which share long prefixes. Each key is split at its last separator
+* ('/' by default). The part up to and including the separator is
+* interned once in a PrefixPool, and the rest (the suffix) is stored in
+* the node, inline when it is short. So a node holds a 24-byte
+* CompactKey instead of a 32-byte std::string plus, for anything past 15
+* characters, a separate heap block.
+*
+* Keys under the same prefix compare by suffix alone, so the shared part
+* is never compared again. Other keys compare as the full strings would,
+* in the same order as std::string. Lookups take std::string or C
+* strings and build no key (see StringMapProbe).
+*
+* The map is built on AVLTree through its Compare and Stats parameters.
+* Interned prefixes stay until clear(), even after their last key is
+* removed.
+*/
+template <typename Value>
+class StringMap
+{
+public:
+    /**
+    * The AVL tree behind the map, which can also remove by probe.
+    */
+    class Tree : public AVLTree<CompactKey, Value, CompactKeyCompare, LiveNodeStats>
+    {
+    public:
+        explicit Tree(const CompactKeyCompare& comp) :
+            AVLTree<CompactKey, Value, CompactKeyCompare, LiveNodeStats>(comp) {}
+
+        void removeProbe(const StringMapProbe& probe)
+        {
+            Node<CompactKey, Value>* parent;
+            bool goRight;
+            Node<CompactKey, Value>* node = this->locate(probe, parent, goRight);
+            if(node != NULL) this->removeFound(static_cast<AVLNode<CompactKey, Value>*>(node));
+        }
+    };
+
+    /**
+    * Walks the items in key order. key() rebuilds the full string on each
+    * call; value() refers to the value in the node.
+    */
+    class iterator
+    {
+    public:
+        iterator();
+
+        std::string key() const;
+        Value& value() const;
+
+        bool operator==(const iterator& rhs) const;
+        bool operator!=(const iterator& rhs) const;
+
+        iterator& operator++();
+
+    private:
+        friend class StringMap<Value>;
+        iterator(const typename Tree::iterator& it, const PrefixPool* pool);
+
+        typename Tree::iterator it_;
+        const PrefixPool* pool_;
+    };
+
+    explicit StringMap(char separator = '/');
+
+    void insert(const std::string& key, const Value& value);
+    void remove(const std::string& key);
+    bool find(const std::string& key, Value& value) const;
+    bool find(const char* key, Value& value) const;
+    bool contains(const char* key) const;
+
+    iterator begin() const;
+    iterator end() const;
+    iterator lower_bound(const std::string& key) const;
+    iterator lower_bound(const char* key) const;
+
+    // Like BinarySearchTree's: throws std::out_of_range for a missing key.
+    Value& operator[](const std::string& key);
+    const Value& operator[](const std::string& key) const;
+    bool empty() const;
+    size_t size() const;
+    void clear();
+
+    // Calls f(key, value) for every item in key order. The key is rebuilt
+    // into one reused buffer, so copy it to keep it.
+    template <typename Func>
+    void forEach(Func f) const;
+
+    // Bytes held by nodes, out-of-line suffixes and the prefix pool.
+    size_t memoryUsage() const;
+    const PrefixPool& prefixes() const;
+
+private:
+    StringMap(const StringMap&);
+    StringMap& operator=(const StringMap&);
+
+    size_t splitPoint(const char* key, size_t size) const;
+    StringMapProbe probe(const char* key, size_t size) const;
+    bool findProbe(const StringMapProbe& probe, Value& value) const;
+    Value& valueAt(const std::string& key) const;
+
+    char separator_;
+    PrefixPool pool_;
+    Tree tree_;
+};
+
+/*
+  ----------------------------------------------
+  Begin implementations for the PrefixPool class.
+  ----------------------------------------------
+*/
+
+inline PrefixPool::PrefixPool()
+{
+    clear();
+}
+
+/**
+* Returns the id of the prefix, adding it if it is new.
+*/
+inline uint32_t PrefixPool::intern(const char* data, size_t size)
+{
+    size_t slot = slotOf(data, size);
+    if(slots_[slot] != 0) return slots_[slot] - 1;
+
+    if(prefixes_.size() >= NOT_FOUND - 1) throw std::length_error("PrefixPool is full");
+    uint32_t id = (uint32_t)prefixes_.size();
+    prefixes_.push_back(std::string(data, size));
+    slots_[slot] = id + 1;
+    // keep the table at most half full
+    if(prefixes_.size() * 2 > slots_.size()) grow();
+    return id;
+}
+
+/**
+* Returns the id of the prefix, or NOT_FOUND if it was never interned.
+*/
+inline uint32_t PrefixPool::lookup(const char* data, size_t size) const
+{
+    uint32_t entry = slots_[slotOf(data, size)];
+    return entry == 0 ? NOT_FOUND : entry - 1;
+}
+
+inline const std::string& PrefixPool::prefix(uint32_t id) const
+{
+    return prefixes_[id];
+}
+
+inline size_t PrefixPool::size() const
+{
+    return prefixes_.size();
+}
+
+inline size_t PrefixPool::memoryUsage() const
+{
+    size_t bytes = prefixes_.capacity() * sizeof(std::string) + slots_.capacity() * sizeof(uint32_t);
+    for(size_t i = 0; i < prefixes_.size(); ++i) {
+        // std::string keeps up to 15 characters in the object itself
+        if(prefixes_[i].capacity() > 15) bytes += prefixes_[i].capacity() + 1;
+    }
+    return bytes;
+}
+
+/**
+* Forgets every prefix except the empty one, which keeps id 0.
+*/
+inline void PrefixPool::clear()
+{
+    prefixes_.clear();
+    slots_.assign(16, 0);
+    intern("", 0);
+}
+
+/**
+* FNV-1a.
+*/
+inline uint64_t PrefixPool::hash(const char* data, size_t size)
+{
+    uint64_t h = 14695981039346656037ull;
+    for(size_t i = 0; i < size; ++i) {
+        h ^= (unsigned char)data[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+/**
+* The slot holding the prefix, or the empty slot where it would go
+* (linear probing; the table size is a power of two).
+*/
+inline size_t PrefixPool::slotOf(const char* data, size_t size) const
+{
+    size_t mask = slots_.size() - 1;
+    size_t slot = (size_t)hash(data, size) & mask;
+    while(slots_[slot] != 0) {
+        const std::string& candidate = prefixes_[slots_[slot] - 1];
+        if(candidate.size() == size && std::memcmp(candidate.data(), data, size) == 0) break;
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+inline void PrefixPool::grow()
+{
+    slots_.assign(slots_.size() * 2, 0);
+    for(size_t id = 0; id < prefixes_.size(); ++id) {
+        slots_[slotOf(prefixes_[id].data(), prefixes_[id].size())] = (uint32_t)id + 1;
+    }
+}
+
+/*
+  --------------------------------------------
+  End implementations for the PrefixPool class.
+  --------------------------------------------
+*/
+
+/*
+  ----------------------------------------------
+  Begin implementations for the CompactKey class.
+  ----------------------------------------------
+*/
+
+inline CompactKey::CompactKey() :
+    prefix_(0),
+    size_(0)
+{
+
+}
+
+inline CompactKey::CompactKey(uint32_t prefixId, const char* suffix, size_t size) :
+    prefix_(0),
+    size_(0)
+{
+    if(size > 0xffffffffu) throw std::length_error("CompactKey suffix too long");
+    assign(prefixId, suffix, size);
+}
+
+inline CompactKey::CompactKey(const CompactKey& other) :
+    prefix_(0),
+    size_(0)
+{
+    assign(other.prefix_, other.suffix(), other.size_);
+}
+
+/**
+* Takes over other's suffix block, leaving other empty.
+*/
+inline CompactKey::CompactKey(CompactKey&& other) noexcept
+{
+    take(other);
+}
+
+inline CompactKey& CompactKey::operator=(const CompactKey& other)
+{
+    if(this != &other) {
+        release();
+        assign(other.prefix_, other.suffix(), other.size_);
+    }
+    return *this;
+}
+
+inline CompactKey& CompactKey::operator=(CompactKey&& other) noexcept
+{
+    if(this != &other) {
+        release();
+        take(other);
+    }
+    return *this;
+}
+
+inline CompactKey::~CompactKey()
+{
+    release();
+}
+
+inline uint32_t CompactKey::prefixId() const
+{
+    return prefix_;
+}
+
+inline const char* CompactKey::suffix() const
+{
+    return size_ <= INLINE_CAPACITY ? inline_ : heap_;
+}
+
+inline size_t CompactKey::suffixSize() const
+{
+    return size_;
+}
+
+/**
+* Size of the out-of-line suffix block, 0 for inline suffixes.
+*/
+inline size_t CompactKey::heapBytes() const
+{
+    return size_ <= INLINE_CAPACITY ? 0 : size_;
+}
+
+inline void CompactKey::assign(uint32_t prefixId, const char* suffix, size_t size)
+{
+    prefix_ = prefixId;
+    size_ = (uint32_t)size;
+    char* target = inline_;
+    if(size > INLINE_CAPACITY) {
+        heap_ = new char[size];
+        target = heap_;
+    }
+    if(size != 0) std::memcpy(target, suffix, size);
+}
+
+inline void CompactKey::take(CompactKey& other)
+{
+    prefix_ = other.prefix_;
+    size_ = other.size_;
+    // the inline bytes or the heap pointer, whichever the union holds
+    std::memcpy(inline_, other.inline_, INLINE_CAPACITY);
+    other.size_ = 0;
+}
+
+inline void CompactKey::release()
+{
+    if(size_ > INLINE_CAPACITY) delete [] heap_;
+    size_ = 0;
+}
+
+inline std::ostream& operator<<(std::ostream& out, const CompactKey& key)
+{
+    out << '#' << key.prefixId() << ':';
+    return out.write(key.suffix(), key.suffixSize());
+}
+
+/*
+  --------------------------------------------
+  End implementations for the CompactKey class.
+  --------------------------------------------
+*/
+
+/*
+  -----------------------------------------------------
+  Begin implementations for the CompactKeyCompare class.
+  -----------------------------------------------------
+*/
+
+inline int CompactKeyCompare::operator()(const CompactKey& a, const CompactKey& b) const
+{
+    if(a.prefixId() == b.prefixId()) {
+        return compareParts(a.suffix(), a.suffixSize(), NULL, 0, b.suffix(), b.suffixSize(), NULL, 0);
+    }
+    const std::string& pa = pool_->prefix(a.prefixId());
+    const std::string& pb = pool_->prefix(b.prefixId());
+    return compareParts(pa.data(), pa.size(), a.suffix(), a.suffixSize(),
+                        pb.data(), pb.size(), b.suffix(), b.suffixSize());
+}
+
+inline int CompactKeyCompare::operator()(const StringMapProbe& a, const CompactKey& b) const
+{
+    if(a.prefixId == b.prefixId()) {
+        return compareParts(a.suffix, a.suffixSize, NULL, 0, b.suffix(), b.suffixSize(), NULL, 0);
+    }
+    const std::string& pb = pool_->prefix(b.prefixId());
+    return compareParts(a.prefix, a.prefixSize, a.suffix, a.suffixSize,
+                        pb.data(), pb.size(), b.suffix(), b.suffixSize());
+}
+
+/**
+* Walks both two-part strings in runs that are contiguous on both sides,
+* one memcmp per run. Returns -1, 0 or 1.
+*/
+inline int CompactKeyCompare::compareParts(const char* a1, size_t n1, const char* a2, size_t n2,
+                                           const char* b1, size_t m1, const char* b2, size_t m2)
+{
+    const char* a[2] = { a1, a2 };
+    size_t aSize[2] = { n1, n2 };
+    const char* b[2] = { b1, b2 };
+    size_t bSize[2] = { m1, m2 };
+    int ai = 0, bi = 0;
+    size_t ao = 0, bo = 0;
+
+    while(true) {
+        while(ai < 2 && ao == aSize[ai]) { ++ai; ao = 0; }
+        while(bi < 2 && bo == bSize[bi]) { ++bi; bo = 0; }
+        if(ai == 2 || bi == 2) return (ai == 2 ? 0 : 1) - (bi == 2 ? 0 : 1);
+
+        size_t run = std::min(aSize[ai] - ao, bSize[bi] - bo);
+        int order = std::memcmp(a[ai] + ao, b[bi] + bo, run);
+        if(order != 0) return order < 0 ? -1 : 1;
+        ao += run;
+        bo += run;
+    }
+}
+
+/*
+  ---------------------------------------------------
+  End implementations for the CompactKeyCompare class.
+  ---------------------------------------------------
+*/
+
+/*
+  ------------------------------------------------------
+  Begin implementations for the StringMap::iterator class.
+  ------------------------------------------------------
+*/
+
+template<typename Value>
+StringMap<Value>::iterator::iterator() :
+    pool_(NULL)
+{
+
+}
+
+template<typename Value>
+StringMap<Value>::iterator::iterator(const typename Tree::iterator& it, const PrefixPool* pool) :
+    it_(it),
+    pool_(pool)
+{
+
+}
+
+template<typename Value>
+std::string StringMap<Value>::iterator::key() const
+{
+    const CompactKey& compact = it_->first;
+    std::string key(pool_->prefix(compact.prefixId()));
+    key.append(compact.suffix(), compact.suffixSize());
+    return key;
+}
+
+template<typename Value>
+Value& StringMap<Value>::iterator::value() const
+{
+    return it_->second;
+}
+
+template<typename Value>
+bool StringMap<Value>::iterator::operator==(const iterator& rhs) const
+{
+    return it_ == rhs.it_;
+}
+
+template<typename Value>
+bool StringMap<Value>::iterator::operator!=(const iterator& rhs) const
+{
+    return it_ != rhs.it_;
+}
+
+template<typename Value>
+typename StringMap<Value>::iterator& StringMap<Value>::iterator::operator++()
+{
+    ++it_;
+    return *this;
+}
+
+/*
+  ----------------------------------------------------
+  End implementations for the StringMap::iterator class.
+  ----------------------------------------------------
+*/
+
+/*
+  ---------------------------------------------
+  Begin implementations for the StringMap class.
+  ---------------------------------------------
+*/
+
+template<typename Value>
+StringMap<Value>::StringMap(char separator) :
+    separator_(separator),
+    tree_(CompactKeyCompare(&pool_))
+{
+
+}
+
+/**
+* Inserts or overwrites. Interns the key's prefix if it is new. The key
+* is built once and moved into the item; only a new node copies it.
+*/
+template<typename Value>
+void StringMap<Value>::insert(const std::string& key, const Value& value)
+{
+    size_t split = splitPoint(key.data(), key.size());
+    uint32_t id = pool_.intern(key.data(), split);
+    tree_.insert(std::pair<const CompactKey, Value>(CompactKey(id, key.data() + split, key.size() - split), value));
+}
+
+/**
+* Searches by probe, so no key is built.
+*/
+template<typename Value>
+void StringMap<Value>::remove(const std::string& key)
+{
+    StringMapProbe p = probe(key.data(), key.size());
+    if(p.prefixId == PrefixPool::NOT_FOUND) return;
+    tree_.removeProbe(p);
+}
+
+template<typename Value>
+bool StringMap<Value>::find(const std::string& key, Value& value) const
+{
+    return findProbe(probe(key.data(), key.size()), value);
+}
+
+template<typename Value>
+bool StringMap<Value>::find(const char* key, Value& value) const
+{
+    return findProbe(probe(key, std::strlen(key)), value);
+}
+
+template<typename Value>
+bool StringMap<Value>::contains(const char* key) const
+{
+    Value ignored;
+    return find(key, ignored);
+}
+
+template<typename Value>
+typename StringMap<Value>::iterator StringMap<Value>::begin() const
+{
+    return iterator(tree_.begin(), &pool_);
+}
+
+template<typename Value>
+typename StringMap<Value>::iterator StringMap<Value>::end() const
+{
+    return iterator(tree_.end(), &pool_);
+}
+
+/**
+* The first item whose key is not less than key. The key need not be in
+* the map, nor its prefix interned: such a probe compares as the full
+* string.
+*/
+template<typename Value>
+typename StringMap<Value>::iterator StringMap<Value>::lower_bound(const std::string& key) const
+{
+    return iterator(tree_.lower_bound(probe(key.data(), key.size())), &pool_);
+}
+
+template<typename Value>
+typename StringMap<Value>::iterator StringMap<Value>::lower_bound(const char* key) const
+{
+    return iterator(tree_.lower_bound(probe(key, std::strlen(key))), &pool_);
+}
+
+template<typename Value>
+Value& StringMap<Value>::operator[](const std::string& key)
+{
+    return valueAt(key);
+}
+
+template<typename Value>
+const Value& StringMap<Value>::operator[](const std::string& key) const
+{
+    return valueAt(key);
+}
+
+template<typename Value>
+bool StringMap<Value>::empty() const
+{
+    return tree_.empty();
+}
+
+template<typename Value>
+size_t StringMap<Value>::size() const
+{
+    return tree_.stats().live;
+}
+
+template<typename Value>
+void StringMap<Value>::clear()
+{
+    tree_.clear();
+    pool_.clear();
+}
+
+template<typename Value>
+template<typename Func>
+void StringMap<Value>::forEach(Func f) const
+{
+    std::string key;
+    for(typename Tree::iterator it = tree_.begin(); it != tree_.end(); ++it) {
+        const CompactKey& compact = it->first;
+        key.assign(pool_.prefix(compact.prefixId()));
+        key.append(compact.suffix(), compact.suffixSize());
+        f(key, it->second);
+    }
+}
+
+template<typename Value>
+size_t StringMap<Value>::memoryUsage() const
+{
+    size_t bytes = size() * sizeof(AVLNode<CompactKey, Value>) + pool_.memoryUsage();
+    for(typename Tree::iterator it = tree_.begin(); it != tree_.end(); ++it) {
+        bytes += it->first.heapBytes();
+    }
+    return bytes;
+}
+
+template<typename Value>
+const PrefixPool& StringMap<Value>::prefixes() const
+{
+    return pool_;
+}
+
+/**
+* Length of the prefix: up to and including the last separator, 0 if
+* there is none.
+*/
+template<typename Value>
+size_t StringMap<Value>::splitPoint(const char* key, size_t size) const
+{
+    for(size_t i = size; i > 0; --i) {
+        if(key[i - 1] == separator_) return i;
+    }
+    return 0;
+}
+
+template<typename Value>
+StringMapProbe StringMap<Value>::probe(const char* key, size_t size) const
+{
+    size_t split = splitPoint(key, size);
+    StringMapProbe p = { pool_.lookup(key, split), key, split, key + split, size - split };
+    return p;
+}
+
+template<typename Value>
+bool StringMap<Value>::findProbe(const StringMapProbe& probe, Value& value) const
+{
+    // a prefix that was never interned belongs to no key
+    if(probe.prefixId == PrefixPool::NOT_FOUND) return false;
+    typename Tree::iterator it = tree_.find(probe);
+    if(it == tree_.end()) return false;
+    value = it->second;
+    return true;
+}
+
+template<typename Value>
+Value& StringMap<Value>::valueAt(const std::string& key) const
+{
+    StringMapProbe p = probe(key.data(), key.size());
+    typename Tree::iterator it = p.prefixId == PrefixPool::NOT_FOUND ? tree_.end() : tree_.find(p);
+    if(it == tree_.end()) throw std::out_of_range("Invalid key");
+    return it->second;
+}
+
+/*
+  -------------------------------------------
+  End implementations for the StringMap class.
+  -------------------------------------------
+*/
+
+#endif
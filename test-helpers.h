@@ -0,0 +1,96 @@
+#ifndef TEST_HELPERS_H
+#define TEST_HELPERS_H
+
+#include <iostream>
+#include <map>
+#include <cstdlib>
+#include <utility>
+
+/**
+* Helpers shared by the test drivers: pass/fail reporting and a
+* randomized comparison of a tree against std::map.
+*/
+
+/**
+ * Number of failed checks so far; a driver returns nonzero if any.
+ */
+inline int& failures()
+{
+    static int count = 0;
+    return count;
+}
+
+/**
+ * Prints "msg: passed" or "msg: FAILED" and counts the failure.
+ */
+inline void check(bool cond, const char* msg)
+{
+    std::cout << msg << ": " << (cond ? "passed" : "FAILED") << std::endl;
+    if(!cond) ++failures();
+}
+
+/**
+ * Relative weights of the operations matchesMap draws: remove, insert,
+ * overwrite of a present key through operator[], and find. A weight of
+ * zero leaves that operation out.
+ */
+struct OpMix
+{
+    int removes;
+    int inserts;
+    int updates;
+    int finds;
+
+    OpMix(int r, int i, int u, int f) : removes(r), inserts(i), updates(u), finds(f) {}
+};
+
+/**
+ * Runs ops random operations on keys in [0, keyRange) against both tree
+ * and std::map, checking every find as it goes, then checks that both
+ * hold the same items in the same order and that each one is found.
+ * The same seed always produces the same operations.
+ */
+template<typename Tree>
+bool matchesMap(Tree& tree, unsigned seed, int ops, int keyRange, const OpMix& mix)
+{
+    std::map<int, int> expected;
+    srand(seed);
+    int total = mix.removes + mix.inserts + mix.updates + mix.finds;
+    bool ok = true;
+    for(int i = 0; i < ops && ok; ++i) {
+        int key = rand() % keyRange;
+        int op = rand() % total;
+        if(op < mix.removes) {
+            tree.remove(key);
+            expected.erase(key);
+        }
+        else if(op < mix.removes + mix.inserts) {
+            tree.insert(std::make_pair(key, i));
+            expected[key] = i;
+        }
+        else if(op < mix.removes + mix.inserts + mix.updates) {
+            if(expected.count(key) != 0) {
+                tree[key] = -i;
+                expected[key] = -i;
+            }
+        }
+        else {
+            typename Tree::iterator it = tree.find(key);
+            std::map<int, int>::iterator e = expected.find(key);
+            ok = (it == tree.end()) == (e == expected.end()) && (e == expected.end() || it->second == e->second);
+        }
+    }
+    if(!ok) return false;
+    std::map<int, int>::iterator e = expected.begin();
+    for(typename Tree::iterator it = tree.begin(); it != tree.end(); ++it, ++e) {
+        if(e == expected.end() || it->first != e->first || it->second != e->second) return false;
+    }
+    ok = e == expected.end();
+    for(e = expected.begin(); e != expected.end() && ok; ++e) {
+        typename Tree::iterator it = tree.find(e->first);
+        ok = it != tree.end() && it->second == e->second;
+    }
+    return ok;
+}
+
+#endif
@@ -0,0 +1,133 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <climits>
+#include <cstdlib>
+#include <unistd.h>
+#include "bst.h"
+#include "avlbst.h"
+#include "tree-trace.h"
+#include "test-helpers.h"
+
+using namespace std;
+
+int main()
+{
+    string intPath = "trace-test-int.trace";
+    string stringPath = "trace-test-string.trace";
+
+    // Record a mix of operations, including keys far apart
+    vector<pair<int, int> > expected;
+    {
+        TraceRecordingTree<AVLTree<int, int> > tree(intPath);
+        srand(3);
+        for(int i = 0; i < 100000; ++i) {
+            int op = rand() % 3;
+            int key = (i % 1000 == 0) ? ((i % 2000) ? INT_MIN : INT_MAX) : rand() % 2000 - 1000;
+            expected.push_back(make_pair(op, key));
+            if(op == TRACE_INSERT) tree.insert(make_pair(key, i));
+            else if(op == TRACE_REMOVE) tree.remove(key);
+            else tree.find(key);
+        }
+    }
+    bool intOk = true;
+    {
+        TraceReader<int> reader(intPath);
+        int op, key;
+        size_t n = 0;
+        while(reader.next(op, key)) {
+            intOk = intOk && n < expected.size() && expected[n].first == op && expected[n].second == key;
+            ++n;
+        }
+        intOk = intOk && n == expected.size() && TraceReader<int>::keyKind(intPath) == TRACE_INTEGER_KEYS;
+    }
+    check(intOk, "Integer key round trip");
+
+    // Sequential keys need a single byte per operation
+    bool compactOk;
+    {
+        {
+            TraceRecordingTree<BinarySearchTree<long, int> > tree(intPath);
+            for(long i = 0; i < 10000; ++i) tree.find(i);
+        }
+        FILE* f = fopen(intPath.c_str(), "rb");
+        fseek(f, 0, SEEK_END);
+        long size = ftell(f);
+        fclose(f);
+        compactOk = size == 10 + 10000;
+    }
+    check(compactOk, "Compact sequential keys");
+
+    bool stringOk = true;
+    {
+        TraceRecordingTree<AVLTree<string, int> > tree(stringPath);
+        tree.insert(make_pair(string("apple"), 1));
+        tree.insert(make_pair(string(""), 2));
+        const TraceRecordingTree<AVLTree<string, int> >& constTree = tree;
+        constTree.find("apple");
+        tree.remove("apple");
+        stringOk = tree.trace().records() == 4;
+    }
+    {
+        TraceReader<string> reader(stringPath);
+        int op;
+        string key;
+        const char* keys[] = { "apple", "", "apple", "apple" };
+        int ops[] = { TRACE_INSERT, TRACE_INSERT, TRACE_FIND, TRACE_REMOVE };
+        for(int i = 0; i < 4; ++i) {
+            stringOk = stringOk && reader.next(op, key) && op == ops[i] && key == keys[i];
+        }
+        stringOk = stringOk && !reader.next(op, key);
+        bool threw = false;
+        try {
+            TraceReader<int> wrongType(stringPath);
+        }
+        catch(const std::runtime_error&) {
+            threw = true;
+        }
+        stringOk = stringOk && threw && TraceReader<int>::keyKind(stringPath) == TRACE_STRING_KEYS;
+        // keyKind reads only the header, and a short one is not a trace
+        FILE* f = fopen(stringPath.c_str(), "wb");
+        fwrite("BSTTR", 1, 5, f);
+        fclose(f);
+        threw = false;
+        try {
+            TraceReader<string>::keyKind(stringPath);
+        }
+        catch(const std::runtime_error&) {
+            threw = true;
+        }
+        stringOk = stringOk && threw;
+    }
+    check(stringOk, "String key round trip");
+
+    // close() reports what the destructor has to swallow
+    bool closeOk = false;
+    try {
+        TraceWriter<int> full("/dev/full");
+        full.record(TRACE_FIND, 1);
+        full.close();
+    }
+    catch(const std::runtime_error&) {
+        closeOk = true;
+    }
+    {
+        TraceWriter<int> full("/dev/full");
+        full.record(TRACE_FIND, 1);
+    }
+    TraceWriter<int> closed(intPath);
+    closed.close();
+    closed.close();
+    try {
+        closed.record(TRACE_FIND, 1);
+        closeOk = false;
+    }
+    catch(const std::logic_error&) {
+    }
+    check(closeOk, "Close reports write errors");
+
+    unlink(intPath.c_str());
+    unlink(stringPath.c_str());
+    return failures() == 0 ? 0 : 1;
+}
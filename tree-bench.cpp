@@ -0,0 +1,143 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <chrono>
+#include <algorithm>
+#include "bst.h"
+#include "avlbst.h"
+#include "rbbst.h"
+#include "splay.h"
+#include "scapegoat.h"
+#include "string-map.h"
+#include "bench-workloads.h"
+
+using namespace std;
+
+/**
+ * Semi-splaying variant, so it can be named as a template argument.
+ */
+class SemiSplayTree : public SplayTree<int, int>
+{
+public:
+    SemiSplayTree() : SplayTree<int, int>(SEMI) {}
+};
+
+/**
+ * Builds count URL-like keys under 300 shared directory prefixes, in
+ * random order.
+ */
+vector<string> makeUrlKeys(size_t count, unsigned seed)
+{
+    srand(seed);
+    vector<string> keys;
+    for(size_t i = 0; i < count; ++i) {
+        keys.push_back("https://example.com/static/assets/" + to_string(rand() % 300) + "/item-" + to_string(i));
+    }
+    random_shuffle(keys.begin(), keys.end());
+    return keys;
+}
+
+/**
+ * StringMap and std::string-keyed trees behind the same three calls.
+ */
+struct StringMapOps
+{
+    StringMap<int> map;
+    void insert(const string& key, int value) { map.insert(key, value); }
+    bool contains(const string& key) const { int value; return map.find(key, value); }
+    void remove(const string& key) { map.remove(key); }
+};
+
+template<typename Tree>
+struct StringTreeOps
+{
+    Tree tree;
+    void insert(const string& key, int value) { tree.insert(make_pair(key, value)); }
+    bool contains(const string& key) const { return tree.find(key) != tree.end(); }
+    void remove(const string& key) { tree.remove(key); }
+};
+
+/**
+ * Times inserting every key, finding each one in another order, then
+ * removing them all; fills ns[] with ns/op for the three phases.
+ */
+template<typename Ops>
+void timeStringKeys(const vector<string>& keys, const vector<string>& lookups, double ns[3])
+{
+    Ops ops;
+    size_t found = 0;
+    chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+    for(size_t i = 0; i < keys.size(); ++i) ops.insert(keys[i], (int)i);
+    chrono::steady_clock::time_point t1 = chrono::steady_clock::now();
+    for(size_t i = 0; i < lookups.size(); ++i) found += ops.contains(lookups[i]);
+    chrono::steady_clock::time_point t2 = chrono::steady_clock::now();
+    for(size_t i = 0; i < keys.size(); ++i) ops.remove(lookups[i]);
+    chrono::steady_clock::time_point t3 = chrono::steady_clock::now();
+
+    // keep the lookups from being optimized away
+    if(found != keys.size()) abort();
+    ns[0] = chrono::duration<double, nano>(t1 - t0).count() / keys.size();
+    ns[1] = chrono::duration<double, nano>(t2 - t1).count() / keys.size();
+    ns[2] = chrono::duration<double, nano>(t3 - t2).count() / keys.size();
+}
+
+int main(int argc, char *argv[])
+{
+    int keySpace = (argc > 1) ? atoi(argv[1]) : 1000000;
+    size_t numOps = (argc > 2) ? (size_t)atol(argv[2]) : 1000000;
+
+    struct Mix { const char* name; int insertPct; int removePct; };
+    Mix mixes[] = {
+        { "insert-heavy", 80, 10 },
+        { "delete-heavy", 10, 80 },
+        { "lookup-heavy", 5, 5 },
+    };
+
+    cout << "keys " << keySpace << ", ops " << numOps << " (ns/op)" << endl;
+    cout << left << setw(14) << "workload" << right << setw(12) << "AVLTree" << setw(12) << "RBTree"
+         << setw(12) << "Scapegoat" << endl;
+    for(size_t m = 0; m < sizeof(mixes) / sizeof(mixes[0]); ++m) {
+        vector<Op> ops = makeMix(numOps, keySpace, mixes[m].insertPct, mixes[m].removePct, 42 + m);
+        double avl = runMix<AVLTree<int, int> >(ops, keySpace);
+        double rb = runMix<RBTree<int, int> >(ops, keySpace);
+        double scapegoat = runMix<ScapegoatTree<int, int> >(ops, keySpace);
+        cout << left << setw(14) << mixes[m].name << right << fixed << setprecision(1)
+             << setw(12) << avl << setw(12) << rb << setw(12) << scapegoat << endl;
+    }
+
+    // Skewed lookups: a small set of keys receives most of the traffic
+    cout << endl << "Zipf lookups (ns/op)" << endl;
+    cout << left << setw(14) << "exponent" << right << setw(12) << "AVLTree" << setw(12) << "SplayTree"
+         << setw(12) << "semi-splay" << setw(12) << "std::map" << endl;
+    double exponents[] = { 0.9, 1.1, 1.3 };
+    for(size_t e = 0; e < sizeof(exponents) / sizeof(exponents[0]); ++e) {
+        vector<Op> ops = makeZipfLookups(numOps, keySpace, exponents[e], 99);
+        double avl = runMix<AVLTree<int, int> >(ops, keySpace);
+        double splay = runMix<SplayTree<int, int> >(ops, keySpace);
+        double semi = runMix<SemiSplayTree>(ops, keySpace);
+        double stdmap = runMix<StdMap>(ops, keySpace);
+        cout << left << setw(14) << fixed << setprecision(1) << exponents[e] << right
+             << setw(12) << avl << setw(12) << splay << setw(12) << semi << setw(12) << stdmap << endl;
+    }
+
+    // String keys sharing long prefixes: StringMap compares suffixes only
+    size_t urlCount = keySpace / 4;
+    vector<string> keys = makeUrlKeys(urlCount, 5);
+    vector<string> lookups = keys;
+    random_shuffle(lookups.begin(), lookups.end());
+    double compact[3], bst[3], avl[3];
+    timeStringKeys<StringMapOps>(keys, lookups, compact);
+    timeStringKeys<StringTreeOps<BinarySearchTree<string, int> > >(keys, lookups, bst);
+    timeStringKeys<StringTreeOps<AVLTree<string, int> > >(keys, lookups, avl);
+    const char* phases[] = { "insert", "find", "remove" };
+    cout << endl << "URL keys, " << urlCount << " (ns/op)" << endl;
+    cout << left << setw(14) << "operation" << right << setw(12) << "StringMap" << setw(12) << "BST<string>"
+         << setw(12) << "AVL<string>" << endl;
+    for(int p = 0; p < 3; ++p) {
+        cout << left << setw(14) << phases[p] << right << fixed << setprecision(1)
+             << setw(12) << compact[p] << setw(12) << bst[p] << setw(12) << avl[p] << endl;
+    }
+    return 0;
+}
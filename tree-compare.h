@@ -0,0 +1,119 @@
+#ifndef TREE_COMPARE_H
+#define TREE_COMPARE_H
+
+#include <string>
+#include <cstring>
+#include <utility>
+#include <type_traits>
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+
+/**
+* Comparator support for BinarySearchTree's Compare parameter.
+*
+* A comparator is either a strict weak ordering like std::less (returns
+* bool: a < b), or three-way (returns a signed integer: negative, zero or
+* positive as a is less than, equal to or greater than b, like strcmp).
+* Which kind is detected from the return type. Either way the trees make
+* one comparator call per node on a search path; with a two-way comparator
+* they descend like lower_bound and check for equality once at the end.
+*
+* A comparator that declares an is_transparent member type can compare
+* keys against other types, which enables the heterogeneous find() and
+* lower_bound() overloads (e.g. std::string keys looked up by const char*
+* without building a temporary string).
+*/
+
+template <typename Compare, typename A, typename B>
+struct CompareResult
+{
+    typedef typename std::decay<decltype(std::declval<const Compare&>()(std::declval<const A&>(),
+                                                                         std::declval<const B&>()))>::type type;
+};
+
+template <typename Compare, typename Key>
+struct IsThreeWayCompare
+{
+    static const bool value = !std::is_same<typename CompareResult<Compare, Key, Key>::type, bool>::value;
+};
+
+template <typename Compare, typename = void>
+struct IsTransparentCompare : std::false_type {};
+
+template <typename Compare>
+struct IsTransparentCompare<Compare, typename std::conditional<true, void, typename Compare::is_transparent>::type>
+    : std::true_type {};
+
+/**
+* The two operations the trees need from either kind of comparator:
+* less(a, b) and order(a, b) (negative, zero or positive). order() costs one
+* call for a three-way comparator and up to two for a two-way one, so the
+* two-way search paths are written in terms of less() only.
+*/
+template <typename Compare, typename Key, bool ThreeWay = IsThreeWayCompare<Compare, Key>::value>
+struct CompareOps
+{
+    template <typename A, typename B>
+    static bool less(const Compare& comp, const A& a, const B& b)
+    {
+        return comp(a, b);
+    }
+
+    template <typename A, typename B>
+    static int order(const Compare& comp, const A& a, const B& b)
+    {
+        return comp(a, b) ? -1 : (comp(b, a) ? 1 : 0);
+    }
+};
+
+template <typename Compare, typename Key>
+struct CompareOps<Compare, Key, true>
+{
+    template <typename A, typename B>
+    static bool less(const Compare& comp, const A& a, const B& b)
+    {
+        return comp(a, b) < 0;
+    }
+
+    template <typename A, typename B>
+    static int order(const Compare& comp, const A& a, const B& b)
+    {
+        return comp(a, b);
+    }
+};
+
+/**
+* operator< on whatever it is given, so std::string keys can be compared
+* with const char* directly (C++11 has no std::less<void>).
+*/
+struct TransparentLess
+{
+    typedef void is_transparent;
+
+    template <typename A, typename B>
+    bool operator()(const A& a, const B& b) const
+    {
+        return a < b;
+    }
+};
+
+/**
+* Three-way comparison of strings (one pass over the common prefix per
+* node, instead of up to two for a < b then b < a), transparent for C
+* strings and, from C++17, string_view.
+*/
+struct StringThreeWayCompare
+{
+    typedef void is_transparent;
+
+    int operator()(const std::string& a, const std::string& b) const { return a.compare(b); }
+    int operator()(const std::string& a, const char* b) const { return a.compare(b); }
+    int operator()(const char* a, const std::string& b) const { return -b.compare(a); }
+#if __cplusplus >= 201703L
+    int operator()(const std::string& a, std::string_view b) const { return a.compare(b); }
+    int operator()(std::string_view a, const std::string& b) const { return -b.compare(a); }
+#endif
+};
+
+#endif
@@ -0,0 +1,94 @@
+#include <iostream>
+#include <map>
+#include <cstdlib>
+#include "bst.h"
+#include "avlbst.h"
+#include "rbbst.h"
+#include "tree-filter.h"
+#include "test-helpers.h"
+
+using namespace std;
+
+template<typename Tree>
+size_t countItems(const Tree& tree)
+{
+    size_t count = 0;
+    for(typename Tree::iterator it = tree.begin(); it != tree.end(); ++it) ++count;
+    return count;
+}
+
+int main()
+{
+    FilteredTree<AVLTree<int, int> > avl(64, 0.01);
+    FilteredTree<RBTree<int, int> > rb(64, 0.01);
+    // the filters start far too small, so they are rebuilt several times
+    OpMix mix(1, 1, 0, 2);
+    bool randomOk = matchesMap(avl, 1, 100000, 20000, mix) && matchesMap(rb, 2, 100000, 20000, mix) &&
+                    avl.size() == countItems(avl) && rb.size() == countItems(rb);
+    avl.waitForRebuild();
+    bool rebuildOk = avl.rebuilds() >= 3 && avl.filter().capacity() >= avl.size();
+
+    // churn at a steady size compacts the log into a same-size filter;
+    // each round waits so the count does not depend on the scheduler
+    FilteredTree<AVLTree<int, int> > churn(1000, 0.01);
+    for(int i = 0; i < 500; ++i) churn.insert(make_pair(i, i));
+    for(int round = 0; round < 20; ++round) {
+        for(int i = 0; i < 500; ++i) churn.remove(round * 500 + i);
+        for(int i = 0; i < 500; ++i) churn.insert(make_pair((round + 1) * 500 + i, i));
+        churn.waitForRebuild();
+    }
+    churn.waitForRebuild();
+    rebuildOk = rebuildOk && churn.rebuilds() >= 5 && churn.filter().capacity() == 1000 && churn.size() == 500;
+    for(int i = 0; i < 500 && rebuildOk; ++i) rebuildOk = churn.mayContain(10000 + i);
+    for(int i = 0; i < 10000 && rebuildOk; i += 7) rebuildOk = churn.find(i) == churn.end();
+
+    // False positives on keys that were never inserted, once the filter
+    // has caught up with the tree
+    FilteredTree<AVLTree<int, int> > sized(64, 0.01);
+    for(int i = 0; i < 50000; ++i) {
+        sized.insert(make_pair(i * 2, i));
+    }
+    sized.waitForRebuild();
+    size_t falsePositives = 0;
+    const int probes = 100000;
+    for(int i = 0; i < probes; ++i) {
+        if(sized.mayContain(2 * (i + 100000) + 1)) ++falsePositives;
+    }
+    double rate = (double)falsePositives / probes;
+    bool rateOk = rate < 3 * 0.01 && sized.filteredMisses() == 0;
+    for(int i = 0; i < 1000; ++i) {
+        sized.find(2 * i + 1);
+    }
+    rateOk = rateOk && sized.filteredMisses() > 900;
+
+    // removing everything empties the counters again
+    for(int i = 0; i < 50000; ++i) {
+        sized.remove(i * 2);
+    }
+    bool removeOk = sized.empty() && sized.size() == 0 && !sized.mayContain(2) && !sized.mayContain(99998);
+    sized.insert(make_pair(4, 4));
+    sized.clear();
+    removeOk = removeOk && !sized.mayContain(4) && sized.find(4) == sized.end();
+
+    // copyFrom refills the filter, growing it for the copied keys
+    FilteredTree<AVLTree<int, int> > source(64, 0.01);
+    for(int i = 0; i < 1000; ++i) {
+        source.insert(make_pair(i, i));
+    }
+    FilteredTree<AVLTree<int, int> > copy(16, 0.01);
+    copy.insert(make_pair(-5, 0));
+    copy.copyFrom(source);
+    bool copyOk = copy.size() == 1000 && copy.filter().capacity() >= 1000 && copy.find(999)->second == 999 &&
+                  copy.find(-5) == copy.end() && !copy.mayContain(-5);
+    copy.swap(sized);
+    copyOk = copyOk && copy.empty() && sized.size() == 1000 && sized.find(10) != sized.end();
+
+    cout << "False positive rate: " << rate << " (target 0.01, " << sized.filter().hashes() << " hashes, "
+         << sized.filter().memoryUsage() << " bytes)" << endl;
+    check(randomOk, "Random filtered trees");
+    check(rebuildOk, "Background rebuild");
+    check(rateOk, "False positives");
+    check(removeOk, "Removal");
+    check(copyOk, "Copies");
+    return failures() == 0 ? 0 : 1;
+}
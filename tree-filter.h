@@ -0,0 +1,482 @@
+#ifndef TREE_FILTER_H
+#define TREE_FILTER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <vector>
+#include <utility>
+#include <functional>
+#include <iterator>
+#include <algorithm>
+#include <stdexcept>
+
+/**
+* A counting, blocked Bloom filter. Every key hashes to one 64-byte block
+* (a cache line) of 128 four-bit counters and to k counters inside it, so
+* a lookup touches a single line. Counters make removal possible; one that
+* reaches 15 sticks there, which can only cost false positives, never
+* false negatives.
+*
+* Sized for a number of keys and a target false positive rate, which it
+* holds up to capacity() keys (blocking makes it a little worse than a
+* plain Bloom filter of the same size). Takes 64-bit hashes; see
+* FilteredTree for how keys are hashed.
+*/
+class CountingBloomFilter
+{
+public:
+    static const size_t BLOCK_WORDS = 8;        // 64 bytes
+    static const size_t BLOCK_COUNTERS = 128;   // 4 bits each
+
+    CountingBloomFilter(size_t capacity, double falsePositiveRate);
+
+    void add(uint64_t hash);
+    void remove(uint64_t hash);
+    bool mayContain(uint64_t hash) const;
+    void clear();
+
+    size_t capacity() const;
+    double falsePositiveRate() const;
+    int hashes() const;
+    size_t memoryUsage() const;
+
+private:
+    uint64_t* blockOf(uint64_t hash) const;
+
+    size_t capacity_;
+    double falsePositiveRate_;
+    int hashes_;
+    size_t blocks_;
+    std::vector<uint64_t> storage_;   // blocks_ blocks plus slack for alignment
+    uint64_t* words_;                 // first 64-byte aligned word in storage_
+};
+
+/**
+* Tree with a CountingBloomFilter in front of it. A find() for a key the
+* filter has never seen returns end() after one cache line instead of a
+* root-to-leaf descent, and inserts of new keys skip the existence check
+* that keeps the counters exact. The filter is updated on insert, remove
+* and clear.
+*
+* When the tree grows past the filter's capacity, a filter twice as large
+* is filled on a background thread; updates made meanwhile are queued and
+* replayed into it before it replaces the old one, which keeps answering
+* correctly, only with more false positives. The tree is never walked for
+* this: every hash added and removed is logged (8 bytes each), and the
+* builder reduces the log to the live hashes and fills the new filter from
+* those. A log that outgrows the filter through churn alone is compacted
+* the same way, into a filter of the same size. Like the trees themselves,
+* the wrapper is for one thread at a time.
+*/
+template <typename Tree>
+class FilteredTree : public Tree
+{
+public:
+    typedef typename Tree::key_type Key;
+    typedef typename Tree::mapped_type Value;
+
+    explicit FilteredTree(size_t expectedKeys = 1024, double falsePositiveRate = 0.01);
+    virtual ~FilteredTree();
+
+    virtual void insert(const std::pair<const Key, Value>& keyValuePair);
+    virtual void remove(const Key& key);
+    virtual void clear();
+    void swap(FilteredTree& other) noexcept;
+    typename Tree::iterator find(const Key& key) const;
+
+    bool mayContain(const Key& key) const;
+    size_t size() const;
+    const CountingBloomFilter& filter() const;
+    size_t filteredMisses() const;
+    size_t rebuilds() const;
+    // Blocks until a background rebuild, if any, has been swapped in.
+    void waitForRebuild();
+
+protected:
+    virtual void cloneContents(const typename Tree::tree_type& other, unsigned threads);
+
+private:
+    FilteredTree(const FilteredTree&);
+    FilteredTree& operator=(const FilteredTree&);
+
+    static uint64_t hashKey(const Key& key);
+    void record(uint64_t hash, bool added);
+    void startRebuild();
+    void finishRebuild(bool wait);
+
+    double falsePositiveRate_;
+    std::unique_ptr<CountingBloomFilter> filter_;
+    size_t size_;
+    mutable size_t filteredMisses_;
+    size_t rebuilds_;
+
+    // hashes added and removed since the last rebuild (or, while one
+    // runs, since it started); live keys are added minus removed
+    std::vector<uint64_t> added_;
+    std::vector<uint64_t> removed_;
+
+    // background rebuild
+    std::thread builder_;
+    std::atomic<bool> built_;
+    std::unique_ptr<CountingBloomFilter> next_;
+    std::vector<uint64_t> snapshot_;          // the log it started from, then the live hashes
+    std::vector<uint64_t> snapshotRemoved_;
+};
+
+/*
+  -------------------------------------------------------
+  Begin implementations for the CountingBloomFilter class.
+  -------------------------------------------------------
+*/
+
+/**
+* k = ln 2 * counters per key, with counters per key = log2(1/p) / ln 2
+* as for a plain Bloom filter.
+*/
+inline CountingBloomFilter::CountingBloomFilter(size_t capacity, double falsePositiveRate) :
+    capacity_(capacity == 0 ? 1 : capacity),
+    falsePositiveRate_(falsePositiveRate)
+{
+    if(!(falsePositiveRate > 0.0 && falsePositiveRate < 1.0)) {
+        throw std::invalid_argument("CountingBloomFilter false positive rate must be in (0, 1)");
+    }
+    double countersPerKey = std::log2(1.0 / falsePositiveRate) / std::log(2.0);
+    hashes_ = std::max(1, std::min(16, (int)std::lround(countersPerKey * std::log(2.0))));
+    blocks_ = (size_t)std::ceil(capacity_ * countersPerKey / BLOCK_COUNTERS);
+    if(blocks_ == 0) blocks_ = 1;
+    storage_.assign(blocks_ * BLOCK_WORDS + BLOCK_WORDS, 0);
+    uintptr_t address = (uintptr_t)storage_.data();
+    words_ = storage_.data() + ((64 - address % 64) % 64) / sizeof(uint64_t);
+}
+
+/**
+* The block comes from the high half of the hash (scaled, not taken
+* modulo); the k counters inside it from the low half by double hashing
+* with an odd step, so they are all different.
+*/
+inline uint64_t* CountingBloomFilter::blockOf(uint64_t hash) const
+{
+    uint64_t block = ((hash >> 32) * (uint64_t)blocks_) >> 32;
+    return words_ + block * BLOCK_WORDS;
+}
+
+inline void CountingBloomFilter::add(uint64_t hash)
+{
+    uint64_t* block = blockOf(hash);
+    unsigned position = (unsigned)hash;
+    unsigned step = (unsigned)(hash >> 7) | 1;
+    for(int i = 0; i < hashes_; ++i, position += step) {
+        unsigned counter = position % BLOCK_COUNTERS;
+        uint64_t& word = block[counter / 16];
+        unsigned shift = (counter % 16) * 4;
+        if(((word >> shift) & 0xf) != 0xf) word += (uint64_t)1 << shift;
+    }
+}
+
+inline void CountingBloomFilter::remove(uint64_t hash)
+{
+    uint64_t* block = blockOf(hash);
+    unsigned position = (unsigned)hash;
+    unsigned step = (unsigned)(hash >> 7) | 1;
+    for(int i = 0; i < hashes_; ++i, position += step) {
+        unsigned counter = position % BLOCK_COUNTERS;
+        uint64_t& word = block[counter / 16];
+        unsigned shift = (counter % 16) * 4;
+        uint64_t value = (word >> shift) & 0xf;
+        if(value != 0 && value != 0xf) word -= (uint64_t)1 << shift;
+    }
+}
+
+inline bool CountingBloomFilter::mayContain(uint64_t hash) const
+{
+    const uint64_t* block = blockOf(hash);
+    unsigned position = (unsigned)hash;
+    unsigned step = (unsigned)(hash >> 7) | 1;
+    for(int i = 0; i < hashes_; ++i, position += step) {
+        unsigned counter = position % BLOCK_COUNTERS;
+        if(((block[counter / 16] >> ((counter % 16) * 4)) & 0xf) == 0) return false;
+    }
+    return true;
+}
+
+inline void CountingBloomFilter::clear()
+{
+    std::fill(storage_.begin(), storage_.end(), 0);
+}
+
+inline size_t CountingBloomFilter::capacity() const
+{
+    return capacity_;
+}
+
+inline double CountingBloomFilter::falsePositiveRate() const
+{
+    return falsePositiveRate_;
+}
+
+inline int CountingBloomFilter::hashes() const
+{
+    return hashes_;
+}
+
+inline size_t CountingBloomFilter::memoryUsage() const
+{
+    return storage_.size() * sizeof(uint64_t);
+}
+
+/*
+  -----------------------------------------------------
+  End implementations for the CountingBloomFilter class.
+  -----------------------------------------------------
+*/
+
+/*
+  ------------------------------------------------
+  Begin implementations for the FilteredTree class.
+  ------------------------------------------------
+*/
+
+template<typename Tree>
+FilteredTree<Tree>::FilteredTree(size_t expectedKeys, double falsePositiveRate) :
+    falsePositiveRate_(falsePositiveRate),
+    filter_(new CountingBloomFilter(expectedKeys, falsePositiveRate)),
+    size_(0),
+    filteredMisses_(0),
+    rebuilds_(0),
+    built_(false)
+{
+
+}
+
+template<typename Tree>
+FilteredTree<Tree>::~FilteredTree()
+{
+    if(builder_.joinable()) builder_.join();
+}
+
+/**
+* A key the filter rules out is new, so only possible hits pay for the
+* lookup that tells an overwrite (counters unchanged) from a new key.
+*/
+template<typename Tree>
+void FilteredTree<Tree>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    uint64_t hash = hashKey(keyValuePair.first);
+    bool isNew = !filter_->mayContain(hash) || Tree::find(keyValuePair.first) == this->end();
+    Tree::insert(keyValuePair);
+    if(!isNew) return;
+    ++size_;
+    record(hash, true);
+}
+
+template<typename Tree>
+void FilteredTree<Tree>::remove(const Key& key)
+{
+    uint64_t hash = hashKey(key);
+    if(!filter_->mayContain(hash)) return;
+    if(Tree::find(key) == this->end()) return;
+    Tree::remove(key);
+    --size_;
+    record(hash, false);
+}
+
+template<typename Tree>
+void FilteredTree<Tree>::clear()
+{
+    finishRebuild(true);
+    Tree::clear();
+    filter_->clear();
+    added_.clear();
+    removed_.clear();
+    size_ = 0;
+}
+
+/**
+* Any rebuild in progress on either side is finished first.
+*/
+template<typename Tree>
+void FilteredTree<Tree>::swap(FilteredTree& other) noexcept
+{
+    finishRebuild(true);
+    other.finishRebuild(true);
+    Tree::swap(other);
+    std::swap(falsePositiveRate_, other.falsePositiveRate_);
+    filter_.swap(other.filter_);
+    std::swap(size_, other.size_);
+    std::swap(filteredMisses_, other.filteredMisses_);
+    std::swap(rebuilds_, other.rebuilds_);
+    added_.swap(other.added_);
+    removed_.swap(other.removed_);
+}
+
+/**
+* After copyFrom() the filter is refilled from the copied keys, in a
+* filter twice their number if the current one is too small for them.
+*/
+template<typename Tree>
+void FilteredTree<Tree>::cloneContents(const typename Tree::tree_type& other, unsigned threads)
+{
+    Tree::cloneContents(other, threads);   // clear() empties the filter first
+    size_ = static_cast<const FilteredTree&>(other).size_;
+    if(size_ > filter_->capacity()) {
+        filter_.reset(new CountingBloomFilter(2 * size_, falsePositiveRate_));
+    }
+    added_.reserve(size_);
+    for(typename Tree::iterator it = this->begin(); it != this->end(); ++it) {
+        uint64_t hash = hashKey(it->first);
+        filter_->add(hash);
+        added_.push_back(hash);
+    }
+}
+
+template<typename Tree>
+typename Tree::iterator FilteredTree<Tree>::find(const Key& key) const
+{
+    if(!filter_->mayContain(hashKey(key))) {
+        ++filteredMisses_;
+        return this->end();
+    }
+    return Tree::find(key);
+}
+
+template<typename Tree>
+bool FilteredTree<Tree>::mayContain(const Key& key) const
+{
+    return filter_->mayContain(hashKey(key));
+}
+
+template<typename Tree>
+size_t FilteredTree<Tree>::size() const
+{
+    return size_;
+}
+
+template<typename Tree>
+const CountingBloomFilter& FilteredTree<Tree>::filter() const
+{
+    return *filter_;
+}
+
+/**
+* Lookups answered by the filter alone.
+*/
+template<typename Tree>
+size_t FilteredTree<Tree>::filteredMisses() const
+{
+    return filteredMisses_;
+}
+
+template<typename Tree>
+size_t FilteredTree<Tree>::rebuilds() const
+{
+    return rebuilds_;
+}
+
+template<typename Tree>
+void FilteredTree<Tree>::waitForRebuild()
+{
+    finishRebuild(true);
+}
+
+/**
+* std::hash (the identity for integers in libstdc++) through the
+* splitmix64 finalizer, so the block and counter bits are well mixed.
+*/
+template<typename Tree>
+uint64_t FilteredTree<Tree>::hashKey(const Key& key)
+{
+    uint64_t h = (uint64_t)std::hash<Key>()(key);
+    h += 0x9e3779b97f4a7c15ull;
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+    return h ^ (h >> 31);
+}
+
+/**
+* Applies an update to the filter and logs it. Swaps a finished rebuild
+* in first, and starts one when the tree has outgrown the filter or the
+* log has outgrown the tree.
+*/
+template<typename Tree>
+void FilteredTree<Tree>::record(uint64_t hash, bool added)
+{
+    finishRebuild(false);
+    if(added) {
+        filter_->add(hash);
+        added_.push_back(hash);
+    }
+    else {
+        filter_->remove(hash);
+        removed_.push_back(hash);
+    }
+    if(next_ == nullptr && (size_ > filter_->capacity() || removed_.size() > filter_->capacity())) {
+        startRebuild();
+    }
+}
+
+/**
+* Hands the log to the builder, which takes added minus removed (as
+* multisets, by sorting both) and fills a filter with the result. The
+* caller only swaps two vectors.
+*/
+template<typename Tree>
+void FilteredTree<Tree>::startRebuild()
+{
+    snapshot_.swap(added_);
+    snapshotRemoved_.swap(removed_);
+    added_.clear();
+    removed_.clear();
+    next_.reset(new CountingBloomFilter(std::max(filter_->capacity(), 2 * size_), falsePositiveRate_));
+    built_.store(false);
+    CountingBloomFilter* target = next_.get();
+    std::vector<uint64_t>* hashes = &snapshot_;
+    std::vector<uint64_t>* gone = &snapshotRemoved_;
+    std::atomic<bool>* done = &built_;
+    builder_ = std::thread([target, hashes, gone, done]() {
+        std::sort(hashes->begin(), hashes->end());
+        std::sort(gone->begin(), gone->end());
+        std::vector<uint64_t> live;
+        live.reserve(hashes->size() - std::min(hashes->size(), gone->size()));
+        std::set_difference(hashes->begin(), hashes->end(), gone->begin(), gone->end(), std::back_inserter(live));
+        hashes->swap(live);
+        std::vector<uint64_t>().swap(*gone);
+        for(size_t i = 0; i < hashes->size(); ++i) {
+            target->add((*hashes)[i]);
+        }
+        done->store(true, std::memory_order_release);
+    });
+}
+
+/**
+* Swaps in the filter being built if it is ready (or, with wait, once it
+* is), after replaying the updates it missed: adds first, then removes,
+* so no counter drops below its true value. The live hashes it was built
+* from become the start of the log again.
+*/
+template<typename Tree>
+void FilteredTree<Tree>::finishRebuild(bool wait)
+{
+    if(next_ == nullptr) return;
+    if(!wait && !built_.load(std::memory_order_acquire)) return;
+    builder_.join();
+    for(size_t i = 0; i < added_.size(); ++i) next_->add(added_[i]);
+    for(size_t i = 0; i < removed_.size(); ++i) next_->remove(removed_[i]);
+    filter_.swap(next_);
+    next_.reset();
+    snapshot_.insert(snapshot_.end(), added_.begin(), added_.end());
+    added_.swap(snapshot_);
+    snapshot_.clear();
+    ++rebuilds_;
+}
+
+/*
+  ----------------------------------------------
+  End implementations for the FilteredTree class.
+  ----------------------------------------------
+*/
+
+#endif
@@ -0,0 +1,146 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <map>
+#include <chrono>
+#include <cstdlib>
+#include <stdexcept>
+#include "bst.h"
+#include "avlbst.h"
+#include "rbbst.h"
+#include "splay.h"
+#include "scapegoat.h"
+#include "tree-trace.h"
+#include "latency-histogram.h"
+
+using namespace std;
+
+/**
+ * Replays a trace recorded by TraceRecordingTree against one of the trees
+ * in the repo and reports throughput and per-operation latency.
+ *
+ *   tree-replay TRACE [--tree=avl|bst|rb|splay|scapegoat|map] [--repeat=N]
+ *
+ * The whole trace is decoded before the clock starts, so only the tree
+ * operations are measured (plus one counter read per operation for the
+ * latency histograms). Each repetition starts from an empty tree.
+ */
+
+/**
+ * std::map behind the tree interface, for any key type.
+ */
+template<typename Key>
+class StdMapOf : public map<Key, int>
+{
+public:
+    void insert(const pair<const Key, int>& item) { (*this)[item.first] = item.second; }
+    void remove(const Key& key) { this->erase(key); }
+};
+
+template<typename Key>
+struct TraceOp
+{
+    int op;
+    Key key;
+};
+
+template<typename Key>
+vector<TraceOp<Key> > loadTrace(const string& path)
+{
+    TraceReader<Key> reader(path);
+    vector<TraceOp<Key> > ops;
+    TraceOp<Key> op;
+    while(reader.next(op.op, op.key)) ops.push_back(op);
+    return ops;
+}
+
+template<typename Tree, typename Key>
+void replay(const vector<TraceOp<Key> >& ops, int repeat, const string& treeName)
+{
+    OpLatencies* latencies = new OpLatencies();
+    size_t hits = 0;
+    double seconds = 0;
+    for(int r = 0; r < repeat; ++r) {
+        Tree tree;
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        for(size_t i = 0; i < ops.size(); ++i) {
+            uint64_t t0 = readCycleCounter();
+            if(ops[i].op == TRACE_INSERT) {
+                tree.insert(make_pair(ops[i].key, (int)i));
+                latencies->ops[LATENCY_INSERT].record(readCycleCounter() - t0);
+            }
+            else if(ops[i].op == TRACE_REMOVE) {
+                tree.remove(ops[i].key);
+                latencies->ops[LATENCY_REMOVE].record(readCycleCounter() - t0);
+            }
+            else {
+                if(tree.find(ops[i].key) != tree.end()) ++hits;
+                latencies->ops[LATENCY_FIND].record(readCycleCounter() - t0);
+            }
+        }
+        seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+
+    size_t total = ops.size() * repeat;
+    double ticksPerNs = cycleCounterTicksPerNs();
+    cout << treeName << ": " << total << " ops in " << fixed << setprecision(3) << seconds << " s, "
+         << setprecision(0) << total / seconds << " ops/s, " << hits << " find hits" << endl;
+    cout << left << setw(8) << "op" << right << setw(12) << "count" << setw(10) << "p50 ns"
+         << setw(10) << "p99 ns" << setw(10) << "p999 ns" << setw(12) << "max ns" << endl;
+    for(int op = 0; op < NUM_LATENCY_OPS; ++op) {
+        const LatencyHistogram& h = latencies->ops[op];
+        cout << left << setw(8) << latencyOpName(op) << right << setw(12) << h.count()
+             << setw(10) << h.percentile(0.5) / ticksPerNs << setw(10) << h.percentile(0.99) / ticksPerNs
+             << setw(10) << h.percentile(0.999) / ticksPerNs << setw(12) << h.max() / ticksPerNs << endl;
+    }
+    delete latencies;
+}
+
+template<typename Key>
+bool replayAs(const string& path, const string& tree, int repeat)
+{
+    vector<TraceOp<Key> > ops = loadTrace<Key>(path);
+    if(tree == "avl") replay<AVLTree<Key, int> >(ops, repeat, tree);
+    else if(tree == "bst") replay<BinarySearchTree<Key, int> >(ops, repeat, tree);
+    else if(tree == "rb") replay<RBTree<Key, int> >(ops, repeat, tree);
+    else if(tree == "splay") replay<SplayTree<Key, int> >(ops, repeat, tree);
+    else if(tree == "scapegoat") replay<ScapegoatTree<Key, int> >(ops, repeat, tree);
+    else if(tree == "map") replay<StdMapOf<Key> >(ops, repeat, tree);
+    else return false;
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    string path;
+    string tree = "avl";
+    int repeat = 1;
+    bool badArgs = false;
+    for(int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if(arg.compare(0, 7, "--tree=") == 0) tree = arg.substr(7);
+        else if(arg.compare(0, 9, "--repeat=") == 0) repeat = atoi(arg.c_str() + 9);
+        else if(path.empty() and arg.compare(0, 2, "--") != 0) path = arg;
+        else badArgs = true;
+    }
+    if(badArgs or path.empty() or repeat < 1) {
+        cerr << "usage: tree-replay TRACE [--tree=avl|bst|rb|splay|scapegoat|map] [--repeat=N]" << endl;
+        return 2;
+    }
+
+    try {
+        bool known = (TraceReader<int64_t>::keyKind(path) == TRACE_INTEGER_KEYS)
+                     ? replayAs<int64_t>(path, tree, repeat)
+                     : replayAs<string>(path, tree, repeat);
+        if(!known) {
+            cerr << "tree-replay: unknown tree " << tree << endl;
+            return 2;
+        }
+    }
+    catch(const std::exception& e) {
+        cerr << "tree-replay: " << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
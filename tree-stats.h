@@ -0,0 +1,75 @@
+#ifndef TREE_STATS_H
+#define TREE_STATS_H
+
+#include <cstddef>
+
+/**
+* Statistics policies for BinarySearchTree and the trees derived from it,
+* chosen with the tree's Stats template parameter. The tree calls the hooks
+* below as it works: once per key comparison, per node visited on a search
+* path, per rotation, per node allocated or freed, and per iterator step.
+*
+* NullTreeStats, the default, makes every hook an empty inline function, so
+* a tree that does not ask for statistics compiles to the same code as
+* before. CountingTreeStats keeps plain counters. Any class with the same
+* member functions can be used as a policy.
+*/
+struct NullTreeStats
+{
+    void comparison() {}
+    void visit() {}
+    void rotation() {}
+    void allocation() {}
+    void deallocation() {}
+    void iteratorStep() {}
+    void reset() {}
+};
+
+struct CountingTreeStats
+{
+    CountingTreeStats() { reset(); }
+
+    void comparison() { ++comparisons; }
+    void visit() { ++visits; }
+    void rotation() { ++rotations; }
+    void allocation() { ++allocations; }
+    void deallocation() { ++deallocations; }
+    void iteratorStep() { ++iteratorSteps; }
+    void reset()
+    {
+        comparisons = visits = rotations = 0;
+        allocations = deallocations = iteratorSteps = 0;
+    }
+
+    size_t comparisons;
+    size_t visits;
+    size_t rotations;
+    size_t allocations;
+    size_t deallocations;
+    size_t iteratorSteps;
+};
+
+/**
+* What an iterator keeps to report its steps to the tree's statistics: a
+* pointer in general, nothing at all for NullTreeStats (iterators inherit
+* from this, so the empty specialization adds no size).
+*/
+template <typename Stats>
+class TreeStatsRef
+{
+public:
+    TreeStatsRef(Stats* stats = NULL) : stats_(stats) {}
+    void iteratorStep() const { if(stats_ != NULL) stats_->iteratorStep(); }
+private:
+    Stats* stats_;
+};
+
+template <>
+class TreeStatsRef<NullTreeStats>
+{
+public:
+    TreeStatsRef(NullTreeStats* = NULL) {}
+    void iteratorStep() const {}
+};
+
+#endif
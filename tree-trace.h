@@ -0,0 +1,395 @@
+#ifndef TREE_TRACE_H
+#define TREE_TRACE_H
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+/**
+* Operation traces: a compact binary log of the find/insert/remove calls
+* made on a tree, recorded by TraceRecordingTree and read back with
+* TraceReader (see tree-replay.cpp).
+*
+* File layout: the 8 magic bytes "BSTTRACE", a version byte, a key kind
+* byte (TRACE_INTEGER_KEYS or TRACE_STRING_KEYS), then one record per
+* operation. Every record starts with a LEB128 varint whose low two bits
+* are the operation:
+*   integer keys: varint(zigzag(key - previous key) << 2 | op), so keys
+*                 near the previous one (sequential, clustered) take one
+*                 or two bytes
+*   string keys:  varint(length << 2 | op) followed by the key bytes
+* Values are not recorded; replays insert the record number instead.
+*/
+enum TraceOpKind { TRACE_INSERT = 0, TRACE_REMOVE = 1, TRACE_FIND = 2 };
+enum TraceKeyKind { TRACE_INTEGER_KEYS = 0, TRACE_STRING_KEYS = 1 };
+
+static const char TRACE_MAGIC[8] = { 'B', 'S', 'T', 'T', 'R', 'A', 'C', 'E' };
+static const uint8_t TRACE_VERSION = 1;
+
+inline void traceAppendVarint(uint64_t value, std::string& out)
+{
+    while(value >= 0x80) {
+        out.push_back((char)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((char)value);
+}
+
+inline bool traceReadVarint(const char*& pos, const char* end, uint64_t& value)
+{
+    value = 0;
+    for(int shift = 0; shift < 64 && pos != end; shift += 7) {
+        uint8_t byte = (uint8_t)*pos++;
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if(!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+/**
+* Encodes keys of type T. The primary template handles integer types;
+* other key types need a specialization like the std::string one.
+*/
+template <typename T>
+struct TraceCodec
+{
+    static_assert(std::is_integral<T>::value,
+                  "TraceCodec must be specialized for non-integer key types");
+
+    static const uint8_t KIND = TRACE_INTEGER_KEYS;
+
+    TraceCodec() : previous_(0) {}
+
+    void encode(int op, const T& key, std::string& out)
+    {
+        int64_t delta = (int64_t)((uint64_t)(int64_t)key - (uint64_t)previous_);
+        uint64_t zigzag = ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63);
+        traceAppendVarint(zigzag << 2 | (uint64_t)op, out);
+        previous_ = (int64_t)key;
+    }
+
+    bool decode(const char*& pos, const char* end, int& op, T& key)
+    {
+        uint64_t word;
+        if(!traceReadVarint(pos, end, word)) return false;
+        op = (int)(word & 3);
+        uint64_t zigzag = word >> 2;
+        int64_t delta = (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+        previous_ = (int64_t)((uint64_t)previous_ + (uint64_t)delta);
+        key = (T)previous_;
+        return true;
+    }
+
+private:
+    int64_t previous_;
+};
+
+template <>
+struct TraceCodec<std::string>
+{
+    static const uint8_t KIND = TRACE_STRING_KEYS;
+
+    void encode(int op, const std::string& key, std::string& out)
+    {
+        traceAppendVarint((uint64_t)key.size() << 2 | (uint64_t)op, out);
+        out.append(key);
+    }
+
+    bool decode(const char*& pos, const char* end, int& op, std::string& key)
+    {
+        uint64_t word;
+        if(!traceReadVarint(pos, end, word)) return false;
+        op = (int)(word & 3);
+        uint64_t length = word >> 2;
+        if((uint64_t)(end - pos) < length) return false;
+        key.assign(pos, (size_t)length);
+        pos += length;
+        return true;
+    }
+};
+
+/**
+* Appends operations to a trace file through a 64KB buffer. close()
+* writes the rest and reports a failed write; the destructor closes too,
+* but can only ignore errors.
+*/
+template <typename Key>
+class TraceWriter
+{
+public:
+    explicit TraceWriter(const std::string& path);
+    ~TraceWriter();
+
+    void record(int op, const Key& key);
+    void flush();
+    void close();
+    size_t records() const;
+
+private:
+    TraceWriter(const TraceWriter&);
+    TraceWriter& operator=(const TraceWriter&);
+
+    static const size_t BUFFER_SIZE = 1 << 16;
+
+    std::FILE* file_;   // NULL once closed
+    std::string buffer_;
+    TraceCodec<Key> codec_;
+    size_t records_;
+};
+
+/**
+* Reads a whole trace into memory and hands the operations out in order.
+*/
+template <typename Key>
+class TraceReader
+{
+public:
+    explicit TraceReader(const std::string& path);
+
+    // Returns false at the end of the trace; throws if it is malformed.
+    bool next(int& op, Key& key);
+
+    // Reads just the header of a trace to find its key kind.
+    static uint8_t keyKind(const std::string& path);
+
+private:
+    static std::string readFile(const std::string& path);
+    static void checkHeader(const char* data, size_t size, const std::string& path);
+
+    std::string data_;
+    const char* pos_;
+    const char* end_;
+    TraceCodec<Key> codec_;
+};
+
+/**
+* Wraps a tree (BinarySearchTree or any subclass) and records every
+* find, insert and remove into a trace file before passing it on.
+*/
+template <class Tree>
+class TraceRecordingTree : public Tree
+{
+public:
+    typedef typename Tree::key_type Key;
+    typedef typename Tree::mapped_type Value;
+
+    explicit TraceRecordingTree(const std::string& path);
+
+    virtual void insert(const std::pair<const Key, Value>& keyValuePair);
+    virtual void remove(const Key& key);
+    typename Tree::iterator find(const Key& key);
+    typename Tree::iterator find(const Key& key) const;
+
+    TraceWriter<Key>& trace();
+
+private:
+    mutable TraceWriter<Key> trace_;    // const finds are recorded too
+};
+
+/*
+  ----------------------------------------------
+  Begin implementations for the TraceWriter class.
+  ----------------------------------------------
+*/
+
+template<typename Key>
+TraceWriter<Key>::TraceWriter(const std::string& path) :
+    records_(0)
+{
+    file_ = std::fopen(path.c_str(), "wb");
+    if(file_ == NULL) throw std::runtime_error("TraceWriter: cannot create " + path);
+    buffer_.reserve(BUFFER_SIZE + 64);
+    buffer_.append(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    buffer_.push_back((char)TRACE_VERSION);
+    buffer_.push_back((char)TraceCodec<Key>::KIND);
+}
+
+template<typename Key>
+TraceWriter<Key>::~TraceWriter()
+{
+    // nothing may throw out of a destructor; a short trace is still readable
+    try {
+        close();
+    }
+    catch(const std::runtime_error&) {
+    }
+}
+
+template<typename Key>
+void TraceWriter<Key>::record(int op, const Key& key)
+{
+    if(file_ == NULL) throw std::logic_error("TraceWriter: record after close");
+    codec_.encode(op, key, buffer_);
+    ++records_;
+    if(buffer_.size() >= BUFFER_SIZE) flush();
+}
+
+template<typename Key>
+void TraceWriter<Key>::flush()
+{
+    if(file_ == NULL) return;
+    if(!buffer_.empty()) {
+        if(std::fwrite(buffer_.data(), 1, buffer_.size(), file_) != buffer_.size()) {
+            throw std::runtime_error("TraceWriter: write failed");
+        }
+        buffer_.clear();
+    }
+    if(std::fflush(file_) != 0) throw std::runtime_error("TraceWriter: write failed");
+}
+
+/**
+* Writes what is buffered and closes the file, even if the write fails;
+* throws if any of it did. Later calls do nothing.
+*/
+template<typename Key>
+void TraceWriter<Key>::close()
+{
+    if(file_ == NULL) return;
+    bool written = std::fwrite(buffer_.data(), 1, buffer_.size(), file_) == buffer_.size();
+    buffer_.clear();
+    // fclose writes out the stdio buffer, so it fails on a full disk too
+    bool closed = std::fclose(file_) == 0;
+    file_ = NULL;
+    if(!written || !closed) throw std::runtime_error("TraceWriter: write failed");
+}
+
+template<typename Key>
+size_t TraceWriter<Key>::records() const
+{
+    return records_;
+}
+
+/*
+  --------------------------------------------
+  End implementations for the TraceWriter class.
+  --------------------------------------------
+*/
+
+/*
+  ----------------------------------------------
+  Begin implementations for the TraceReader class.
+  ----------------------------------------------
+*/
+
+template<typename Key>
+std::string TraceReader<Key>::readFile(const std::string& path)
+{
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if(file == NULL) throw std::runtime_error("TraceReader: cannot open " + path);
+    std::string data;
+    char chunk[1 << 16];
+    size_t got;
+    while((got = std::fread(chunk, 1, sizeof(chunk), file)) > 0) data.append(chunk, got);
+    std::fclose(file);
+    checkHeader(data.data(), data.size(), path);
+    return data;
+}
+
+// Throws unless data starts with the magic bytes and the current version.
+template<typename Key>
+void TraceReader<Key>::checkHeader(const char* data, size_t size, const std::string& path)
+{
+    if(size < sizeof(TRACE_MAGIC) + 2 or std::memcmp(data, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0 or
+       (uint8_t)data[sizeof(TRACE_MAGIC)] != TRACE_VERSION) {
+        throw std::runtime_error("TraceReader: " + path + " is not a trace");
+    }
+}
+
+template<typename Key>
+uint8_t TraceReader<Key>::keyKind(const std::string& path)
+{
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if(file == NULL) throw std::runtime_error("TraceReader: cannot open " + path);
+    char header[sizeof(TRACE_MAGIC) + 2];
+    size_t got = std::fread(header, 1, sizeof(header), file);
+    std::fclose(file);
+    checkHeader(header, got, path);
+    return (uint8_t)header[sizeof(TRACE_MAGIC) + 1];
+}
+
+template<typename Key>
+TraceReader<Key>::TraceReader(const std::string& path) :
+    data_(readFile(path))
+{
+    if((uint8_t)data_[sizeof(TRACE_MAGIC) + 1] != TraceCodec<Key>::KIND) {
+        throw std::runtime_error("TraceReader: " + path + " has a different key type");
+    }
+    pos_ = data_.data() + sizeof(TRACE_MAGIC) + 2;
+    end_ = data_.data() + data_.size();
+}
+
+template<typename Key>
+bool TraceReader<Key>::next(int& op, Key& key)
+{
+    if(pos_ == end_) return false;
+    if(!codec_.decode(pos_, end_, op, key) or op > TRACE_FIND) {
+        throw std::runtime_error("TraceReader: malformed record");
+    }
+    return true;
+}
+
+/*
+  --------------------------------------------
+  End implementations for the TraceReader class.
+  --------------------------------------------
+*/
+
+/*
+  -----------------------------------------------------
+  Begin implementations for the TraceRecordingTree class.
+  -----------------------------------------------------
+*/
+
+template<class Tree>
+TraceRecordingTree<Tree>::TraceRecordingTree(const std::string& path) :
+    trace_(path)
+{
+
+}
+
+template<class Tree>
+TraceWriter<typename Tree::key_type>& TraceRecordingTree<Tree>::trace()
+{
+    return trace_;
+}
+
+template<class Tree>
+void TraceRecordingTree<Tree>::insert(const std::pair<const Key, Value>& keyValuePair)
+{
+    trace_.record(TRACE_INSERT, keyValuePair.first);
+    Tree::insert(keyValuePair);
+}
+
+template<class Tree>
+void TraceRecordingTree<Tree>::remove(const Key& key)
+{
+    trace_.record(TRACE_REMOVE, key);
+    Tree::remove(key);
+}
+
+template<class Tree>
+typename Tree::iterator TraceRecordingTree<Tree>::find(const Key& key)
+{
+    trace_.record(TRACE_FIND, key);
+    return Tree::find(key);
+}
+
+template<class Tree>
+typename Tree::iterator TraceRecordingTree<Tree>::find(const Key& key) const
+{
+    trace_.record(TRACE_FIND, key);
+    return Tree::find(key);
+}
+
+/*
+  ---------------------------------------------------
+  End implementations for the TraceRecordingTree class.
+  ---------------------------------------------------
+*/
+
+#endif